@@ -1,9 +1,95 @@
 {
+    "variables": {
+        # native benchmark of the frame helpers (`npm run bench:native`), and `bench*` exports of the addon (`npm run build:gyp:bench`)
+        "ezsp_bench%": 0,
+    },
+    "target_defaults": {
+        "include_dirs": [
+            # Stub headers
+            "src/native/stubs",
+            # SDK includes - add roots for relative includes
+            "simplicity_sdk",
+            "simplicity_sdk/protocol/zigbee",
+            "simplicity_sdk/protocol/zigbee/app/util/ezsp",
+            "simplicity_sdk/protocol/zigbee/app/ezsp-host",
+            "simplicity_sdk/protocol/zigbee/app/ezsp-host/ash",
+            "simplicity_sdk/protocol/zigbee/stack/include",
+            "simplicity_sdk/protocol/zigbee/stack/config",
+            "simplicity_sdk/protocol/zigbee/stack/platform/host",
+            "simplicity_sdk/platform/service/legacy_common_ash/inc",
+            "simplicity_sdk/platform/service/legacy_hal/inc",
+            "simplicity_sdk/platform/common/inc",
+            "simplicity_sdk/platform/radio/mac",
+            "simplicity_sdk/util/silicon_labs/silabs_core",
+        ],
+        "defines": [
+            "NAPI_VERSION=9",
+            # SDK-specific defines
+            "EZSP_HOST",
+            "EZSP_ASH", # Use ASH protocol (not SPI or CPC)
+            "EZSP_APPLICATION_HAS_ZIGBEE_KEY_ESTABLISHMENT_HANDLER",
+            "EZSP_APPLICATION_HAS_ID_CONFLICT_HANDLER",
+            "EZSP_APPLICATION_HAS_INCOMING_NETWORK_STATUS_HANDLER",
+            "UNIX_HOST",
+            # Define PLATFORM_HEADER to the actual header file
+            "PLATFORM_HEADER=<platform-header.h>",
+        ],
+        "cflags": [
+            "-std=c17",
+            "-Wall",
+            "-Wextra",
+            "-Os",
+            "-Wno-unused-parameter",
+            "-Wno-missing-field-initializers",
+            "-Wno-missing-braces",
+        ],
+        "cflags_cc": [
+            "-std=c++17",
+            "-Wall",
+            "-Wextra",
+            "-Os",
+            "-Wno-unused-parameter",
+            "-Wno-missing-field-initializers",
+            "-Wno-missing-braces",
+        ],
+        "conditions": [
+            [
+                "OS=='linux'",
+                {
+                    "defines": ["_POSIX_C_SOURCE=200809L"],
+                    "libraries": []
+                }
+            ],
+            [
+                "OS=='mac'",
+                {
+                    "cflags+": ["-fvisibility=hidden"],
+                    "xcode_settings": {
+                        "GCC_SYMBOLS_PRIVATE_EXTERN": "YES", # -fvisibility=hidden
+                    }
+                }
+            ]
+        ]
+    },
     "targets": [
+        {
+            # ASH host on its own, to route its serial byte I/O through the frame capture hooks (`startCapture`)
+            "target_name": "ash_host",
+            "type": "static_library",
+            "sources": [
+                "simplicity_sdk/protocol/zigbee/app/ezsp-host/ash/ash-host.c",
+            ],
+            "defines": [
+                "ezspSerialReadByte=ezspCaptureSerialReadByte",
+                "ezspSerialWriteByte=ezspCaptureSerialWriteByte",
+            ],
+            "cflags": ["-fPIC"],
+        },
         {
             "target_name": "ezsp_ash_posix",
             "dependencies": [
                 "<!(node -p \"require('node-addon-api').targets\"):node_addon_api",
+                "ash_host",
             ],
             "sources": [
                 "src/native/binding.cpp",
@@ -17,8 +103,7 @@
                 "simplicity_sdk/protocol/zigbee/app/ezsp-host/ezsp-host-io.c",
                 "simplicity_sdk/protocol/zigbee/app/ezsp-host/ezsp-host-queues.c",
                 "simplicity_sdk/protocol/zigbee/app/ezsp-host/ezsp-host-ui.c",
-                # SDK ASH-host sources
-                "simplicity_sdk/protocol/zigbee/app/ezsp-host/ash/ash-host.c",
+                # SDK ASH-host sources (ash-host.c: `ash_host` target)
                 "simplicity_sdk/protocol/zigbee/app/ezsp-host/ash/ash-host-ui.c",
                 # ASH common implementation
                 "simplicity_sdk/platform/service/legacy_common_ash/src/ash-common.c",
@@ -26,72 +111,29 @@
                 "simplicity_sdk/platform/service/legacy_hal/src/system-timer.c",
                 "simplicity_sdk/platform/service/legacy_hal/src/crc.c",
             ],
-            "include_dirs": [
-                # Stub headers
-                "src/native/stubs",
-                # SDK includes - add roots for relative includes
-                "simplicity_sdk",
-                "simplicity_sdk/protocol/zigbee",
-                "simplicity_sdk/protocol/zigbee/app/util/ezsp",
-                "simplicity_sdk/protocol/zigbee/app/ezsp-host",
-                "simplicity_sdk/protocol/zigbee/app/ezsp-host/ash",
-                "simplicity_sdk/protocol/zigbee/stack/include",
-                "simplicity_sdk/protocol/zigbee/stack/config",
-                "simplicity_sdk/protocol/zigbee/stack/platform/host",
-                "simplicity_sdk/platform/service/legacy_common_ash/inc",
-                "simplicity_sdk/platform/service/legacy_hal/inc",
-                "simplicity_sdk/platform/common/inc",
-                "simplicity_sdk/platform/radio/mac",
-                "simplicity_sdk/util/silicon_labs/silabs_core",
-            ],
-            "defines": [
-                "NAPI_VERSION=9",
-                # SDK-specific defines
-                "EZSP_HOST",
-                "EZSP_ASH", # Use ASH protocol (not SPI or CPC)
-                "EZSP_APPLICATION_HAS_ZIGBEE_KEY_ESTABLISHMENT_HANDLER",
-                "EZSP_APPLICATION_HAS_ID_CONFLICT_HANDLER",
-                "EZSP_APPLICATION_HAS_INCOMING_NETWORK_STATUS_HANDLER",
-                "UNIX_HOST",
-                # Define PLATFORM_HEADER to the actual header file
-                "PLATFORM_HEADER=<platform-header.h>",
-            ],
-            "cflags": [
-                "-std=c17",
-                "-Wall",
-                "-Wextra",
-                "-Os",
-                "-Wno-unused-parameter",
-                "-Wno-missing-field-initializers",
-                "-Wno-missing-braces",
-            ],
-            "cflags_cc": [
-                "-std=c++17",
-                "-Wall",
-                "-Wextra",
-                "-Os",
-                "-Wno-unused-parameter",
-                "-Wno-missing-field-initializers",
-                "-Wno-missing-braces",
-            ],
             "conditions": [
                 [
-                    "OS=='linux'",
+                    "ezsp_bench==1",
                     {
-                        "defines": ["_POSIX_C_SOURCE=200809L"],
-                        "libraries": []
+                        # `bench*` exports (`test/*.bench.ts`)
+                        "defines": ["EZSP_BENCH"],
                     }
-                ],
-                [
-                    "OS=='mac'",
+                ]
+            ],
+        }
+    ],
+    "conditions": [
+        [
+            "ezsp_bench==1",
+            {
+                "targets": [
                     {
-                        "cflags+": ["-fvisibility=hidden"],
-                        "xcode_settings": {
-                            "GCC_SYMBOLS_PRIVATE_EXTERN": "YES", # -fvisibility=hidden
-                        }
+                        "target_name": "ezsp_bench",
+                        "type": "executable",
+                        "sources": ["src/native/bench.cpp"],
                     }
                 ]
-            ]
-        }
+            }
+        ]
     ]
 }
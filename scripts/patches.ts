@@ -216,6 +216,38 @@ const PATCHES: Record<string, { path: string; original: string; patched: string
 //    sl_zigbee_ezsp_init();
 //  }`,
     },
+    /**
+     * Command latency instrumentation (`getCommandStats`), applied over the tracing fix above
+     */
+    siSdkSerialInterfaceUartC4: {
+        path: path.join(import.meta.dirname, "..", "simplicity_sdk", "protocol", "zigbee", "app", "util", "ezsp", "serial-interface-uart.c"),
+        original: `  sl_zigbee_ezsp_trace_ezsp_verbose("serialSendCommand(): ID=0x%02X Seq=0x%02X",
+                                    (ezspFrameContents[EZSP_EXTENDED_FRAME_CONTROL_HB_INDEX] & EZSP_EXTENDED_FRAME_FORMAT_VERSION_MASK) == EZSP_EXTENDED_FRAME_FORMAT_VERSION ? ezspFrameContents[EZSP_EXTENDED_FRAME_ID_LB_INDEX] | (ezspFrameContents[EZSP_EXTENDED_FRAME_ID_HB_INDEX] << 8) : ezspFrameContents[EZSP_FRAME_ID_INDEX],
+                                    ezspFrameContents[EZSP_SEQUENCE_INDEX]);`,
+        patched: `  sl_zigbee_ezsp_trace_ezsp_verbose("serialSendCommand(): ID=0x%02X Seq=0x%02X",
+                                    (ezspFrameContents[EZSP_EXTENDED_FRAME_CONTROL_HB_INDEX] & EZSP_EXTENDED_FRAME_FORMAT_VERSION_MASK) == EZSP_EXTENDED_FRAME_FORMAT_VERSION ? ezspFrameContents[EZSP_EXTENDED_FRAME_ID_LB_INDEX] | (ezspFrameContents[EZSP_EXTENDED_FRAME_ID_HB_INDEX] << 8) : ezspFrameContents[EZSP_FRAME_ID_INDEX],
+                                    ezspFrameContents[EZSP_SEQUENCE_INDEX]);
+  extern void ezspNapiOnCommandSent(uint16_t frameId, uint8_t sequence);
+  ezspNapiOnCommandSent((ezspFrameContents[EZSP_EXTENDED_FRAME_CONTROL_HB_INDEX] & EZSP_EXTENDED_FRAME_FORMAT_VERSION_MASK) == EZSP_EXTENDED_FRAME_FORMAT_VERSION ? ezspFrameContents[EZSP_EXTENDED_FRAME_ID_LB_INDEX] | (ezspFrameContents[EZSP_EXTENDED_FRAME_ID_HB_INDEX] << 8) : ezspFrameContents[EZSP_FRAME_ID_INDEX],
+                        ezspFrameContents[EZSP_SEQUENCE_INDEX]);`,
+    },
+    /**
+     * Command latency instrumentation (`getCommandStats`), applied over the tracing fix above
+     */
+    siSdkSerialInterfaceUartC5: {
+        path: path.join(import.meta.dirname, "..", "simplicity_sdk", "protocol", "zigbee", "app", "util", "ezsp", "serial-interface-uart.c"),
+        original: `sl_zigbee_ezsp_trace_ezsp_verbose("serialResponseReceived(): ID=0x%02X Seq=0x%02X Buffer=%u",
+                                        (buffer->data[EZSP_EXTENDED_FRAME_CONTROL_HB_INDEX] & EZSP_EXTENDED_FRAME_FORMAT_VERSION_MASK) == EZSP_EXTENDED_FRAME_FORMAT_VERSION ? buffer->data[EZSP_EXTENDED_FRAME_ID_LB_INDEX] | (buffer->data[EZSP_EXTENDED_FRAME_ID_HB_INDEX] << 8) : buffer->data[EZSP_FRAME_ID_INDEX],
+                                        buffer->data[EZSP_SEQUENCE_INDEX],
+                                        buffer);`,
+        patched: `sl_zigbee_ezsp_trace_ezsp_verbose("serialResponseReceived(): ID=0x%02X Seq=0x%02X Buffer=%u",
+                                        (buffer->data[EZSP_EXTENDED_FRAME_CONTROL_HB_INDEX] & EZSP_EXTENDED_FRAME_FORMAT_VERSION_MASK) == EZSP_EXTENDED_FRAME_FORMAT_VERSION ? buffer->data[EZSP_EXTENDED_FRAME_ID_LB_INDEX] | (buffer->data[EZSP_EXTENDED_FRAME_ID_HB_INDEX] << 8) : buffer->data[EZSP_FRAME_ID_INDEX],
+                                        buffer->data[EZSP_SEQUENCE_INDEX],
+                                        buffer);
+    extern void ezspNapiOnResponseReceived(uint16_t frameId, uint8_t sequence);
+    ezspNapiOnResponseReceived((buffer->data[EZSP_EXTENDED_FRAME_CONTROL_HB_INDEX] & EZSP_EXTENDED_FRAME_FORMAT_VERSION_MASK) == EZSP_EXTENDED_FRAME_FORMAT_VERSION ? buffer->data[EZSP_EXTENDED_FRAME_ID_LB_INDEX] | (buffer->data[EZSP_EXTENDED_FRAME_ID_HB_INDEX] << 8) : buffer->data[EZSP_FRAME_ID_INDEX],
+                               buffer->data[EZSP_SEQUENCE_INDEX]);`,
+    },
     siSdkAshHostC: {
         path: path.join(import.meta.dirname, "..", "simplicity_sdk", "protocol", "zigbee", "app", "ezsp-host", "ash", "ash-host.c"),
         original: `        sl_zigbee_ezsp_trace_ezsp_verbose("ashReceiveFrame(): ID=0x%02X Seq=0x%02X Buffer=%u",
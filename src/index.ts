@@ -108,6 +108,8 @@ export type EzspNativeEvent =
           apsFrame: SLZigbeeApsFrame;
           lastHopLqi: number;
           sender: number;
+          /** decoded from `messageContents`, null if malformed */
+          zclHeader: EzspZclHeader | null;
           messageContents: Buffer;
       }
     | {
@@ -128,8 +130,568 @@ export type EzspNativeEvent =
       };
 
 export type EzspEventCallback = (event: EzspNativeEvent) => void;
+/** Callback when `binaryEvents` is set: `incomingMessage`, `zdoResponse` and `messageSent` are Buffers, see `EzspBinaryEvent` */
+export type EzspBinaryEventCallback = (event: EzspNativeEvent | Buffer) => void;
+/** Callback when `eventBatch` is set */
+export type EzspEventBatchCallback = (events: EzspNativeEvent[]) => void;
+/** Callback when both `eventBatch` and `binaryEvents` are set */
+export type EzspBinaryEventBatchCallback = (events: (EzspNativeEvent | Buffer)[]) => void;
 
-export interface EzspNative {
+/** ZCL header of an `incomingMessage`, decoded natively */
+export type EzspZclHeader = {
+    frameControl: number;
+    /** only if manufacturer specific (frame control bit 2) */
+    manufacturerCode: number | undefined;
+    transactionSequenceNumber: number;
+    commandId: number;
+    /** start of the ZCL payload in `messageContents` */
+    payloadOffset: number;
+};
+
+/** Kind of binary events (`binaryEvents`) */
+export enum EzspBinaryEventKind {
+    INCOMING_MESSAGE = 1,
+    ZDO_RESPONSE = 2,
+    MESSAGE_SENT = 3,
+}
+
+/** Size of the fixed-layout header of binary events, followed by message contents */
+export const EZSP_BINARY_EVENT_HEADER_SIZE = 24;
+/** Size of a packed APS frame */
+export const EZSP_PACKED_APS_FRAME_SIZE = 12;
+
+/**
+ * Read a packed APS frame (little endian: profileId, clusterId, sourceEndpoint, destinationEndpoint, options, groupId, sequence, radius).
+ */
+export function readPackedApsFrame(buffer: Buffer, offset = 0): SLZigbeeApsFrame {
+    return {
+        profileId: buffer.readUInt16LE(offset),
+        clusterId: buffer.readUInt16LE(offset + 2),
+        sourceEndpoint: buffer[offset + 4],
+        destinationEndpoint: buffer[offset + 5],
+        options: buffer.readUInt16LE(offset + 6),
+        groupId: buffer.readUInt16LE(offset + 8),
+        sequence: buffer[offset + 10],
+        radius: buffer[offset + 11],
+    };
+}
+
+/**
+ * Write a packed APS frame, see `readPackedApsFrame`.
+ * Send commands accept it in place of `SLZigbeeApsFrame` (exactly `EZSP_PACKED_APS_FRAME_SIZE` bytes), skipping per-property conversion,
+ * and write the assigned APS sequence back into it on success.
+ */
+export function writePackedApsFrame(apsFrame: SLZigbeeApsFrame, buffer = Buffer.allocUnsafe(EZSP_PACKED_APS_FRAME_SIZE), offset = 0): Buffer {
+    buffer.writeUInt16LE(apsFrame.profileId, offset);
+    buffer.writeUInt16LE(apsFrame.clusterId, offset + 2);
+    buffer[offset + 4] = apsFrame.sourceEndpoint;
+    buffer[offset + 5] = apsFrame.destinationEndpoint;
+    buffer.writeUInt16LE(apsFrame.options, offset + 6);
+    buffer.writeUInt16LE(apsFrame.groupId, offset + 8);
+    buffer[offset + 10] = apsFrame.sequence;
+    buffer[offset + 11] = apsFrame.radius;
+
+    return buffer;
+}
+
+/** Size of the capture file header: "EZSPCAP", format version, wall clock at start (u64 µs), monotonic clock at start (u64 ns) */
+export const EZSP_CAPTURE_FILE_HEADER_SIZE = 24;
+/** Size of a capture record header: delta since previous record (u32 µs), flags, length (u16), followed by the frame */
+export const EZSP_CAPTURE_RECORD_HEADER_SIZE = 7;
+/** Frame bytes kept per capture record */
+export const EZSP_CAPTURE_MAX_FRAME_SIZE = 512;
+
+export enum EzspCaptureFlag {
+    NCP_TO_HOST = 0x01,
+    TRUNCATED = 0x02,
+    /** records were dropped right before this one */
+    DROPPED = 0x04,
+    /** time resync, not a frame: u64 ns since start */
+    TIME = 0x80,
+}
+
+export type EzspCaptureRecord = {
+    /** µs since capture start */
+    time: number;
+    direction: "hostToNcp" | "ncpToHost";
+    /** frame longer than `EZSP_CAPTURE_MAX_FRAME_SIZE`, `frame` holds the beginning */
+    truncated: boolean;
+    /** frames were lost right before this one */
+    afterDrop: boolean;
+    /**
+     * raw serial bytes (byte stuffed), up to and including the Flag (0x7E) closing the frame, or a Cancel (0x1A):
+     * the bytes before a Cancel were discarded by the receiver. A Substitute (0x18) stays within its frame, discarded at its Flag.
+     */
+    frame: Buffer;
+};
+
+export type EzspCapture = {
+    version: number;
+    /** wall clock at start, µs since epoch */
+    startTime: number;
+    /** monotonic clock at start (ns), same clock as `process.hrtime.bigint()` */
+    startHrtime: bigint;
+    records: EzspCaptureRecord[];
+};
+
+/**
+ * Decode a capture file (`startCapture`). A record cut short (e.g. process killed) ends the decoding.
+ */
+export function readCapture(buffer: Buffer): EzspCapture {
+    if (buffer.length < EZSP_CAPTURE_FILE_HEADER_SIZE || buffer.toString("latin1", 0, 7) !== "EZSPCAP") {
+        throw new Error("Not a capture file");
+    }
+
+    const capture: EzspCapture = {
+        version: buffer[7],
+        startTime: Number(buffer.readBigUInt64LE(8)),
+        startHrtime: buffer.readBigUInt64LE(16),
+        records: [],
+    };
+    let time = 0;
+    let offset = EZSP_CAPTURE_FILE_HEADER_SIZE;
+
+    while (offset + EZSP_CAPTURE_RECORD_HEADER_SIZE <= buffer.length) {
+        const flags = buffer[offset + 4];
+        const length = buffer.readUInt16LE(offset + 5);
+        const start = offset + EZSP_CAPTURE_RECORD_HEADER_SIZE;
+
+        if (start + length > buffer.length) {
+            break;
+        }
+
+        if (flags & EzspCaptureFlag.TIME) {
+            time = Number(buffer.readBigUInt64LE(start) / 1000n);
+        } else {
+            time += buffer.readUInt32LE(offset);
+
+            capture.records.push({
+                time,
+                direction: flags & EzspCaptureFlag.NCP_TO_HOST ? "ncpToHost" : "hostToNcp",
+                truncated: (flags & EzspCaptureFlag.TRUNCATED) !== 0,
+                afterDrop: (flags & EzspCaptureFlag.DROPPED) !== 0,
+                frame: buffer.subarray(start, start + length),
+            });
+        }
+
+        offset = start + length;
+    }
+
+    return capture;
+}
+
+/** `send` arguments */
+export type EzspSendBatchEntry = [
+    type: number,
+    indexOrDestination: number,
+    apsFrame: SLZigbeeApsFrame | Uint8Array,
+    message: Buffer,
+    alias: number,
+    sequence: number,
+];
+
+/** Size of a packed `sendBatch` entry, followed by its message */
+export const EZSP_SEND_BATCH_ENTRY_HEADER_SIZE = 19;
+
+/**
+ * Pack `sendBatch` entries (little endian: type, indexOrDestination, packed APS frame, alias, sequence, message length, message).
+ */
+export function packSendBatch(entries: EzspSendBatchEntry[]): Buffer {
+    let length = 0;
+
+    for (const entry of entries) {
+        if (entry[3].length > 0xff) {
+            throw new RangeError("Message too long");
+        }
+
+        length += EZSP_SEND_BATCH_ENTRY_HEADER_SIZE + entry[3].length;
+    }
+
+    const buffer = Buffer.allocUnsafe(length);
+    let offset = 0;
+
+    for (const [type, indexOrDestination, apsFrame, message, alias, sequence] of entries) {
+        buffer[offset] = type;
+        buffer.writeUInt16LE(indexOrDestination, offset + 1);
+
+        if (apsFrame instanceof Uint8Array) {
+            buffer.set(apsFrame.subarray(0, EZSP_PACKED_APS_FRAME_SIZE), offset + 3);
+        } else {
+            writePackedApsFrame(apsFrame, buffer, offset + 3);
+        }
+
+        buffer.writeUInt16LE(alias, offset + 15);
+        buffer[offset + 17] = sequence;
+        buffer[offset + 18] = message.length;
+        buffer.set(message, offset + EZSP_SEND_BATCH_ENTRY_HEADER_SIZE);
+        offset += EZSP_SEND_BATCH_ENTRY_HEADER_SIZE + message.length;
+    }
+
+    return buffer;
+}
+
+/**
+ * Lazy view of a binary event (`binaryEvents`), fields are decoded from the buffer only when accessed.
+ */
+export class EzspBinaryEvent {
+    constructor(public readonly buffer: Buffer) {}
+
+    get kind(): EzspBinaryEventKind {
+        return this.buffer[0];
+    }
+
+    /** Name of the equivalent object event, undefined for an unknown kind */
+    get name(): "incomingMessage" | "zdoResponse" | "messageSent" | undefined {
+        switch (this.kind) {
+            case EzspBinaryEventKind.INCOMING_MESSAGE:
+                return "incomingMessage";
+            case EzspBinaryEventKind.ZDO_RESPONSE:
+                return "zdoResponse";
+            case EzspBinaryEventKind.MESSAGE_SENT:
+                return "messageSent";
+            default:
+                return undefined;
+        }
+    }
+
+    /** Incoming or outgoing message type */
+    get type(): number {
+        return this.buffer[1];
+    }
+
+    get apsFrame(): SLZigbeeApsFrame {
+        return readPackedApsFrame(this.buffer, 2);
+    }
+
+    /** Sender for incoming messages, index or destination for sent messages */
+    get sender(): number {
+        return this.buffer.readUInt16LE(14);
+    }
+
+    get indexOrDestination(): number {
+        return this.sender;
+    }
+
+    get lastHopLqi(): number {
+        return this.buffer[16];
+    }
+
+    get lastHopRssi(): number {
+        return this.buffer.readInt8(17);
+    }
+
+    /** `incomingMessage` only, null if malformed */
+    get zclHeader(): EzspZclHeader | null {
+        const payloadOffset = this.buffer[23];
+
+        if (payloadOffset === 0) {
+            return null;
+        }
+
+        const frameControl = this.buffer[18];
+
+        return {
+            frameControl,
+            manufacturerCode: frameControl & 0x04 ? this.buffer.readUInt16LE(19) : undefined,
+            transactionSequenceNumber: this.buffer[21],
+            commandId: this.buffer[22],
+            payloadOffset,
+        };
+    }
+
+    /** `messageSent` only */
+    get messageTag(): number {
+        return this.buffer.readUInt16LE(18);
+    }
+
+    /** `messageSent` only */
+    get status(): SLStatus {
+        return this.buffer.readUInt32LE(20);
+    }
+
+    get messageContents(): Buffer {
+        return this.buffer.subarray(EZSP_BINARY_EVENT_HEADER_SIZE);
+    }
+}
+
+export type EzspTickStats = {
+    /** total process wakeups for the host stack (poll + timer) */
+    wakeups: number;
+    /** wakeups due to serial port readability */
+    pollWakeups: number;
+    /** wakeups due to timer (regular tick or ASH deadline) */
+    timerWakeups: number;
+    /** calls to `sl_zigbee_ezsp_tick` */
+    ticks: number;
+};
+
+export type EzspPayloadPoolStats = {
+    /** heap allocations of slabs of message contents slots, since load */
+    slabAllocations: number;
+    /** slabs freed (idle on `stop`), since load */
+    slabFrees: number;
+    /** total slots, in allocated slabs */
+    slots: number;
+    /** message contents written to a slot (one per event that has some) */
+    acquired: number;
+    /** slots returned to the pool (Buffer garbage collected) */
+    released: number;
+    /** slots currently held by JS Buffers or pending events */
+    inUse: number;
+};
+
+export type EzspCongestionStats = {
+    /** `congestionControl` set */
+    enabled: boolean;
+    /** current max sends awaiting `messageSent` */
+    window: number;
+    /** admitted sends awaiting `messageSent` (not the raw `ezspSend*` ones) */
+    inFlight: number;
+    /** sends waiting for room in the window */
+    queued: number;
+    /** `queued` per priority class */
+    queuedByPriority: [high: number, normal: number, bulk: number];
+    /** sends issued to the NCP within the window */
+    admitted: number;
+    /** sends queued because the window was full */
+    deferred: number;
+    /** sends rejected because the queue was full */
+    dropped: number;
+    /** `SL_ZIGBEE_EZSP_ERROR_OVERFLOW` (counted even if disabled) */
+    overflowErrors: number;
+    /** `SL_ZIGBEE_EZSP_ERROR_QUEUE_FULL` (counted even if disabled) */
+    queueFullErrors: number;
+    /** window halvings */
+    decreases: number;
+};
+
+export type EzspLatencyHistogram = {
+    /** recorded samples */
+    count: number;
+    /** durations in microseconds, percentiles are the lower bound of their histogram bucket (~25% precision) */
+    min: number;
+    max: number;
+    mean: number;
+    p50: number;
+    p90: number;
+    p99: number;
+    /** non-empty histogram buckets (log-linear, 4 per power of two) */
+    buckets: [lowerBound: number, count: number][];
+};
+
+/** `count` is the number of commands that got their response */
+export type EzspCommandStats = EzspLatencyHistogram & {
+    /** EZSP frame ID */
+    frameId: number;
+    /** commands that ended without response (no response, ASH timeout or frame error, superseded), NCP overflow/queue full excluded */
+    timeouts: number;
+    /** ASH DATA frame retransmissions while awaiting responses */
+    retries: number;
+};
+
+/** `tick` and `dispatch` cover a rolling window: the last 50-60s (6 intervals of 10s), or less since `init`/`start` or the last reset */
+export type EzspLoopStats = {
+    /** microseconds covered by `tick` and `dispatch` */
+    elapsed: number;
+    /** ticks run on the JS thread (not `ioThread`), including the callbacks they deliver directly */
+    tick: EzspLatencyHistogram;
+    /** JS callback invocations, direct or queued */
+    dispatch: EzspLatencyHistogram;
+    /** longest single tick or dispatch since `init`/`start` or the last reset (not windowed) */
+    worstStall: {
+        /** microseconds */
+        duration: number;
+        source: "none" | "tick" | "dispatch";
+        /** end time, ms since epoch (as `Date.now()`) */
+        at: number;
+    };
+};
+
+export type EzspAshStats = {
+    /** ASH connection established (RSTACK received) */
+    connected: boolean;
+    /** current adaptive ack timeout (ms), between `ackTimeMin` and `ackTimeMax` */
+    ackPeriod: number;
+    ackTimeMin: number;
+    ackTimeMax: number;
+    /** total bytes transmitted */
+    txBytes: number;
+    /** blocks transmitted */
+    txBlocks: number;
+    /** DATA frame data fields bytes transmitted */
+    txData: number;
+    /** frames of all types transmitted */
+    txAllFrames: number;
+    /** DATA frames transmitted */
+    txDataFrames: number;
+    /** ACK frames transmitted */
+    txAckFrames: number;
+    /** NAK frames transmitted */
+    txNakFrames: number;
+    /** DATA frames retransmitted */
+    txReDataFrames: number;
+    /** ACK and NAK frames with nFlag 0 transmitted */
+    txN0Frames: number;
+    /** ACK and NAK frames with nFlag 1 (host not ready) transmitted */
+    txN1Frames: number;
+    /** frames cancelled (with ASH_CAN byte) */
+    txCancelled: number;
+    /** total bytes received */
+    rxBytes: number;
+    /** blocks received */
+    rxBlocks: number;
+    /** DATA frame data fields bytes received */
+    rxData: number;
+    /** frames of all types received */
+    rxAllFrames: number;
+    /** DATA frames received */
+    rxDataFrames: number;
+    /** ACK frames received */
+    rxAckFrames: number;
+    /** NAK frames received */
+    rxNakFrames: number;
+    /** retransmitted DATA frames received */
+    rxReDataFrames: number;
+    /** ACK and NAK frames with nFlag 0 received */
+    rxN0Frames: number;
+    /** ACK and NAK frames with nFlag 1 (NCP not ready) received */
+    rxN1Frames: number;
+    /** frames cancelled (with ASH_CAN byte) */
+    rxCancelled: number;
+    /** frames with CRC errors */
+    rxCrcErrors: number;
+    /** frames with comm errors (with ASH_SUB byte) */
+    rxCommErrors: number;
+    /** frames shorter than minimum length */
+    rxTooShort: number;
+    /** frames longer than maximum length */
+    rxTooLong: number;
+    /** frames with illegal control byte */
+    rxBadControl: number;
+    /** frames with illegal length for type of frame */
+    rxBadLength: number;
+    /** frames with bad ACK numbers */
+    rxBadAckNumber: number;
+    /** DATA frames discarded due to lack of buffers (reject condition) */
+    rxNoBuffer: number;
+    /** duplicate retransmitted DATA frames (reject condition) */
+    rxDuplicates: number;
+    /** DATA frames received out of sequence (reject condition) */
+    rxOutOfSequence: number;
+    /** received ACK timeouts */
+    rxAckTimeouts: number;
+};
+
+export type EzspCaptureStats = {
+    active: boolean;
+    /** file of the current or last capture */
+    path: string;
+    /** ring buffer size (bytes), 0 once stopped */
+    bufferSize: number;
+    /** bytes waiting in the ring for the writer thread */
+    buffered: number;
+    /** frames recorded */
+    records: number;
+    /** frames dropped with the ring full (writer behind), next recorded frame is flagged */
+    dropped: number;
+    /** frames cut at `EZSP_CAPTURE_MAX_FRAME_SIZE` */
+    truncated: number;
+    /** bytes written to file, header included */
+    written: number;
+    /** failed writes, the data buffered at the time is lost */
+    writeErrors: number;
+};
+
+export type EzspDuplicateStats = {
+    /** `duplicateWindow` (ms), 0 if disabled */
+    window: number;
+    /** incoming messages looked up */
+    checked: number;
+    /** incoming messages dropped as duplicates */
+    duplicates: number;
+    /** entries still within the window replaced by newer ones (table full around their slot), may let duplicates through */
+    evictions: number;
+};
+
+export type EzspGpDedupEntry = {
+    sourceId: number;
+    /** last forwarded GPDF */
+    frameCounter: number;
+    sequenceNumber: number;
+    commandId: number;
+    /** ms since the last forwarded GPDF */
+    age: number;
+    /** GPDFs forwarded to JS */
+    forwarded: number;
+    /** GPDFs dropped as repeats */
+    duplicates: number;
+};
+
+export type EzspReportCoalescingStats = {
+    enabled: boolean;
+    /** ms */
+    interval: number;
+    /** tracked sender/endpoint/cluster */
+    sources: number;
+    /** sources with held records */
+    heldSources: number;
+    /** reports delivered as is (first in their interval, not coalescible) */
+    passed: number;
+    /** reports held for a coalesced delivery */
+    held: number;
+    /** held values replaced by a newer one of the same attribute */
+    replaced: number;
+    /** coalesced reports delivered */
+    flushed: number;
+    /** reports with a record that could not be parsed, delivered as is */
+    unparsed: number;
+    /** reports delivered as is because `maxSources` was reached */
+    overflows: number;
+};
+
+/** Incoming message filter, omitted fields match anything */
+export type EzspMessageFilter = {
+    /** `SLZigbeeIncomingMessageType` */
+    type?: number;
+    profileId?: number;
+    clusterId?: number;
+    sourceEndpoint?: number;
+    destinationEndpoint?: number;
+    /** sender node ID */
+    sender?: number;
+    /** ZCL frame type (0 global, 1 cluster specific), never matches ZDO or a malformed ZCL header */
+    frameType?: 0 | 1;
+    /** ZCL command ID, never matches ZDO or a malformed ZCL header */
+    commandId?: number;
+    /** on match, `drop` (default) the message or `accept` it without evaluating the following filters */
+    action?: "drop" | "accept";
+};
+
+export type EzspDelivery = {
+    messageTag: number;
+    /** APS sequence, from `messageSent` */
+    apsSequence: number;
+};
+
+/** `sendTracked` rejection, `status` is `SL_STATUS_TIMEOUT` on timeout and `SL_STATUS_ABORT` on `stop` */
+export type EzspDeliveryError = Error & {
+    status: SLStatus;
+    messageTag: number;
+};
+
+/** Raw pseudo-terminal pair file descriptors, close both when done */
+export type EzspPseudoTerminal = {
+    master: number;
+    slave: number;
+    /** slave device, usable as `serialPort` */
+    path: string;
+};
+
+export interface EzspNative extends EzspNativeCommands {
+    /**
+     * `init`, `start` and `stop` called from a callback delivered synchronously (tick run by the event loop)
+     * take effect once that tick returns, in call order. `start` then returns undefined, `async.start` resolves with the status.
+     */
     init(
         ashHostConfig: {
             /** serial port name | char[40] */
@@ -179,11 +741,176 @@ export interface EzspNative {
              * - 3: no reset - for testing (ASH_RESET_METHOD_NONE)
              */
             resetMethod: 0 | 1 | 2 | 3;
+            /**
+             * run the ASH/EZSP host stack on a dedicated native thread that owns the serial port,
+             * instead of ticking it from the JS thread every 1ms. The thread sleeps until serial data or the next ASH deadline.
+             * Commands are queued to it and run between ticks, in call order: `async` variants leave the JS thread free,
+             * sync ones block it until their response (without holding up the thread's ticks)
+             */
+            ioThread?: boolean;
+            /**
+             * tick the host stack on the JS thread only when the serial port is readable or an ASH deadline
+             * (ack timeout, `nrTime`, `timeRst`) is due, instead of every 1ms (ignored with `ioThread`)
+             */
+            eventDriven?: boolean;
+            /**
+             * deliver `incomingMessage`, `zdoResponse` and `messageSent` events as Buffers (fixed-layout header + message contents)
+             * instead of objects, decode with `EzspBinaryEvent`
+             */
+            binaryEvents?: boolean;
+            /**
+             * deliver events as arrays (`EzspEventBatchCallback`), one call for all events produced during a tick
+             * - maxSize: max events per call, default 64
+             * - maxDelay: max time (ms) an event can be held to accumulate more, over multiple ticks, default 0
+             */
+            eventBatch?: { maxSize?: number; maxDelay?: number };
+            /** time (ms) after which a `sendTracked` without `messageSent` is rejected, default 30000 */
+            deliveryTimeout?: number;
+            /**
+             * drop incoming messages repeating a (sender, APS counter, cluster, source endpoint) with the same payload seen within this many ms
+             * (APS retries, relayed broadcasts), before any event is created. Default 0 (disabled)
+             */
+            duplicateWindow?: number;
+            /**
+             * drop Green Power frames repeating the (frame counter, sequence number, command) last forwarded for their source ID
+             * within this many ms (GPDs repeat each frame, proxies relay them too). Default 0 (disabled)
+             */
+            gpDuplicateWindow?: number;
+            /**
+             * hold ZCL Report Attributes received within `interval` ms of the previous delivery for the same sender/endpoint/cluster,
+             * then deliver them as one report with the latest value of each attribute (and the APS frame, TSN and LQI of the latest).
+             * The first report after a quiet interval is delivered immediately.
+             * Reports with collection-type (array, structure, set, bag) values are delivered as is.
+             * Any other frame from the same sender/endpoint/cluster is delivered after the reports held for it.
+             * - interval: minimum ms between two deliveries per sender/endpoint/cluster
+             * - maxSources: sender/endpoint/cluster tracked at once, default 256, reports of others are delivered as is
+             */
+            reportCoalescing?: { interval: number; maxSources?: number };
+            /**
+             * throttle `send`, `sendBatch` and `sendTracked` (not the raw `ezspSend*` commands) with a window of sends awaiting `messageSent`,
+             * halved on NCP overflow/queue full errors and regrown as `messageSent` arrive.
+             * Sends over the window are queued (status `SL_STATUS_IN_PROGRESS`, `messageSent` follows), or dropped once the queue is full
+             * (status `SL_STATUS_BUSY`). Sends still queued on `init`, `start` or `stop` get a `messageSent` with `SL_STATUS_ABORT`.
+             * Queued sends are released by priority class: high (ZDO), normal, bulk (`bulkClusters`), weighted round-robin per `quotas`.
+             * - minWindow: 1-255, default 1
+             * - maxWindow: initial window, minWindow-255, default 8
+             * - maxQueued: all classes, 0-65535, default 256
+             * - quotas: sends released per round for [high, normal, bulk], 1-255 each, default [4, 2, 1]
+             * - bulkClusters: cluster IDs sent as bulk, default [0x0019] (OTA Upgrade)
+             */
+            congestionControl?: {
+                minWindow?: number;
+                maxWindow?: number;
+                maxQueued?: number;
+                quotas?: [high: number, normal: number, bulk: number];
+                bulkClusters?: number[];
+            };
         },
-        callback?: EzspEventCallback,
+        callback?: EzspEventCallback | EzspBinaryEventCallback | EzspEventBatchCallback | EzspBinaryEventBatchCallback,
     ): undefined;
-    start(): number;
     stop(): undefined;
+    /** Wakeup/tick counters since last `start` */
+    getTickStats(): EzspTickStats;
+    /** Message contents pool counters (events Buffers are external, backed by pooled slots) */
+    getPayloadPoolStats(): EzspPayloadPoolStats;
+    /** Congestion control state and counters since last `init`/`start` */
+    getCongestionStats(): EzspCongestionStats;
+    /**
+     * Latency of EZSP commands (frame sent to matching response), per frame ID, since load or last reset.
+     * @param reset Clear after reading
+     */
+    getCommandStats(reset?: boolean): EzspCommandStats[];
+    /**
+     * ASH link counters (cumulative since load, diff successive reads for rates) and ack timing.
+     * Never waits for a command in flight: returns the previous read while one holds the stack.
+     */
+    getAshStats(): EzspAshStats;
+    /**
+     * Record every ASH frame in both directions (raw serial bytes, monotonic timestamps) to a binary file, see `readCapture`.
+     * Frames go through a ring buffer drained by a background thread: serial I/O never waits on disk, frames are dropped if the ring fills up.
+     * Independent of `init`/`stop` (spans NCP resets), ends with `stopCapture` or process exit.
+     * @param path Truncated if it exists
+     * @param bufferSize Ring buffer size (bytes, rounded up to a power of two), 64 KiB-64 MiB, default 1 MiB
+     */
+    startCapture(path: string, bufferSize?: number): void;
+    /**
+     * Stop recording, flush and close the file (a frame still incomplete is not written). No-op if not capturing.
+     * @returns Final stats
+     */
+    stopCapture(): EzspCaptureStats;
+    getCaptureStats(): EzspCaptureStats;
+    /**
+     * Time the binding blocks the JS thread, not visible to Node's event loop delay monitoring.
+     * @param reset Clear the window and `worstStall` after reading
+     */
+    getLoopStats(reset?: boolean): EzspLoopStats;
+    /**
+     * Replace the incoming message filters, evaluated in order (first match wins) before `incomingMessage`/`zdoResponse` events are created.
+     * Messages matching no filter are delivered.
+     */
+    setMessageFilters(filters: EzspMessageFilter[]): void;
+    /**
+     * Matches per filter, in `setMessageFilters` order
+     * @param reset Zero the counters after reading
+     */
+    getMessageFilterStats(reset?: boolean): number[];
+    /** Duplicate suppression (`duplicateWindow`) counters since last `init` */
+    getDuplicateStats(): EzspDuplicateStats;
+    /** Green Power deduplication (`gpDuplicateWindow`) table, one entry per source ID, unordered */
+    getGpDedupTable(): EzspGpDedupEntry[];
+    /** Report coalescing (`reportCoalescing`) state and counters since last `init` */
+    getReportCoalescingStats(): EzspReportCoalescingStats;
+    /**
+     * Emit `count` synthetic `stackStatus` events to the `init` callback, for benchmarking event delivery.
+     * Bench builds only (`npm run build:gyp:bench`), as the other `bench*`.
+     * @param direct true: synchronous delivery (as from a tick run by the event loop), false: through the thread-safe function
+     */
+    benchEventDispatch?(count: number, direct: boolean): undefined;
+    /**
+     * Create `count` `incomingMessage`-like event objects, for benchmarking event marshalling.
+     * @param cached true: cached keys and all properties defined at once, false: incremental `Set` with C string keys
+     */
+    benchEventMarshalling?(count: number, cached: boolean): undefined;
+    /**
+     * Convert an APS frame `count` times, for benchmarking APS frame marshalling.
+     * @param toObject true: native struct to object, false: object to native struct
+     */
+    benchApsFrame?(count: number, toObject: boolean): undefined;
+    /**
+     * Open a raw pseudo-terminal pair, for running the ASH host against an emulated NCP (see `test/ncp-emulator.ts`).
+     * The slave stays open so the master can be read before and after the host opens the port.
+     * Test tooling, Linux and macOS builds only.
+     */
+    openPseudoTerminal?(): EzspPseudoTerminal;
+    /**
+     * Same as `send`, with delivery tracked natively (requires an `init` callback).
+     * `messageTag` is drawn from 0x0080-0xFFFF (all in flight at once if needed), `send` tags stay below
+     * and `ezspSendUnicast`/`ezspSendMulticast`/`ezspSendBroadcast` throw a RangeError for tags in that range while tracked sends are in flight
+     * (a raw send still in flight with such a tag when `sendTracked` is called may settle it).
+     * `messageSent` is still emitted. Tracked sends not settled yet by `stop` reject with "Stopped".
+     * @param timeout ms (at least 1), default `deliveryTimeout`
+     * @returns Resolves on successful `messageSent`, rejects with `EzspDeliveryError` on send failure, failed `messageSent` or timeout
+     */
+    sendTracked(
+        type: number,
+        indexOrDestination: number,
+        apsFrame: SLZigbeeApsFrame | Uint8Array,
+        message: Buffer,
+        alias: number,
+        sequence: number,
+        timeout?: number,
+    ): Promise<EzspDelivery>;
+    /**
+     * Same commands, executed on the libuv threadpool (one at a time, in call order), resolving with the same results.
+     * A sync command called meanwhile runs after them. Those not run yet by `stop` reject with "Stopped".
+     * Invalid arguments still throw synchronously.
+     */
+    async: EzspNativeAsyncCommands;
+}
+
+export interface EzspNativeCommands {
+    /** undefined if deferred (called from a synchronously delivered callback, see `init`) */
+    start(): number | undefined;
 
     // Base
     ezspVersion(desiredProtocolVersion: number): [protocolVersion: number, stackType: number, stackVersion: number];
@@ -232,12 +959,12 @@ export interface EzspNative {
     ezspSendUnicast(
         type: number,
         indexOrDestination: number,
-        apsFrame: SLZigbeeApsFrame,
+        apsFrame: SLZigbeeApsFrame | Uint8Array,
         messageTag: number,
         messageContents: Buffer,
     ): [status: SLStatus, apsSequence: number];
     ezspSendMulticast(
-        apsFrame: SLZigbeeApsFrame,
+        apsFrame: SLZigbeeApsFrame | Uint8Array,
         hops: number,
         broadcastAddr: number,
         alias: number,
@@ -249,7 +976,7 @@ export interface EzspNative {
         alias: number,
         destination: number,
         nwkSequence: number,
-        apsFrame: SLZigbeeApsFrame,
+        apsFrame: SLZigbeeApsFrame | Uint8Array,
         radius: number,
         messageTag: number,
         messageContents: Buffer,
@@ -293,17 +1020,26 @@ export interface EzspNative {
     ezspSetExtendedSecurityBitmask(mask: number): SLStatus;
     ezspGetEndpointFlags(endpoint: number): [status: SLStatus, flags: number];
     ezspGetVersionStruct(): [status: SLStatus, version: SLZigbeeVersion];
-    /** `apsFrame.sequence` is mutated internally based on call */
+    /** `apsFrame.sequence` (or the sequence byte of a packed `apsFrame`) is mutated internally based on call */
     send(
         type: number,
         indexOrDestination: number,
-        apsFrame: SLZigbeeApsFrame,
+        apsFrame: SLZigbeeApsFrame | Uint8Array,
         message: Buffer,
         alias: number,
         sequence: number,
     ): [status: SLStatus, messageTag: number];
+    /**
+     * Same as calling `send` for each entry (in order, a failed entry does not stop the next ones), in one native call.
+     * @param entries `send` arguments, or packed with `packSendBatch` (APS sequences are written back into the packed APS frames)
+     */
+    sendBatch(entries: EzspSendBatchEntry[] | Buffer): [status: SLStatus[], messageTags: number[]];
 }
 
+export type EzspNativeAsyncCommands = {
+    [K in keyof EzspNativeCommands]: (...args: Parameters<EzspNativeCommands[K]>) => Promise<ReturnType<EzspNativeCommands[K]>>;
+};
+
 /**
  * Native binding prebuild loaded via node-gyp-build.
  *
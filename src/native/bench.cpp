@@ -0,0 +1,177 @@
+/**
+ * Native microbenchmark of the frame helpers (`frames.h`), no serial port nor Node.js involved.
+ *
+ * Build and run: `npm run bench:native` (builds this target only, the SDK is neither patched nor compiled).
+ * `build/` is configured back without `ezsp_bench` afterwards, so a later addon build has no `bench*` exports.
+ * Run again:     `build/Release/ezsp_bench [iterations]`
+ *
+ * Reports time and heap allocations (operator new) per call.
+ * Helpers taking or returning JavaScript values are measured by `test/marshalling.bench.ts`.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "frames.h"
+
+#define BENCH_DEFAULT_ITERATIONS 10000000
+
+// #region Allocation counting
+
+// Replaces the global operator new of the executable, libstdc++ internals included
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+
+    void *ptr = malloc(size ? size : 1);
+
+    if (!ptr)
+    {
+        abort();
+    }
+
+    return ptr;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+// #endregion Allocation counting
+
+/**
+ * Keep a value (and the computation of it) from being optimized away
+ */
+template <typename T> static inline void DoNotOptimize(const T &value) { asm volatile("" : : "r,m"(value) : "memory"); }
+
+/**
+ * Time `iterations` calls of `fn`, after a warm up call.
+ */
+template <typename Fn> static void Run(const char *name, uint64_t iterations, Fn fn)
+{
+    fn();
+
+    size_t allocationsBefore = allocations;
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        fn();
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    size_t allocated = allocations - allocationsBefore;
+
+    printf("%-28s %10.2f ns/op %10.3f allocs/op\n", name, static_cast<double>(elapsed) / iterations, static_cast<double>(allocated) / iterations);
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t iterations = argc > 1 ? strtoull(argv[1], nullptr, 10) : BENCH_DEFAULT_ITERATIONS;
+
+    if (iterations == 0)
+    {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%llu iterations\n", static_cast<unsigned long long>(iterations));
+
+    const uint8_t eui64[8] = {0x78, 0x56, 0x34, 0x12, 0x00, 0x4b, 0x12, 0x00};
+    const std::string eui64String = "0x00124b0012345678";
+
+    Run("Eui64ToHexString", iterations,
+        [&]()
+        {
+            char hexString[19];
+            Eui64ToHexString(eui64, hexString);
+            DoNotOptimize(hexString);
+        });
+
+    Run("Eui64FromHexString", iterations,
+        [&]()
+        {
+            uint8_t parsed[8];
+            DoNotOptimize(Eui64FromHexString(eui64String, parsed));
+            DoNotOptimize(parsed);
+        });
+
+    sl_zigbee_aps_frame_t apsFrame = {0};
+    apsFrame.profileId = 0x0104;
+    apsFrame.clusterId = 0x0006;
+    apsFrame.sourceEndpoint = 0x01;
+    apsFrame.destinationEndpoint = 0x01;
+    apsFrame.options = 0x0140;
+    apsFrame.sequence = 0x2a;
+    uint8_t packedApsFrame[PACKED_APS_FRAME_SIZE];
+
+    Run("WriteApsFrame", iterations,
+        [&]()
+        {
+            WriteApsFrame(packedApsFrame, &apsFrame);
+            DoNotOptimize(packedApsFrame);
+        });
+
+    Run("ReadApsFrame", iterations,
+        [&]()
+        {
+            sl_zigbee_aps_frame_t read;
+            ReadApsFrame(packedApsFrame, &read);
+            DoNotOptimize(read);
+        });
+
+    // Report Attributes, OnOff = 1
+    const uint8_t zclMessage[] = {0x18, 0x2a, 0x0a, 0x00, 0x00, 0x10, 0x01};
+
+    Run("ParseZclHeader", iterations, [&]() { DoNotOptimize(ParseZclHeader(zclMessage, sizeof(zclMessage))); });
+
+    // Touchlink scan request, broadcast to long destination
+    const uint8_t interpanMessage[] = {
+        0x01, 0xcc, 0x01,                                     // MAC frame control (long dest/source), sequence
+        0xff, 0xff,                                           // dest PAN ID
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,       // long dest
+        0x34, 0x12,                                           // source PAN ID
+        0x78, 0x56, 0x34, 0x12, 0x00, 0x4b, 0x12, 0x00,       // long source
+        0x0b, 0x00,                                           // stub NWK frame control
+        0x0b,                                                 // inter-PAN APS frame control (broadcast)
+        0x00, 0x10,                                           // cluster ID (Touchlink)
+        0x5e, 0xc0,                                           // profile ID (ZLL)
+        0x11, 0x01, 0x00, 0xef, 0xbe, 0xad, 0xde, 0x02, 0x33, // ZCL scan request
+    };
+
+    Run("ParseInterpanMessage", iterations,
+        [&]()
+        {
+            InterpanMessage interpan;
+            DoNotOptimize(ParseInterpanMessage(interpanMessage, sizeof(interpanMessage), &interpan));
+            DoNotOptimize(interpan);
+        });
+
+    // GP switch toggle
+    sl_zigbee_gp_params_t gpParams = {};
+    gpParams.addr.applicationId = SL_ZIGBEE_GP_APPLICATION_SOURCE_ID;
+    gpParams.addr.id.sourceId = 0x0155f47a;
+    gpParams.gpdfSecurityLevel = 2;
+    gpParams.gpdfSecurityKeyType = 4;
+    gpParams.gpdSecurityFrameCounter = 1234;
+    gpParams.sequenceNumber = 0x42;
+    gpParams.gpdCommandId = 0x22;
+
+    Run("BuildGpNotification", iterations,
+        [&]()
+        {
+            sl_zigbee_aps_frame_t gpApsFrame;
+            uint8_t notification[UINT8_MAX];
+            DoNotOptimize(BuildGpNotification(&gpParams, &gpApsFrame, notification));
+            DoNotOptimize(notification);
+        });
+
+    return 0;
+}
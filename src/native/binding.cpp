@@ -11,7 +11,27 @@
 #include <cstring>
 #include <cstdio>
 #include <cstdarg>
+#include <cerrno>
+#include <cstdlib>
+#include <cmath>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <future>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <poll.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
 #include <uv.h>
 
 // Silicon Labs SDK headers
@@ -24,63 +44,16 @@ extern "C"
 #include "ezsp-host-common.h"
 #include "ezsp-host-io.h"
 #include "ash-host.h"
+#include "ash-common.h"
 #include "ezsp.h"
 #include "serial-interface.h"
 #include "ezsp-protocol.h"
 #include "ezsp-host-priv.h"
 }
 
-#define simulatedTimePasses()
-
-// #region InterPAN helpers
-
-// NWK stub frame has two control bytes.
-#define STUB_NWK_SIZE 2
-#define STUB_NWK_FRAME_CONTROL 0x000B
-
-// Interpan APS Unicast
-//  - Frame Control   (1-byte)
-//  - Cluster ID      (2-bytes)
-//  - Profile ID      (2-bytes)
-#define INTERPAN_APS_UNICAST_SIZE 5
-
-// Interpan APS Multicast
-//  - Frame Control   (1-byte)
-//  - Group ID        (2-bytes)
-//  - Cluster ID      (2-bytes)
-//  - Profile ID      (2-bytes)
-#define INTERPAN_APS_MULTICAST_SIZE 7
-
-#define MIN_STUB_APS_SIZE (INTERPAN_APS_UNICAST_SIZE)
-
-#define INTERPAN_APS_FRAME_TYPE 0x03
-
-// The only allowed APS FC value (without the delivery mode subfield)
-#define INTERPAN_APS_FRAME_CONTROL_NO_DELIVERY_MODE (INTERPAN_APS_FRAME_TYPE)
+#include "frames.h"
 
-#define INTERPAN_APS_FRAME_DELIVERY_MODE_MASK 0x0C
-#define INTERPAN_APS_FRAME_SECURITY 0x20
-
-#define SL_ZIGBEE_AF_INTER_PAN_UNICAST 0x00u
-#define SL_ZIGBEE_AF_INTER_PAN_BROADCAST 0x08u
-#define SL_ZIGBEE_AF_INTER_PAN_MULTICAST 0x0Cu
-
-#define MAC_ACK_REQUIRED 0x0020
-
-#define MAC_FRAME_TYPE_DATA 0x0001
-
-#define MAC_FRAME_SOURCE_MODE_SHORT 0x8000
-#define MAC_FRAME_SOURCE_MODE_LONG 0xC000
-
-#define MAC_FRAME_DESTINATION_MODE_SHORT 0x0800
-#define MAC_FRAME_DESTINATION_MODE_LONG 0x0C00
-
-// The two possible incoming MAC frame controls.
-// Using short source address is not allowed.
-#define SHORT_DEST_FRAME_CONTROL (MAC_FRAME_TYPE_DATA | MAC_FRAME_DESTINATION_MODE_SHORT | MAC_FRAME_SOURCE_MODE_LONG)
-#define LONG_DEST_FRAME_CONTROL (MAC_FRAME_TYPE_DATA | MAC_FRAME_DESTINATION_MODE_LONG | MAC_FRAME_SOURCE_MODE_LONG)
-
-// #endregion InterPAN helpers
+#define simulatedTimePasses()
 
 // Forward declarations
 namespace EzspNapi
@@ -88,6 +61,28 @@ namespace EzspNapi
     Napi::Value Init(const Napi::CallbackInfo &info);
     Napi::Value Start(const Napi::CallbackInfo &info);
     Napi::Value Stop(const Napi::CallbackInfo &info);
+    Napi::Value GetTickStats(const Napi::CallbackInfo &info);
+    Napi::Value GetPayloadPoolStats(const Napi::CallbackInfo &info);
+    Napi::Value GetCongestionStats(const Napi::CallbackInfo &info);
+    Napi::Value GetCommandStats(const Napi::CallbackInfo &info);
+    Napi::Value GetLoopStats(const Napi::CallbackInfo &info);
+    Napi::Value SetMessageFilters(const Napi::CallbackInfo &info);
+    Napi::Value GetMessageFilterStats(const Napi::CallbackInfo &info);
+    Napi::Value GetDuplicateStats(const Napi::CallbackInfo &info);
+    Napi::Value GetGpDedupTable(const Napi::CallbackInfo &info);
+    Napi::Value GetReportCoalescingStats(const Napi::CallbackInfo &info);
+    Napi::Value GetAshStats(const Napi::CallbackInfo &info);
+    Napi::Value StartCapture(const Napi::CallbackInfo &info);
+    Napi::Value StopCapture(const Napi::CallbackInfo &info);
+    Napi::Value GetCaptureStats(const Napi::CallbackInfo &info);
+#ifdef EZSP_BENCH
+    Napi::Value BenchEventDispatch(const Napi::CallbackInfo &info);
+    Napi::Value BenchEventMarshalling(const Napi::CallbackInfo &info);
+    Napi::Value BenchApsFrame(const Napi::CallbackInfo &info);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    Napi::Value OpenPseudoTerminal(const Napi::CallbackInfo &info);
+#endif
 
     // Base commands
     Napi::Value Version(const Napi::CallbackInfo &info);
@@ -154,884 +149,5410 @@ namespace EzspNapi
     Napi::Value GetVersionStruct(const Napi::CallbackInfo &info);
 }
 
+// Tick interval in event-driven mode while the ASH connection is (re)established (RSTACK wait, `timeRst`)
+#define EVENT_DRIVEN_RESET_INTERVAL_MS 10
+// Min delay of a time-driven tick, an overdue ack timer or `nrTime` 0 would otherwise spin
+#define EVENT_DRIVEN_MIN_INTERVAL_MS 1
+// Max events per callback invocation in batch mode, unless specified
+#define EVENT_BATCH_DEFAULT_MAX_SIZE 64
+// Time after which a tracked send (`sendTracked`) without `messageSent` is rejected, unless specified
+#define DELIVERY_DEFAULT_TIMEOUT_MS 30000
+// Congestion control defaults: window bounds (sends awaiting `messageSent`) and max sends queued over it
+#define CONGESTION_DEFAULT_MIN_WINDOW 1
+#define CONGESTION_DEFAULT_MAX_WINDOW 8
+#define CONGESTION_DEFAULT_MAX_QUEUED 256
+// Congestion control option bounds
+#define CONGESTION_MAX_WINDOW 255
+#define CONGESTION_MAX_QUEUED 65535
+#define CONGESTION_MAX_QUOTA 255
+// Sends released per round for each priority class while queued (high, normal, bulk), unless specified
+#define CONGESTION_DEFAULT_QUOTAS {4, 2, 1}
+// Cluster queued as bulk unless specified: OTA Upgrade
+#define CONGESTION_DEFAULT_BULK_CLUSTER 0x0019
+// Min time between two window decreases
+#define CONGESTION_DECREASE_HOLDOFF_MS 100
+// Time without any `messageSent` after which a full window is considered lost
+#define CONGESTION_STALL_MS 10000
+// Loop stats histograms cover the last `LOOP_STATS_INTERVALS` intervals (50-60s), the oldest dropped as a new one starts
+#define LOOP_STATS_INTERVAL_MS 10000
+#define LOOP_STATS_INTERVALS 6
+
+// Work run on the JS thread through `tsfn`
+using JsCall = std::function<void(Napi::Env, Napi::Function)>;
+
+// Also called with a null env for calls still queued when the env goes away: not run, but freed with what they hold (payload slots...)
+static void CallJs(Napi::Env env, Napi::Function callback, std::nullptr_t *, JsCall *call)
+{
+    if (static_cast<napi_env>(env) != nullptr)
+    {
+        (*call)(env, callback);
+    }
+
+    delete call;
+}
+
+using CallbackTsfn = Napi::TypedThreadSafeFunction<std::nullptr_t, JsCall, CallJs>;
+
 // Global reference to callback function
-static Napi::ThreadSafeFunction tsfn;
+static CallbackTsfn tsfn;
+// Same callback, for synchronous delivery from ticks run by the libuv loop (see `EmitEvent`)
+static Napi::FunctionReference jsCallback;
+static std::unique_ptr<Napi::AsyncContext> jsCallbackContext;
+// Set while the JS thread ticks from a libuv callback, guarded by `stackMutex`
+static bool directDispatch = false;
+// Events handed to `tsfn` and not delivered yet, direct delivery waits for them to keep events in order
+static std::atomic<uint32_t> tsfnEventsQueued{0};
+// Set while the JS thread ticks from a libuv callback: `init`, `start` and `stop` called from its callbacks
+// (stack and dispatch state in use) are queued to run in order once it returns
+static bool loopTickRunning = false;
+static std::vector<std::function<void(void)>> deferredLifecycle;
+// Incoming/sent messages as Buffers (opt-in via `binaryEvents`)
+static bool binaryEventsEnabled = false;
+// Event batching (opt-in via `eventBatch`): events delivered as arrays, pending ones guarded by `stackMutex`
+using EventBuilderFn = std::function<Napi::Value(Napi::Env)>;
+static bool eventBatchEnabled = false;
+static size_t eventBatchMaxSize = EVENT_BATCH_DEFAULT_MAX_SIZE;
+static uint32_t eventBatchMaxDelayMs = 0;
+static std::vector<EventBuilderFn> pendingEvents;
+static uint64_t pendingEventsSince = 0;
 static bool initialized = false;
-// Poll handle for ezsp tick
-static uv_timer_t tickTimer;
+// Poll handle for ezsp tick, allocated per start (a closing one can't be re-initialized)
+static uv_timer_t *tickTimer = nullptr;
 static bool tickTimerActive = false;
 
+// The SDK host stack is not thread-safe, every access to it must hold this lock.
+// Recursive since commands can be issued from within callbacks.
+static std::recursive_mutex stackMutex;
+// Dedicated I/O thread running the host stack (opt-in via `ioThread`)
+static bool ioThreadEnabled = false;
+static std::thread ioThread;
+static std::atomic<bool> ioThreadRunning{false};
+// Work posted to the I/O thread (commands, see `RunOnStack`), run in order between ticks
+struct IoTask
+{
+    std::function<void(void)> run;
+    std::promise<bool> done;
+};
+static std::mutex ioTasksMutex;
+static std::deque<std::shared_ptr<IoTask>> ioTasks;
+// Self-pipe waking the I/O thread from `poll` when a task is posted or on stop
+static int ioWakeupPipe[2] = {-1, -1};
+// Event-driven tick on the JS thread (opt-in via `eventDriven`): serial fd readability + next ASH deadline
+static bool eventDrivenEnabled = false;
+static uv_poll_t *serialPoll = nullptr;
+static int serialPollFd = -1;
+
+// Wakeup/tick counters, reset on start
+static struct
+{
+    std::atomic<uint64_t> pollWakeups;
+    std::atomic<uint64_t> timerWakeups;
+    std::atomic<uint64_t> ticks;
+} tickStats;
+
 static uint8_t ezspSequenceNumber = 0;
 
-// Tick callback that checks for EZSP events
-static void ezspTickCallback(uv_timer_t *handle)
+extern "C" void sl_zigbee_ezsp_tick(void);
+
+static void ezspTick(void)
 {
     // Call EZSP tick function to process any pending callbacks/events
-    extern void sl_zigbee_ezsp_tick(void);
     sl_zigbee_ezsp_tick();
+    tickStats.ticks.fetch_add(1, std::memory_order_relaxed);
 }
 
-static uint8_t ezspNextSequence(void) { return ((++ezspSequenceNumber) & 0x7F); }
+static void FlushDueEvents(void);
+static uint64_t EventBatchDelayMs(void);
+static void DrainQueuedSends(void);
+static void FlushDueReports(void);
+static uint64_t ReportFlushDelayMs(void);
+static uint64_t CongestionDelayMs(void);
+static void LoopStatsRecordTick(uint64_t startNs);
+static void LoopStatsRecordDispatch(uint64_t startNs);
 
-// #region Helper Functions for Type Conversions
+/**
+ * Synchronous delivery needs the callback, and must not overtake events still queued to `tsfn`
+ * (emitted by commands outside of a tick): those are left to drain first, this tick's events queue behind them.
+ */
+static bool DirectDispatchReady(void) { return !jsCallback.IsEmpty() && jsCallbackContext && tsfnEventsQueued.load() == 0; }
 
 /**
- * Convert uint8_t array to JavaScript array of numbers
- * @param env Napi environment
- * @param data Pointer to uint8_t array
- * @param length Array length
- * @return JavaScript array
+ * Queue an `init`/`start`/`stop` call made by a callback of the running tick.
+ * An error it throws can't reach its caller anymore, it is reported as an uncaught exception.
  */
-inline Napi::Array Uint8ArrayToNumberArray(Napi::Env env, const uint8_t *data, size_t length)
+static void DeferLifecycle(Napi::Env env, std::function<void(Napi::Env)> call)
 {
-    Napi::Array arr = Napi::Array::New(env, length);
+    deferredLifecycle.push_back(
+        [env, call = std::move(call)]()
+        {
+            Napi::HandleScope scope(env);
+            // processes microtasks on return (e.g. the Promise of a deferred `async.start`)
+            Napi::AsyncContext context(env, "EZSP Lifecycle");
+            Napi::CallbackScope callbackScope(env, context);
 
-    for (size_t i = 0; i < length; i++)
+            call(env);
+
+            if (env.IsExceptionPending())
+            {
+                napi_fatal_exception(env, env.GetAndClearPendingException().Value());
+            }
+        });
+}
+
+// Run the calls deferred by the tick that just returned, in call order
+static void RunDeferredLifecycle(void)
+{
+    std::vector<std::function<void(void)>> calls;
+    calls.swap(deferredLifecycle);
+
+    for (std::function<void(void)> &call : calls)
     {
-        arr[i] = Napi::Number::New(env, data[i]);
+        call();
     }
+}
 
-    return arr;
+// Tick from a libuv callback on the JS thread (stack lock held), callbacks are delivered to JS synchronously
+static void ezspTickOnLoop(void)
+{
+    uint64_t start = uv_hrtime();
+
+    loopTickRunning = true;
+    directDispatch = DirectDispatchReady();
+    ezspTick();
+    DrainQueuedSends();
+    FlushDueReports();
+    FlushDueEvents();
+    directDispatch = false;
+    loopTickRunning = false;
+
+    LoopStatsRecordTick(start);
+    RunDeferredLifecycle();
 }
 
-/**
- * Convert JavaScript array or Buffer to uint8_t array
- * @param env Napi environment
- * @param jsValue JavaScript array or buffer
- * @param output Output buffer pointer
- * @param maxLength Maximum output buffer size
- * @return true if copied, false on error
- */
-inline bool Uint8ArrayFromNumberArray(Napi::Env env, const Napi::Value &jsValue, uint8_t *output, size_t maxLength)
+// Tick callback that checks for EZSP events
+static void ezspTickCallback(uv_timer_t *handle)
 {
-    if (jsValue.IsArray())
+    tickStats.timerWakeups.fetch_add(1, std::memory_order_relaxed);
+
+    // an async command is running, it services ASH itself while waiting for its response
+    std::unique_lock<std::recursive_mutex> lock(stackMutex, std::try_to_lock);
+
+    if (lock.owns_lock())
     {
-        Napi::Array arr = jsValue.As<Napi::Array>();
+        ezspTickOnLoop();
+    }
+}
 
-        if (arr.Length() != maxLength)
-        {
-            return false; // Error: mismatching array length and given length
-        }
+// #region Event-driven tick
 
-        for (size_t i = 0; i < maxLength; i++)
-        {
-            Napi::Value val = arr[i];
+static void ezspScheduleNextTick(void);
 
-            if (val.IsNumber())
-            {
-                output[i] = val.As<Napi::Number>().Uint32Value();
-            }
-            else
-            {
-                return false; // Error: non-number in array
-            }
-        }
+static void serialPollClose(void)
+{
+    if (serialPoll)
+    {
+        uv_poll_stop(serialPoll);
+        uv_close((uv_handle_t *)serialPoll, [](uv_handle_t *handle) { delete (uv_poll_t *)handle; });
 
-        return true;
+        serialPoll = nullptr;
     }
 
-    return false; // Error: not buffer or array
+    serialPollFd = -1;
 }
 
 /**
- * Convert EUI64 from 8-byte array to hex string format (0xXXXXXXXXXXXXXXXX)
- * @param eui64 Input buffer (8 bytes)
- * @param hexString Output buffer (must be at least 19 bytes: "0x" + 16 hex chars + null terminator)
+ * Time until the host stack next needs servicing without any new data on the serial fd.
+ * @return Delay in milliseconds, 0 if work is already waiting
  */
-inline void Eui64ToHexString(const uint8_t *eui64, char *hexString)
+static uint64_t ezspNextDeadlineMs(void)
 {
-    snprintf(hexString, 19, "0x%02x%02x%02x%02x%02x%02x%02x%02x", eui64[7], eui64[6], eui64[5], eui64[4], eui64[3], eui64[2], eui64[1], eui64[0]);
-}
+    uint16_t available = 0;
 
-/**
- * Convert EUI64 from hex string (0xXXXXXXXXXXXXXXXX) to 8-byte array
- * @param env Napi environment
- * @param hexString JavaScript string in format "0xXXXXXXXXXXXXXXXX"
- * @param eui64 Output buffer (8 bytes)
- * @return true on success, false on error
- */
-inline bool Eui64FromHexString(Napi::Env env, const Napi::String &hexString, uint8_t *eui64)
-{
-    std::string str = hexString.Utf8Value();
+    // callbacks received but not dispatched yet (a tick dispatches a bounded number),
+    // or bytes already read off the fd but not processed: the fd won't signal them again
+    if (serialPendingCallbacks() > 0 || ezspSerialReadAvailable(&available) == SL_ZIGBEE_EZSP_SUCCESS)
+    {
+        return 0;
+    }
+
+    uint64_t delay;
 
-    // Expected format: "0x" + 16 hex chars
-    if (str.length() != 18 || str[0] != '0' || str[1] != 'x')
+    if (!ashIsConnected())
     {
-        return false;
+        // waiting for RSTACK (`timeRst`) or retrying a reset, both time-driven
+        delay = EVENT_DRIVEN_RESET_INTERVAL_MS;
     }
+    else if (ashAckTimerIsRunning())
+    {
+        // retransmit on ack timeout (adaptive, between `ackTimeMin` and `ackTimeMax`)
+        uint16_t elapsed = halCommonGetInt16uMillisecondTick() - ashAckTimer;
 
-    // Parse in reverse order (little-endian)
-    for (int i = 0; i < 8; i++)
+        delay = elapsed >= ashGetAckPeriod() ? 0 : (ashGetAckPeriod() - elapsed);
+    }
+    else
     {
-        const char *hexByte = str.c_str() + 2 + (14 - i * 2); // Start from end
-        char temp[3] = {hexByte[0], hexByte[1], '\0'};
-        eui64[i] = (uint8_t)strtol(temp, nullptr, 16);
+        // refresh of a set nFlag (`nrTime`), otherwise nothing is due
+        delay = ashHostConfig.nrTime;
     }
 
-    return true;
+    return std::max<uint64_t>(delay, EVENT_DRIVEN_MIN_INTERVAL_MS);
 }
 
-/**
- * Convert sl_zigbee_aps_frame_t from JavaScript object to native struct
- * @param env Napi environment
- * @param apsFrameObj JavaScript object `SLZigbeeApsFrame`
- * @param apsFrame Output native struct pointer
- * @return true on success, false on invalid object
- */
-inline bool ApsFrameFromObject(Napi::Env env, const Napi::Object &apsFrameObj, sl_zigbee_aps_frame_t *apsFrame)
+static void serialPollCallback(uv_poll_t *handle, int status, int events)
 {
-    if (!apsFrameObj.Has("profileId") || !apsFrameObj.Has("clusterId") || !apsFrameObj.Has("sourceEndpoint") ||
-        !apsFrameObj.Has("destinationEndpoint") || !apsFrameObj.Has("options") || !apsFrameObj.Has("groupId") || !apsFrameObj.Has("sequence"))
+    tickStats.pollWakeups.fetch_add(1, std::memory_order_relaxed);
+
+    std::unique_lock<std::recursive_mutex> lock(stackMutex, std::try_to_lock);
+
+    if (!lock.owns_lock())
     {
-        return false;
+        // an async command is reading the port, re-armed on its completion
+        uv_poll_stop(handle);
+        return;
     }
 
-    memset(apsFrame, 0, sizeof(sl_zigbee_aps_frame_t));
-    apsFrame->profileId = apsFrameObj.Get("profileId").As<Napi::Number>().Uint32Value();
-    apsFrame->clusterId = apsFrameObj.Get("clusterId").As<Napi::Number>().Uint32Value();
-    apsFrame->sourceEndpoint = apsFrameObj.Get("sourceEndpoint").As<Napi::Number>().Uint32Value();
-    apsFrame->destinationEndpoint = apsFrameObj.Get("destinationEndpoint").As<Napi::Number>().Uint32Value();
-    apsFrame->options = apsFrameObj.Get("options").As<Napi::Number>().Uint32Value();
-    apsFrame->groupId = apsFrameObj.Get("groupId").As<Napi::Number>().Uint32Value();
-    apsFrame->sequence = apsFrameObj.Get("sequence").As<Napi::Number>().Uint32Value();
-    apsFrame->radius = apsFrameObj.Has("radius") ? apsFrameObj.Get("radius").As<Napi::Number>().Uint32Value() : 0;
-
-    return true;
+    ezspTickOnLoop();
+    ezspScheduleNextTick();
 }
 
-/**
- * Convert sl_zigbee_aps_frame_t from native struct to JavaScript object
- * @param env Napi environment
- * @param apsFrame Native struct pointer
- * @return JavaScript object `SLZigbeeApsFrame`
- */
-inline Napi::Object ApsFrameToObject(Napi::Env env, const sl_zigbee_aps_frame_t *apsFrame)
+static void deadlineTimerCallback(uv_timer_t *handle)
 {
-    Napi::Object obj = Napi::Object::New(env);
-    obj.Set("profileId", Napi::Number::New(env, apsFrame->profileId));
-    obj.Set("clusterId", Napi::Number::New(env, apsFrame->clusterId));
-    obj.Set("sourceEndpoint", Napi::Number::New(env, apsFrame->sourceEndpoint));
-    obj.Set("destinationEndpoint", Napi::Number::New(env, apsFrame->destinationEndpoint));
-    obj.Set("options", Napi::Number::New(env, apsFrame->options));
-    obj.Set("groupId", Napi::Number::New(env, apsFrame->groupId));
-    obj.Set("sequence", Napi::Number::New(env, apsFrame->sequence));
-    obj.Set("radius", Napi::Number::New(env, apsFrame->radius));
+    tickStats.timerWakeups.fetch_add(1, std::memory_order_relaxed);
 
-    return obj;
+    std::unique_lock<std::recursive_mutex> lock(stackMutex, std::try_to_lock);
+
+    if (!lock.owns_lock())
+    {
+        // re-armed on async command completion
+        return;
+    }
+
+    ezspTickOnLoop();
+    ezspScheduleNextTick();
 }
 
 /**
- * Convert sl_zigbee_sec_man_context_t from JavaScript object to native struct
- * @param env Napi environment
- * @param contextObj JavaScript object `SLZigbeeSecManContext`
- * @param context Output native struct pointer
- * @return true on success, false on invalid object
+ * (Re)arm serial fd readability watch and the timer for the next ASH deadline.
+ * The fd is re-checked since the SDK may re-open the serial port on NCP reset.
  */
-inline bool SecManContextFromObject(Napi::Env env, const Napi::Object &contextObj, sl_zigbee_sec_man_context_t *context)
+static void ezspScheduleNextTick(void)
 {
-    if (!contextObj.Has("coreKeyType") || !contextObj.Has("keyIndex") || !contextObj.Has("derivedType") || !contextObj.Has("eui64") ||
-        !contextObj.Has("multiNetworkIndex") || !contextObj.Has("flags") || !contextObj.Has("psaKeyAlgPermission"))
+    if (!eventDrivenEnabled || !tickTimerActive)
     {
-        return false;
+        return;
     }
 
-    memset(context, 0, sizeof(sl_zigbee_sec_man_context_t));
-    context->core_key_type = contextObj.Get("coreKeyType").As<Napi::Number>().Uint32Value();
-    context->key_index = contextObj.Get("keyIndex").As<Napi::Number>().Uint32Value();
-    context->derived_type = contextObj.Get("derivedType").As<Napi::Number>().Uint32Value();
-
-    // EUI64 comes as "0x..." hex string
-    Napi::Value eui64Val = contextObj.Get("eui64");
+    int fd = ezspSerialGetFd();
 
-    if (eui64Val.IsString())
+    if (fd == serialPollFd && serialPoll)
     {
-        if (!Eui64FromHexString(env, eui64Val.As<Napi::String>(), context->eui64))
+        // may have been stopped while an async command was running
+        uv_poll_start(serialPoll, UV_READABLE, serialPollCallback);
+    }
+    else if (fd != serialPollFd)
+    {
+        serialPollClose();
+
+        if (fd >= 0)
         {
-            return false;
+            serialPoll = new uv_poll_t;
+
+            if (uv_poll_init(uv_default_loop(), serialPoll, fd) == 0)
+            {
+                uv_poll_start(serialPoll, UV_READABLE, serialPollCallback);
+
+                serialPollFd = fd;
+            }
+            else
+            {
+                delete serialPoll;
+                serialPoll = nullptr;
+            }
         }
     }
-    else
+
+    // without a watchable fd, fall back to regular ticks
+    uint64_t delay = serialPoll ? std::min({ezspNextDeadlineMs(), EventBatchDelayMs(), ReportFlushDelayMs(), CongestionDelayMs()}) : 1;
+
+    uv_timer_start(tickTimer, deadlineTimerCallback, delay, 0);
+}
+
+// #endregion Event-driven tick
+
+// #region I/O thread
+
+static void ioThreadWakeup(void)
+{
+    uint8_t byte = 0;
+    // a full pipe already wakes the thread
+    ssize_t written = write(ioWakeupPipe[1], &byte, 1);
+    (void)written;
+}
+
+static bool ioWakeupPipeOpen(void)
+{
+    if (pipe(ioWakeupPipe) != 0)
     {
         return false;
     }
 
-    context->multi_network_index = contextObj.Get("multiNetworkIndex").As<Napi::Number>().Uint32Value();
-    context->flags = contextObj.Get("flags").As<Napi::Number>().Uint32Value();
-    context->psa_key_alg_permission = contextObj.Get("psaKeyAlgPermission").As<Napi::Number>().Uint32Value();
+    fcntl(ioWakeupPipe[0], F_SETFL, fcntl(ioWakeupPipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(ioWakeupPipe[1], F_SETFL, fcntl(ioWakeupPipe[1], F_GETFL) | O_NONBLOCK);
 
     return true;
 }
 
-/**
- * Convert sl_zigbee_sec_man_context_t from native struct to JavaScript object
- * @param env Napi environment
- * @param context Native struct pointer
- * @return JavaScript object `SLZigbeeSecManContext`
- */
-inline Napi::Object SecManContextToObject(Napi::Env env, const sl_zigbee_sec_man_context_t *context)
+static void ioWakeupPipeClose(void)
 {
-    Napi::Object obj = Napi::Object::New(env);
-    obj.Set("coreKeyType", Napi::Number::New(env, context->core_key_type));
-    obj.Set("keyIndex", Napi::Number::New(env, context->key_index));
-    obj.Set("derivedType", Napi::Number::New(env, context->derived_type));
-    char hexString[19];
-    Eui64ToHexString(context->eui64, hexString);
-    obj.Set("eui64", Napi::String::New(env, hexString));
-    obj.Set("multiNetworkIndex", Napi::Number::New(env, context->multi_network_index));
-    obj.Set("flags", Napi::Number::New(env, context->flags));
-    obj.Set("psaKeyAlgPermission", Napi::Number::New(env, context->psa_key_alg_permission));
-
-    return obj;
+    for (int &fd : ioWakeupPipe)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
 }
 
 /**
- * Convert sl_zigbee_sec_man_key_t from JavaScript object to native struct
- * @param env Napi environment
- * @param keyObj JavaScript object with `SLZigbeeKeyData`
- * @param key Output native struct pointer
- * @return true on success, false on invalid object
+ * Run the tasks posted so far, on the I/O thread (stack lock held).
  */
-inline bool SecManKeyFromObject(Napi::Env env, const Napi::Object &keyObj, sl_zigbee_sec_man_key_t *key)
+static void RunIoTasks(void)
 {
-    if (!keyObj.Has("contents"))
+    for (;;)
     {
-        return false;
-    }
+        std::shared_ptr<IoTask> task;
 
-    Napi::Value contents = keyObj.Get("contents");
+        {
+            std::lock_guard<std::mutex> lock(ioTasksMutex);
 
-    if (!contents.IsBuffer())
-    {
-        return false;
-    }
+            if (ioTasks.empty())
+            {
+                return;
+            }
 
-    Napi::Buffer<uint8_t> keyBuffer = contents.As<Napi::Buffer<uint8_t>>();
+            task = std::move(ioTasks.front());
+            ioTasks.pop_front();
+        }
 
-    if (keyBuffer.Length() != 16)
-    {
-        return false;
+        task->run();
+        task->done.set_value(true);
     }
-
-    memcpy(key->key, keyBuffer.Data(), 16);
-
-    return true;
 }
 
 /**
- * Convert sl_zigbee_sec_man_key_t from native struct to JavaScript object
- * @param env Napi environment
- * @param key Native struct pointer
- * @return JavaScript object with `SLZigbeeKeyData`
+ * Release the waiters of tasks left over by a stopped I/O thread, without running them.
  */
-inline Napi::Object SecManKeyToObject(Napi::Env env, const sl_zigbee_sec_man_key_t *key)
+static void CancelIoTasks(void)
 {
-    Napi::Object obj = Napi::Object::New(env);
-    obj.Set("contents", Napi::Buffer<uint8_t>::Copy(env, key->key, 16));
+    std::lock_guard<std::mutex> lock(ioTasksMutex);
 
-    return obj;
+    for (std::shared_ptr<IoTask> &task : ioTasks)
+    {
+        task->done.set_value(false);
+    }
+
+    ioTasks.clear();
 }
 
 /**
- * Convert sl_zigbee_key_data_t from JavaScript object to native struct
- * @param env Napi environment
- * @param keyObj JavaScript object with `SLZigbeeKeyData`
- * @param key Output native struct pointer
- * @return true on success, false on invalid object
+ * Run `fn` with exclusive access to the host stack: posted to the I/O thread while it runs (the caller waits for it
+ * without holding the stack lock, ticks go on meanwhile), otherwise under the stack lock on the calling thread.
+ * @return false if the I/O thread stopped before running it
  */
-inline bool ZigbeeKeyDataFromObject(Napi::Env env, const Napi::Object &keyObj, sl_zigbee_key_data_t *key)
+static bool RunOnStack(std::function<void(void)> fn)
 {
-    if (!keyObj.Has("contents"))
+    std::future<bool> done;
+
     {
-        return false;
-    }
+        std::lock_guard<std::mutex> lock(ioTasksMutex);
 
-    Napi::Value contents = keyObj.Get("contents");
+        if (ioThreadRunning.load(std::memory_order_acquire))
+        {
+            auto task = std::make_shared<IoTask>();
+            task->run = std::move(fn);
+            done = task->done.get_future();
 
-    if (!contents.IsBuffer())
-    {
-        return false;
+            ioTasks.push_back(std::move(task));
+        }
     }
 
-    Napi::Buffer<uint8_t> keyBuffer = contents.As<Napi::Buffer<uint8_t>>();
+    if (!done.valid())
+    {
+        std::lock_guard<std::recursive_mutex> lock(stackMutex);
 
-    if (keyBuffer.Length() != 16)
+        fn();
+
+        return true;
+    }
+
+    ioThreadWakeup();
+
+    return done.get();
+}
+
+// I/O thread loop: owns the serial port, runs posted commands and ticks the stack whenever data is available.
+// Sleeps in `poll` until serial data, a posted task, or the next ASH/batch/report deadline.
+// Callbacks reach JS through `tsfn` (unlimited queue, never blocks this thread).
+static void ioThreadLoop(void)
+{
+    while (ioThreadRunning.load(std::memory_order_acquire))
+    {
+        struct pollfd pfds[2] = {{-1, POLLIN, 0}, {ioWakeupPipe[0], POLLIN, 0}};
+        uint64_t timeout;
+
+        {
+            std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+            // commands first, the tick then services the frames they leave awaiting ack
+            RunIoTasks();
+            ezspTick();
+            DrainQueuedSends();
+            FlushDueReports();
+            FlushDueEvents();
+
+            timeout = std::min({ezspNextDeadlineMs(), EventBatchDelayMs(), ReportFlushDelayMs(), CongestionDelayMs()});
+            // negative fd (port closed) is ignored by poll, only the timeout applies
+            pfds[0].fd = ezspSerialGetFd();
+        }
+
+        int ready = poll(pfds, 2, static_cast<int>(std::min<uint64_t>(timeout, INT32_MAX)));
+
+        if (pfds[1].revents & POLLIN)
+        {
+            uint8_t drain[64];
+
+            while (read(ioWakeupPipe[0], drain, sizeof(drain)) > 0)
+            {
+            }
+        }
+
+        if (ready > 0 && (pfds[0].revents & POLLIN))
+        {
+            tickStats.pollWakeups.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (ready == 0)
+        {
+            tickStats.timerWakeups.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+// #endregion I/O thread
+
+/**
+ * Start processing events once EZSP is initialized, on the JS thread.
+ * @param status Result of `sl_zigbee_ezsp_init`
+ */
+static void ezspStartTick(sl_zigbee_ezsp_status_t status)
+{
+    // without a wakeup pipe, falls back to ticking on the JS thread
+    if (status == SL_ZIGBEE_EZSP_SUCCESS && ioThreadEnabled && (ioThreadRunning.load() || ioWakeupPipeOpen()))
+    {
+        // Hand the stack over to the I/O thread
+        if (!ioThreadRunning.exchange(true))
+        {
+            ioThread = std::thread(ioThreadLoop);
+        }
+    }
+    // Start tick timer for EZSP event processing (1ms interval)
+    else if (status == SL_ZIGBEE_EZSP_SUCCESS && !tickTimerActive)
+    {
+        uv_loop_t *loop = uv_default_loop();
+        tickTimer = new uv_timer_t;
+        uv_timer_init(loop, tickTimer);
+
+        tickTimerActive = true;
+
+        if (eventDrivenEnabled)
+        {
+            // tick on serial data and ASH deadlines only
+            ezspScheduleNextTick();
+        }
+        else
+        {
+            uv_timer_start(tickTimer, ezspTickCallback, 1, 1); // 1ms initial, 1ms repeat
+        }
+    }
+}
+
+// #region Command dispatch
+
+// Converts the outcome of a command execution to JS, always on the JS thread
+using CommandResult = std::function<Napi::Value(Napi::Env)>;
+// Calls the SDK, may run off the JS thread (must not touch any JS value)
+using CommandExecute = std::function<CommandResult(void)>;
+
+// Function data flagging the Promise-returning registration of a command binding
+static int asyncCommandMarker;
+
+/**
+ * Runs an async command off the JS thread: on the I/O thread if running, otherwise on the libuv threadpool holding the stack lock.
+ * Commands are queued one at a time to preserve call order, a sync command runs the ones still queued before itself (see `RunCommand`).
+ */
+class CommandWorker : public Napi::AsyncWorker
+{
+public:
+    CommandWorker(Napi::Env env, CommandExecute execute)
+        : Napi::AsyncWorker(env, "EzspCommand"), deferred(Napi::Promise::Deferred::New(env)), execute(std::move(execute))
+    {
+    }
+
+    Napi::Promise GetPromise() { return deferred.Promise(); }
+
+    /**
+     * Call the SDK, once (stack lock held). Its result is marshalled when the worker completes.
+     */
+    void Run(void)
+    {
+        if (ran || cancelled)
+        {
+            return;
+        }
+
+        ran = true;
+        result = execute();
+    }
+
+    /**
+     * Reject with "Stopped" if not run yet (stack lock held).
+     */
+    void Cancel(void) { cancelled = true; }
+
+protected:
+    void Execute() override
+    {
+        RunOnStack([this]() { Run(); });
+
+        // not run: cancelled, or its I/O task was
+        if (!result)
+        {
+            SetError("Stopped");
+        }
+    }
+
+    void OnOK() override
+    {
+        Napi::Env env = Env();
+        Napi::Value value = result(env);
+
+        if (env.IsExceptionPending())
+        {
+            deferred.Reject(env.GetAndClearPendingException().Value());
+        }
+        else
+        {
+            deferred.Resolve(value);
+        }
+
+        OnDone();
+    }
+
+    void OnError(const Napi::Error &error) override
+    {
+        deferred.Reject(error.Value());
+
+        OnDone();
+    }
+
+private:
+    void OnDone(void);
+
+    Napi::Promise::Deferred deferred;
+    CommandExecute execute;
+    CommandResult result;
+    // guarded by `stackMutex`
+    bool ran = false;
+    bool cancelled = false;
+};
+
+// Async commands waiting for their turn, and the queued one (JS thread only)
+static std::deque<CommandWorker *> pendingCommands;
+static CommandWorker *commandInFlight = nullptr;
+
+static void QueueNextCommand(void)
+{
+    if (commandInFlight || pendingCommands.empty())
+    {
+        return;
+    }
+
+    CommandWorker *worker = pendingCommands.front();
+    pendingCommands.pop_front();
+
+    commandInFlight = worker;
+    worker->Queue();
+}
+
+/**
+ * Run the async commands called before a sync one, so it doesn't overtake them (stack lock held).
+ * Off the JS thread only while it waits (I/O thread), the queue can't change meanwhile.
+ */
+static void RunQueuedCommands(void)
+{
+    if (commandInFlight)
+    {
+        commandInFlight->Run();
+    }
+
+    for (CommandWorker *worker : pendingCommands)
+    {
+        worker->Run();
+    }
+}
+
+/**
+ * Reject the async commands not run yet, on stop. They still complete in order, without calling the SDK.
+ */
+static void CancelQueuedCommands(void)
+{
+    std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+    if (commandInFlight)
+    {
+        commandInFlight->Cancel();
+    }
+
+    for (CommandWorker *worker : pendingCommands)
+    {
+        worker->Cancel();
+    }
+}
+
+void CommandWorker::OnDone(void)
+{
+    commandInFlight = nullptr;
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+        // command may have queued frames awaiting ack, and JS-thread ticks may have been skipped while it ran
+        ezspScheduleNextTick();
+    }
+
+    QueueNextCommand();
+}
+
+/**
+ * Execute a command synchronously, or off the JS thread.
+ * @param async Run through a worker, returning a Promise
+ * @param execute SDK call(s), returning the marshaller of its outcome
+ * @return Command result, or a Promise of it
+ */
+static Napi::Value RunCommand(Napi::Env env, bool async, CommandExecute execute)
+{
+    if (async)
+    {
+        CommandWorker *worker = new CommandWorker(env, std::move(execute));
+        Napi::Promise promise = worker->GetPromise();
+
+        pendingCommands.push_back(worker);
+        QueueNextCommand();
+
+        return promise;
+    }
+
+    CommandResult result;
+    bool ran = RunOnStack(
+        [&]()
+        {
+            RunQueuedCommands();
+            result = execute();
+
+            // command may have queued frames awaiting ack
+            ezspScheduleNextTick();
+        });
+
+    if (!ran)
+    {
+        Napi::Error::New(env, "Stopped").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return result(env);
+}
+
+/**
+ * Execute a command synchronously, or off the JS thread if the binding was called through `async`.
+ * @param info Binding call info
+ * @param execute SDK call(s), returning the marshaller of its outcome
+ * @return Command result, or a Promise of it
+ */
+static Napi::Value RunCommand(const Napi::CallbackInfo &info, CommandExecute execute)
+{
+    return RunCommand(info.Env(), info.Data() == &asyncCommandMarker, std::move(execute));
+}
+
+static CommandResult StatusResult(uint32_t status)
+{
+    return [status](Napi::Env env) -> Napi::Value { return Napi::Number::New(env, status); };
+}
+
+static CommandResult UndefinedResult(void)
+{
+    return [](Napi::Env env) -> Napi::Value { return env.Undefined(); };
+}
+
+inline void WriteBackApsSequence(Napi::Object apsFrameObj, uint8_t sequence);
+
+/**
+ * @param packedApsFrameRef If the APS frame was given packed, receives the assigned sequence on success
+ */
+static CommandResult SequenceResult(sl_status_t status, uint8_t sequence, std::shared_ptr<Napi::ObjectReference> packedApsFrameRef = nullptr)
+{
+    return [status, sequence, packedApsFrameRef](Napi::Env env) -> Napi::Value
+    {
+        if (packedApsFrameRef && status == SL_STATUS_OK)
+        {
+            WriteBackApsSequence(packedApsFrameRef->Value(), sequence);
+        }
+
+        Napi::Array result = Napi::Array::New(env, 2);
+        result[0u] = Napi::Number::New(env, status);
+        result[1u] = Napi::Number::New(env, sequence);
+
+        return result;
+    };
+}
+
+/**
+ * Keep a packed APS frame alive until the sequence assigned by the stack is written back into it (async)
+ * @return Empty if the APS frame was given as object
+ */
+static std::shared_ptr<Napi::ObjectReference> PackedApsFrameRef(const Napi::Value &value)
+{
+    return value.IsTypedArray() ? std::make_shared<Napi::ObjectReference>(Napi::Persistent(value.As<Napi::Object>())) : nullptr;
+}
+
+static CommandResult ValueResult(sl_status_t status, uint8_t valueLength, const uint8_t *value)
+{
+    std::vector<uint8_t> valueCopy(value, value + valueLength);
+
+    return [status, valueLength, valueCopy](Napi::Env env) -> Napi::Value
+    {
+        Napi::Array result = Napi::Array::New(env, 3);
+        result[0u] = Napi::Number::New(env, status);
+
+        if (status == SL_STATUS_OK)
+        {
+            result[1u] = Napi::Number::New(env, valueLength);
+            result[2u] = Napi::Buffer<uint8_t>::Copy(env, valueCopy.data(), valueLength);
+        }
+
+        return result;
+    };
+}
+
+// #endregion Command dispatch
+
+static uint8_t ezspNextSequence(void) { return ((++ezspSequenceNumber) & 0x7F); }
+
+// #region Property keys
+
+// Property names (and event names) of objects created on hot paths, created once per environment
+#define PROPERTY_KEYS(X)                                                                            \
+    X(name) X(status) X(type) X(indexOrDestination) X(apsFrame) X(messageTag) X(messageContents)    \
+    X(sender) X(lastHopLqi) X(profileId) X(clusterId) X(sourceEndpoint) X(destinationEndpoint)      \
+    X(options) X(groupId) X(sequence) X(radius) X(coreKeyType) X(keyIndex) X(derivedType) X(eui64)  \
+    X(multiNetworkIndex) X(flags) X(psaKeyAlgPermission) X(contents) X(bitmask)                     \
+    X(outgoingFrameCounter) X(incomingFrameCounter) X(ttlInSeconds) X(sourcePanId) X(sourceAddress) \
+    X(newNodeId) X(newNodeEui64) X(policyDecision) X(parentOfNewNodeId)                             \
+    X(ncpNeedsResetAndInit) X(stackStatus) X(messageSent) X(zdoResponse) X(incomingMessage)         \
+    X(touchlinkMessage) X(trustCenterJoin) X(apsSequence) X(zclHeader) X(frameControl)                \
+    X(manufacturerCode) X(transactionSequenceNumber) X(commandId) X(payloadOffset)
+
+enum PropertyKey
+{
+#define PROPERTY_KEY_ENUM(key) KEY_##key,
+    PROPERTY_KEYS(PROPERTY_KEY_ENUM)
+#undef PROPERTY_KEY_ENUM
+    KEY_COUNT
+};
+
+static const char *const PROPERTY_KEY_NAMES[KEY_COUNT] = {
+#define PROPERTY_KEY_NAME(key) #key,
+    PROPERTY_KEYS(PROPERTY_KEY_NAME)
+#undef PROPERTY_KEY_NAME
+};
+
+// Environment instance data, deleted with the environment
+struct PropertyKeyCache
+{
+    Napi::Reference<Napi::String> keys[KEY_COUNT];
+};
+
+static void InitPropertyKeys(Napi::Env env)
+{
+    PropertyKeyCache *cache = new PropertyKeyCache();
+
+    for (size_t i = 0; i < KEY_COUNT; i++)
+    {
+        cache->keys[i] = Napi::Persistent(Napi::String::New(env, PROPERTY_KEY_NAMES[i]));
+    }
+
+    env.SetInstanceData(cache);
+}
+
+/**
+ * Get a cached property name (or event name)
+ * @param env Napi environment
+ * @param key Property key
+ * @return Cached JS string
+ */
+static inline napi_value Key(Napi::Env env, PropertyKey key) { return env.GetInstanceData<PropertyKeyCache>()->keys[key].Value(); }
+
+/**
+ * Descriptor for a regular (writable, enumerable, configurable) data property
+ */
+static inline napi_property_descriptor Prop(Napi::Env env, PropertyKey key, napi_value value)
+{
+    return {nullptr, Key(env, key), nullptr, nullptr, nullptr, value, napi_default_jsproperty, nullptr};
+}
+
+/**
+ * Create an object with all its properties at once.
+ * Objects created from the same keys, in the same order, share the same shape.
+ */
+template <size_t N> static Napi::Object NewObject(Napi::Env env, const napi_property_descriptor (&props)[N])
+{
+    Napi::Object obj = Napi::Object::New(env);
+
+    if (napi_define_properties(env, obj, N, props) != napi_ok)
+    {
+        // e.g. a value that failed to be created (exception pending)
+        Napi::Error::New(env).ThrowAsJavaScriptException();
+        return Napi::Object();
+    }
+
+    return obj;
+}
+
+// #endregion Property keys
+
+// #region Helper Functions for Type Conversions
+
+/**
+ * Read an integer option
+ * @param value JavaScript value
+ * @param min Lowest accepted
+ * @param max Highest accepted
+ * @param output Output value
+ * @return false if not a number, not an integer, or out of range
+ */
+inline bool GetIntegerInRange(const Napi::Value &value, uint32_t min, uint32_t max, uint32_t *output)
+{
+    if (!value.IsNumber())
     {
         return false;
     }
 
-    memcpy(key->contents, keyBuffer.Data(), 16);
+    double number = value.As<Napi::Number>().DoubleValue();
+
+    // NaN fails the integer check
+    if (number != std::trunc(number) || number < min || number > max)
+    {
+        return false;
+    }
+
+    *output = static_cast<uint32_t>(number);
+
+    return true;
+}
+
+/**
+ * Convert uint8_t array to JavaScript array of numbers
+ * @param env Napi environment
+ * @param data Pointer to uint8_t array
+ * @param length Array length
+ * @return JavaScript array
+ */
+inline Napi::Array Uint8ArrayToNumberArray(Napi::Env env, const uint8_t *data, size_t length)
+{
+    Napi::Array arr = Napi::Array::New(env, length);
+
+    for (size_t i = 0; i < length; i++)
+    {
+        arr[i] = Napi::Number::New(env, data[i]);
+    }
+
+    return arr;
+}
+
+/**
+ * Convert JavaScript array or Buffer to uint8_t array
+ * @param env Napi environment
+ * @param jsValue JavaScript array or buffer
+ * @param output Output buffer pointer
+ * @param maxLength Maximum output buffer size
+ * @return true if copied, false on error
+ */
+inline bool Uint8ArrayFromNumberArray(Napi::Env env, const Napi::Value &jsValue, uint8_t *output, size_t maxLength)
+{
+    if (jsValue.IsArray())
+    {
+        Napi::Array arr = jsValue.As<Napi::Array>();
+
+        if (arr.Length() != maxLength)
+        {
+            return false; // Error: mismatching array length and given length
+        }
+
+        for (size_t i = 0; i < maxLength; i++)
+        {
+            Napi::Value val = arr[i];
+
+            if (val.IsNumber())
+            {
+                output[i] = val.As<Napi::Number>().Uint32Value();
+            }
+            else
+            {
+                return false; // Error: non-number in array
+            }
+        }
+
+        return true;
+    }
+
+    return false; // Error: not buffer or array
+}
+
+/**
+ * Convert EUI64 from JavaScript hex string (0xXXXXXXXXXXXXXXXX) to 8-byte array
+ * @param env Napi environment
+ * @param hexString JavaScript string in format "0xXXXXXXXXXXXXXXXX"
+ * @param eui64 Output buffer (8 bytes)
+ * @return true on success, false on error
+ */
+inline bool Eui64FromHexString(Napi::Env env, const Napi::String &hexString, uint8_t *eui64)
+{
+    return Eui64FromHexString(hexString.Utf8Value(), eui64);
+}
+
+/**
+ * Convert sl_zigbee_aps_frame_t from JavaScript object to native struct
+ * @param env Napi environment
+ * @param apsFrameObj JavaScript object `SLZigbeeApsFrame`
+ * @param apsFrame Output native struct pointer
+ * @return true on success, false on invalid object
+ */
+inline bool ApsFrameFromObject(Napi::Env env, const Napi::Object &apsFrameObj, sl_zigbee_aps_frame_t *apsFrame)
+{
+    if (!apsFrameObj.Has("profileId") || !apsFrameObj.Has("clusterId") || !apsFrameObj.Has("sourceEndpoint") ||
+        !apsFrameObj.Has("destinationEndpoint") || !apsFrameObj.Has("options") || !apsFrameObj.Has("groupId") || !apsFrameObj.Has("sequence"))
+    {
+        return false;
+    }
+
+    memset(apsFrame, 0, sizeof(sl_zigbee_aps_frame_t));
+    apsFrame->profileId = apsFrameObj.Get("profileId").As<Napi::Number>().Uint32Value();
+    apsFrame->clusterId = apsFrameObj.Get("clusterId").As<Napi::Number>().Uint32Value();
+    apsFrame->sourceEndpoint = apsFrameObj.Get("sourceEndpoint").As<Napi::Number>().Uint32Value();
+    apsFrame->destinationEndpoint = apsFrameObj.Get("destinationEndpoint").As<Napi::Number>().Uint32Value();
+    apsFrame->options = apsFrameObj.Get("options").As<Napi::Number>().Uint32Value();
+    apsFrame->groupId = apsFrameObj.Get("groupId").As<Napi::Number>().Uint32Value();
+    apsFrame->sequence = apsFrameObj.Get("sequence").As<Napi::Number>().Uint32Value();
+    apsFrame->radius = apsFrameObj.Has("radius") ? apsFrameObj.Get("radius").As<Napi::Number>().Uint32Value() : 0;
+
+    return true;
+}
+
+/**
+ * Convert sl_zigbee_aps_frame_t from native struct to JavaScript object
+ * @param env Napi environment
+ * @param apsFrame Native struct pointer
+ * @return JavaScript object `SLZigbeeApsFrame`
+ */
+inline Napi::Object ApsFrameToObject(Napi::Env env, const sl_zigbee_aps_frame_t *apsFrame)
+{
+    napi_property_descriptor props[] = {
+        Prop(env, KEY_profileId, Napi::Number::New(env, apsFrame->profileId)),
+        Prop(env, KEY_clusterId, Napi::Number::New(env, apsFrame->clusterId)),
+        Prop(env, KEY_sourceEndpoint, Napi::Number::New(env, apsFrame->sourceEndpoint)),
+        Prop(env, KEY_destinationEndpoint, Napi::Number::New(env, apsFrame->destinationEndpoint)),
+        Prop(env, KEY_options, Napi::Number::New(env, apsFrame->options)),
+        Prop(env, KEY_groupId, Napi::Number::New(env, apsFrame->groupId)),
+        Prop(env, KEY_sequence, Napi::Number::New(env, apsFrame->sequence)),
+        Prop(env, KEY_radius, Napi::Number::New(env, apsFrame->radius)),
+    };
+
+    return NewObject(env, props);
+}
+
+/**
+ * Convert an APS frame from JavaScript, object or packed
+ * @param env Napi environment
+ * @param value JavaScript object `SLZigbeeApsFrame`, or Buffer/Uint8Array of `PACKED_APS_FRAME_SIZE` bytes (no property lookup)
+ * @param apsFrame Output native struct pointer
+ * @return true on success, false on invalid value
+ */
+inline bool ApsFrameFromValue(Napi::Env env, const Napi::Value &value, sl_zigbee_aps_frame_t *apsFrame)
+{
+    if (value.IsTypedArray())
+    {
+        Napi::TypedArray array = value.As<Napi::TypedArray>();
+
+        if (array.TypedArrayType() != napi_uint8_array || array.ByteLength() != PACKED_APS_FRAME_SIZE)
+        {
+            return false;
+        }
+
+        ReadApsFrame(value.As<Napi::Uint8Array>().Data(), apsFrame);
+
+        return true;
+    }
+
+    return value.IsObject() && ApsFrameFromObject(env, value.As<Napi::Object>(), apsFrame);
+}
+
+/**
+ * Write the APS sequence assigned by the stack back into the JavaScript APS frame (object or packed)
+ * @param apsFrameObj Value given to `ApsFrameFromValue`
+ * @param sequence Assigned APS sequence
+ */
+inline void WriteBackApsSequence(Napi::Object apsFrameObj, uint8_t sequence)
+{
+    if (apsFrameObj.IsTypedArray())
+    {
+        Napi::Uint8Array packed = apsFrameObj.As<Napi::Uint8Array>();
+
+        // could have been detached in the meantime (async)
+        if (packed.ByteLength() == PACKED_APS_FRAME_SIZE)
+        {
+            packed[PACKED_APS_FRAME_SEQUENCE_OFFSET] = sequence;
+        }
+    }
+    else
+    {
+        apsFrameObj.Set("sequence", sequence);
+    }
+}
+
+/**
+ * Convert a decoded ZCL header to JavaScript
+ * @return JavaScript object `EzspZclHeader`, null if malformed
+ */
+static Napi::Value ZclHeaderToObject(Napi::Env env, const ZclHeader &header)
+{
+    if (!header.Valid())
+    {
+        return env.Null();
+    }
+
+    bool manufacturerSpecific = header.frameControl & ZCL_FRAME_CONTROL_MANUFACTURER_SPECIFIC;
+    napi_property_descriptor props[] = {
+        Prop(env, KEY_frameControl, Napi::Number::New(env, header.frameControl)),
+        Prop(env, KEY_manufacturerCode, manufacturerSpecific ? Napi::Number::New(env, header.manufacturerCode) : env.Undefined()),
+        Prop(env, KEY_transactionSequenceNumber, Napi::Number::New(env, header.transactionSequenceNumber)),
+        Prop(env, KEY_commandId, Napi::Number::New(env, header.commandId)),
+        Prop(env, KEY_payloadOffset, Napi::Number::New(env, header.payloadOffset)),
+    };
+
+    return NewObject(env, props);
+}
+
+/**
+ * Create an `incomingMessage` event
+ * @param env Napi environment
+ * @param type Incoming message type
+ * @param apsFrame Native struct pointer
+ * @param lastHopLqi Last hop LQI
+ * @param sender Sender node ID
+ * @param zclHeader Decoded from the message contents
+ * @param messageContents Buffer
+ * @return JavaScript object `EzspNativeEvent`
+ */
+inline Napi::Object IncomingMessageToObject(Napi::Env env, uint8_t type, const sl_zigbee_aps_frame_t *apsFrame, uint8_t lastHopLqi, uint16_t sender,
+                                            const ZclHeader &zclHeader, Napi::Value messageContents)
+{
+    napi_property_descriptor props[] = {
+        Prop(env, KEY_name, Key(env, KEY_incomingMessage)),
+        Prop(env, KEY_type, Napi::Number::New(env, type)),
+        Prop(env, KEY_apsFrame, ApsFrameToObject(env, apsFrame)),
+        Prop(env, KEY_lastHopLqi, Napi::Number::New(env, lastHopLqi)),
+        Prop(env, KEY_sender, Napi::Number::New(env, sender)),
+        Prop(env, KEY_zclHeader, ZclHeaderToObject(env, zclHeader)),
+        Prop(env, KEY_messageContents, messageContents),
+    };
+
+    return NewObject(env, props);
+}
+
+/**
+ * Convert sl_zigbee_sec_man_context_t from JavaScript object to native struct
+ * @param env Napi environment
+ * @param contextObj JavaScript object `SLZigbeeSecManContext`
+ * @param context Output native struct pointer
+ * @return true on success, false on invalid object
+ */
+inline bool SecManContextFromObject(Napi::Env env, const Napi::Object &contextObj, sl_zigbee_sec_man_context_t *context)
+{
+    if (!contextObj.Has("coreKeyType") || !contextObj.Has("keyIndex") || !contextObj.Has("derivedType") || !contextObj.Has("eui64") ||
+        !contextObj.Has("multiNetworkIndex") || !contextObj.Has("flags") || !contextObj.Has("psaKeyAlgPermission"))
+    {
+        return false;
+    }
+
+    memset(context, 0, sizeof(sl_zigbee_sec_man_context_t));
+    context->core_key_type = contextObj.Get("coreKeyType").As<Napi::Number>().Uint32Value();
+    context->key_index = contextObj.Get("keyIndex").As<Napi::Number>().Uint32Value();
+    context->derived_type = contextObj.Get("derivedType").As<Napi::Number>().Uint32Value();
+
+    // EUI64 comes as "0x..." hex string
+    Napi::Value eui64Val = contextObj.Get("eui64");
+
+    if (eui64Val.IsString())
+    {
+        if (!Eui64FromHexString(env, eui64Val.As<Napi::String>(), context->eui64))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    context->multi_network_index = contextObj.Get("multiNetworkIndex").As<Napi::Number>().Uint32Value();
+    context->flags = contextObj.Get("flags").As<Napi::Number>().Uint32Value();
+    context->psa_key_alg_permission = contextObj.Get("psaKeyAlgPermission").As<Napi::Number>().Uint32Value();
+
+    return true;
+}
+
+/**
+ * Convert sl_zigbee_sec_man_context_t from native struct to JavaScript object
+ * @param env Napi environment
+ * @param context Native struct pointer
+ * @return JavaScript object `SLZigbeeSecManContext`
+ */
+inline Napi::Object SecManContextToObject(Napi::Env env, const sl_zigbee_sec_man_context_t *context)
+{
+    char hexString[19];
+    Eui64ToHexString(context->eui64, hexString);
+
+    napi_property_descriptor props[] = {
+        Prop(env, KEY_coreKeyType, Napi::Number::New(env, context->core_key_type)),
+        Prop(env, KEY_keyIndex, Napi::Number::New(env, context->key_index)),
+        Prop(env, KEY_derivedType, Napi::Number::New(env, context->derived_type)),
+        Prop(env, KEY_eui64, Napi::String::New(env, hexString)),
+        Prop(env, KEY_multiNetworkIndex, Napi::Number::New(env, context->multi_network_index)),
+        Prop(env, KEY_flags, Napi::Number::New(env, context->flags)),
+        Prop(env, KEY_psaKeyAlgPermission, Napi::Number::New(env, context->psa_key_alg_permission)),
+    };
+
+    return NewObject(env, props);
+}
+
+/**
+ * Convert sl_zigbee_sec_man_key_t from JavaScript object to native struct
+ * @param env Napi environment
+ * @param keyObj JavaScript object with `SLZigbeeKeyData`
+ * @param key Output native struct pointer
+ * @return true on success, false on invalid object
+ */
+inline bool SecManKeyFromObject(Napi::Env env, const Napi::Object &keyObj, sl_zigbee_sec_man_key_t *key)
+{
+    if (!keyObj.Has("contents"))
+    {
+        return false;
+    }
+
+    Napi::Value contents = keyObj.Get("contents");
+
+    if (!contents.IsBuffer())
+    {
+        return false;
+    }
+
+    Napi::Buffer<uint8_t> keyBuffer = contents.As<Napi::Buffer<uint8_t>>();
+
+    if (keyBuffer.Length() != 16)
+    {
+        return false;
+    }
+
+    memcpy(key->key, keyBuffer.Data(), 16);
+
+    return true;
+}
+
+/**
+ * Convert sl_zigbee_sec_man_key_t from native struct to JavaScript object
+ * @param env Napi environment
+ * @param key Native struct pointer
+ * @return JavaScript object with `SLZigbeeKeyData`
+ */
+inline Napi::Object SecManKeyToObject(Napi::Env env, const sl_zigbee_sec_man_key_t *key)
+{
+    napi_property_descriptor props[] = {Prop(env, KEY_contents, Napi::Buffer<uint8_t>::Copy(env, key->key, 16))};
+
+    return NewObject(env, props);
+}
+
+/**
+ * Convert sl_zigbee_key_data_t from JavaScript object to native struct
+ * @param env Napi environment
+ * @param keyObj JavaScript object with `SLZigbeeKeyData`
+ * @param key Output native struct pointer
+ * @return true on success, false on invalid object
+ */
+inline bool ZigbeeKeyDataFromObject(Napi::Env env, const Napi::Object &keyObj, sl_zigbee_key_data_t *key)
+{
+    if (!keyObj.Has("contents"))
+    {
+        return false;
+    }
+
+    Napi::Value contents = keyObj.Get("contents");
+
+    if (!contents.IsBuffer())
+    {
+        return false;
+    }
+
+    Napi::Buffer<uint8_t> keyBuffer = contents.As<Napi::Buffer<uint8_t>>();
+
+    if (keyBuffer.Length() != 16)
+    {
+        return false;
+    }
+
+    memcpy(key->contents, keyBuffer.Data(), 16);
+
+    return true;
+}
+
+/**
+ * Convert sl_zigbee_key_data_t from native struct to JavaScript object
+ * @param env Napi environment
+ * @param key Native struct pointer
+ * @return JavaScript object with `SLZigbeeKeyData`
+ */
+inline Napi::Object ZigbeeKeyDataToObject(Napi::Env env, const sl_zigbee_key_data_t *key)
+{
+    napi_property_descriptor props[] = {Prop(env, KEY_contents, Napi::Buffer<uint8_t>::Copy(env, key->contents, 16))};
+
+    return NewObject(env, props);
+}
+
+/**
+ * Convert sl_zigbee_sec_man_aps_key_metadata_t from native struct to JavaScript object
+ * @param env Napi environment
+ * @param keyData Native struct pointer
+ * @return JavaScript object `SLZigbeeSecManApsKeyMetadata`
+ */
+inline Napi::Object ApsKeyMetadataToObject(Napi::Env env, const sl_zigbee_sec_man_aps_key_metadata_t *keyData)
+{
+    napi_property_descriptor props[] = {
+        Prop(env, KEY_bitmask, Napi::Number::New(env, keyData->bitmask)),
+        Prop(env, KEY_outgoingFrameCounter, Napi::Number::New(env, keyData->outgoing_frame_counter)),
+        Prop(env, KEY_incomingFrameCounter, Napi::Number::New(env, keyData->incoming_frame_counter)),
+        Prop(env, KEY_ttlInSeconds, Napi::Number::New(env, keyData->ttl_in_seconds)),
+    };
+
+    return NewObject(env, props);
+}
+// #region Binary events
+
+// Fixed-layout event header (little endian), followed by the message contents. Decoded by `EzspBinaryEvent` in `src/index.ts`.
+//  - kind                        (1-byte)  BINARY_EVENT_*
+//  - message type                (1-byte)  incoming or outgoing
+//  - APS frame                   (12-bytes) see `WriteApsFrame`
+//  - sender/indexOrDestination   (2-bytes)
+//  - last hop LQI                (1-byte)
+//  - last hop RSSI               (1-byte)  signed
+//  - message tag                 (2-bytes) messageSent only
+//  - status                      (4-bytes) messageSent only
+// incomingMessage has its ZCL header in place of message tag and status:
+//  - frame control               (1-byte)
+//  - manufacturer code           (2-bytes) 0 if not manufacturer specific
+//  - transaction sequence number (1-byte)
+//  - command ID                  (1-byte)
+//  - payload offset              (1-byte)  0 if malformed
+#define BINARY_EVENT_HEADER_SIZE 24
+#define BINARY_EVENT_INCOMING_MESSAGE 1
+#define BINARY_EVENT_ZDO_RESPONSE 2
+#define BINARY_EVENT_MESSAGE_SENT 3
+/**
+ * Write the header of a binary event (`binaryEvents`)
+ * @param dst Destination, at least `BINARY_EVENT_HEADER_SIZE` bytes, message contents follow
+ */
+static void WriteBinaryEventHeader(uint8_t *dst, uint8_t kind, uint8_t type, const sl_zigbee_aps_frame_t *apsFrame, uint16_t address, uint8_t lqi,
+                                   int8_t rssi, uint16_t messageTag, uint32_t status)
+{
+    dst[0] = kind;
+    dst[1] = type;
+    WriteApsFrame(&dst[2], apsFrame);
+    dst[14] = LOW_BYTE(address);
+    dst[15] = HIGH_BYTE(address);
+    dst[16] = lqi;
+    dst[17] = static_cast<uint8_t>(rssi);
+    dst[18] = LOW_BYTE(messageTag);
+    dst[19] = HIGH_BYTE(messageTag);
+    dst[20] = status & 0xFF;
+    dst[21] = (status >> 8) & 0xFF;
+    dst[22] = (status >> 16) & 0xFF;
+    dst[23] = (status >> 24) & 0xFF;
+}
+
+/**
+ * Write a decoded ZCL header over message tag and status of an incomingMessage binary event header
+ */
+static void WriteBinaryEventZclHeader(uint8_t *dst, const ZclHeader &zclHeader)
+{
+    dst[18] = zclHeader.frameControl;
+    dst[19] = LOW_BYTE(zclHeader.manufacturerCode);
+    dst[20] = HIGH_BYTE(zclHeader.manufacturerCode);
+    dst[21] = zclHeader.transactionSequenceNumber;
+    dst[22] = zclHeader.commandId;
+    dst[23] = zclHeader.payloadOffset;
+}
+
+// #endregion Binary events
+
+// #region Payload pool
+
+// Fits any EZSP message (uint8_t length) after a binary event header
+#define PAYLOAD_SLOT_SIZE 280
+#define PAYLOAD_SLAB_SLOTS 64
+
+static_assert(PAYLOAD_SLOT_SIZE >= BINARY_EVENT_HEADER_SIZE + UINT8_MAX, "payload slot too small");
+
+struct PayloadSlot
+{
+    uint8_t data[PAYLOAD_SLOT_SIZE];
+    PayloadSlot *next;
+    // event builders (`PooledPayload`) and JS Buffers referencing it, any thread
+    std::atomic<uint32_t> refs;
+};
+
+// A slab stays while any of its slots is in use (JS may hold Buffers into it for as long as it wants), idle ones are freed on stop
+static std::mutex payloadPoolMutex;
+static PayloadSlot *payloadFreeList = nullptr;
+static std::vector<PayloadSlot *> payloadSlabs;
+static struct
+{
+    uint64_t slabAllocations;
+    uint64_t slabFrees;
+    uint64_t acquired;
+    uint64_t released;
+} payloadPoolStats;
+
+static void ReleasePayloadSlot(PayloadSlot *slot);
+
+static void RefPayloadSlot(PayloadSlot *slot) { slot->refs.fetch_add(1, std::memory_order_relaxed); }
+
+static void UnrefPayloadSlot(PayloadSlot *slot)
+{
+    if (slot->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        ReleasePayloadSlot(slot);
+    }
+}
+
+/**
+ * Message contents written once into a pooled slot, then handed to JS as external Buffers.
+ * Each copy (e.g. captured by an event builder) holds a reference, as does each Buffer until its finalizer runs:
+ * the slot returns to the pool with the last one, delivered or not.
+ */
+struct PooledPayload
+{
+    PayloadSlot *slot;
+    uint16_t offset;
+    uint16_t length;
+
+    /**
+     * @param slot Freshly acquired, its reference is taken over
+     */
+    PooledPayload(PayloadSlot *slot, uint16_t offset, uint16_t length) : slot(slot), offset(offset), length(length) {}
+
+    PooledPayload(const PooledPayload &other) : slot(other.slot), offset(other.offset), length(other.length) { RefPayloadSlot(slot); }
+
+    PooledPayload(PooledPayload &&other) noexcept : slot(other.slot), offset(other.offset), length(other.length) { other.slot = nullptr; }
+
+    PooledPayload &operator=(const PooledPayload &) = delete;
+    PooledPayload &operator=(PooledPayload &&) = delete;
+
+    ~PooledPayload()
+    {
+        if (slot)
+        {
+            UnrefPayloadSlot(slot);
+        }
+    }
+
+    uint8_t *Data() const { return slot->data + offset; }
+};
+
+static PayloadSlot *AcquirePayloadSlot(void)
+{
+    std::lock_guard<std::mutex> lock(payloadPoolMutex);
+
+    if (!payloadFreeList)
+    {
+        PayloadSlot *slab = new PayloadSlot[PAYLOAD_SLAB_SLOTS];
+
+        for (size_t i = 0; i < PAYLOAD_SLAB_SLOTS; i++)
+        {
+            slab[i].next = (i + 1) < PAYLOAD_SLAB_SLOTS ? &slab[i + 1] : nullptr;
+        }
+
+        payloadFreeList = slab;
+        payloadSlabs.push_back(slab);
+        payloadPoolStats.slabAllocations++;
+    }
+
+    PayloadSlot *slot = payloadFreeList;
+    payloadFreeList = slot->next;
+    slot->refs.store(1, std::memory_order_relaxed);
+    payloadPoolStats.acquired++;
+
+    return slot;
+}
+
+static void ReleasePayloadSlot(PayloadSlot *slot)
+{
+    std::lock_guard<std::mutex> lock(payloadPoolMutex);
+
+    slot->next = payloadFreeList;
+    payloadFreeList = slot;
+    payloadPoolStats.released++;
+}
+
+/**
+ * Copy message contents into a pooled slot
+ * @param offset Room to leave in front of the contents (e.g. `BINARY_EVENT_HEADER_SIZE`)
+ */
+static PooledPayload CopyToPayloadPool(const uint8_t *message, uint8_t messageLength, uint16_t offset = 0)
+{
+    PooledPayload payload = {AcquirePayloadSlot(), offset, messageLength};
+
+    if (messageLength > 0)
+    {
+        memcpy(payload.Data(), message, messageLength);
+    }
+
+    return payload;
+}
+
+/**
+ * Free the slabs none of whose slots is in use, on stop.
+ */
+static void FreeIdlePayloadSlabs(void)
+{
+    std::lock_guard<std::mutex> lock(payloadPoolMutex);
+
+    // slots are located by address, slabs being arrays
+    std::less<PayloadSlot *> before;
+    std::sort(payloadSlabs.begin(), payloadSlabs.end(), before);
+
+    auto slabIndex = [&before](PayloadSlot *slot) -> size_t
+    { return std::upper_bound(payloadSlabs.begin(), payloadSlabs.end(), slot, before) - payloadSlabs.begin() - 1; };
+
+    std::vector<uint32_t> freeSlots(payloadSlabs.size(), 0);
+
+    for (PayloadSlot *slot = payloadFreeList; slot; slot = slot->next)
+    {
+        freeSlots[slabIndex(slot)]++;
+    }
+
+    PayloadSlot *freeList = nullptr;
+
+    for (PayloadSlot *slot = payloadFreeList; slot;)
+    {
+        PayloadSlot *next = slot->next;
+
+        if (freeSlots[slabIndex(slot)] < PAYLOAD_SLAB_SLOTS)
+        {
+            slot->next = freeList;
+            freeList = slot;
+        }
+
+        slot = next;
+    }
+
+    payloadFreeList = freeList;
+
+    std::vector<PayloadSlot *> kept;
+
+    for (size_t i = 0; i < payloadSlabs.size(); i++)
+    {
+        if (freeSlots[i] == PAYLOAD_SLAB_SLOTS)
+        {
+            delete[] payloadSlabs[i];
+            payloadPoolStats.slabFrees++;
+        }
+        else
+        {
+            kept.push_back(payloadSlabs[i]);
+        }
+    }
+
+    payloadSlabs.swap(kept);
+}
+
+/**
+ * Hand a pooled payload over to JS (on the JS thread), the Buffer holds its own reference until finalized.
+ */
+static Napi::Buffer<uint8_t> PayloadToBuffer(Napi::Env env, const PooledPayload &payload)
+{
+    RefPayloadSlot(payload.slot);
+
+    // copies (and releases the slot right away) if the runtime does not allow external buffers
+    return Napi::Buffer<uint8_t>::NewOrCopy(
+        env, payload.Data(), payload.length, [](Napi::Env, uint8_t *, PayloadSlot *slot) { UnrefPayloadSlot(slot); }, payload.slot);
+}
+
+// #endregion Payload pool
+
+// #endregion Helper Functions for Type Conversions
+
+// #region Event dispatch
+
+/**
+ * Call the JS callback synchronously, from a tick run by the libuv loop.
+ * @param env Napi environment, within a HandleScope
+ * @param arg Event, or array of events in batch mode
+ */
+static void CallJsCallback(Napi::Env env, Napi::Value arg)
+{
+    uint64_t start = uv_hrtime();
+
+    // JS may issue commands from the callback, their own callbacks must not re-enter it
+    directDispatch = false;
+    // callback scope, processes microtasks on return like a `tsfn` delivery does
+    jsCallback.MakeCallback(env.Global(), {arg}, *jsCallbackContext);
+    // events its commands emitted went to `tsfn`, the rest of the tick queues behind them
+    directDispatch = DirectDispatchReady();
+
+    LoopStatsRecordDispatch(start);
+
+    if (env.IsExceptionPending())
+    {
+        napi_fatal_exception(env, env.GetAndClearPendingException().Value());
+    }
+}
+
+/**
+ * Run a call on the JS thread through `tsfn`.
+ * @return false if not queued (released), the call is dropped
+ */
+static bool QueueJsCall(JsCall call)
+{
+    JsCall *data = new JsCall(std::move(call));
+
+    if (tsfn.BlockingCall(data) != napi_ok)
+    {
+        delete data;
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Deliver an event (or batch) through `tsfn`, counted until delivered (see `DirectDispatchReady`).
+ * @param deliver Calls the callback, on the JS thread
+ */
+template <typename Deliver> static void QueueEventCall(Deliver deliver)
+{
+    tsfnEventsQueued++;
+
+    bool queued = QueueJsCall(
+        [deliver = std::move(deliver)](Napi::Env env, Napi::Function callback)
+        {
+            tsfnEventsQueued--;
+
+            uint64_t start = uv_hrtime();
+
+            deliver(env, callback);
+            LoopStatsRecordDispatch(start);
+        });
+
+    if (!queued)
+    {
+        tsfnEventsQueued--;
+    }
+}
+
+static Napi::Array BuildEventBatch(Napi::Env env, const std::vector<EventBuilderFn> &batch)
+{
+    Napi::Array events = Napi::Array::New(env, batch.size());
+
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        events.Set(static_cast<uint32_t>(i), batch[i](env));
+    }
+
+    return events;
+}
+
+/**
+ * Deliver all pending events as a single array (batch mode).
+ */
+static void FlushEvents(void)
+{
+    if (pendingEvents.empty())
+    {
+        return;
+    }
+
+    // commands issued from the callback may emit new events
+    std::vector<EventBuilderFn> batch;
+    batch.swap(pendingEvents);
+
+    if (directDispatch)
+    {
+        Napi::Env env = jsCallback.Env();
+        Napi::HandleScope scope(env);
+
+        CallJsCallback(env, BuildEventBatch(env, batch));
+        return;
+    }
+
+    auto shared = std::make_shared<std::vector<EventBuilderFn>>(std::move(batch));
+
+    QueueEventCall([shared](Napi::Env env, Napi::Function callback) { callback.Call({BuildEventBatch(env, *shared)}); });
+}
+
+/**
+ * Time until pending events must be delivered (batch mode).
+ * @return Delay in milliseconds, UINT64_MAX if nothing pending
+ */
+static uint64_t EventBatchDelayMs(void)
+{
+    if (pendingEvents.empty())
+    {
+        return UINT64_MAX;
+    }
+
+    uint64_t elapsed = (uv_hrtime() - pendingEventsSince) / 1000000;
+
+    return elapsed >= eventBatchMaxDelayMs ? 0 : (eventBatchMaxDelayMs - elapsed);
+}
+
+// Called at the end of every tick, delivers pending events once `maxDelay` has elapsed
+static void FlushDueEvents(void)
+{
+    if (EventBatchDelayMs() == 0)
+    {
+        FlushEvents();
+    }
+}
+
+/**
+ * Deliver an event to the JS callback.
+ * Synchronous when called from a tick run by the libuv loop (already on the JS thread),
+ * through `tsfn` otherwise (I/O thread, async command, or sync command waiting on its response).
+ * @param build Creates the event object on the JS thread, must own any data it references
+ */
+template <typename EventBuilder> static void EmitEvent(EventBuilder build)
+{
+    if (eventBatchEnabled)
+    {
+        if (pendingEvents.empty())
+        {
+            pendingEventsSince = uv_hrtime();
+        }
+
+        pendingEvents.emplace_back(std::move(build));
+
+        if (pendingEvents.size() >= eventBatchMaxSize)
+        {
+            FlushEvents();
+        }
+
+        return;
+    }
+
+    if (directDispatch)
+    {
+        Napi::Env env = jsCallback.Env();
+        Napi::HandleScope scope(env);
+
+        CallJsCallback(env, build(env));
+        return;
+    }
+
+    QueueEventCall([build = std::move(build)](Napi::Env env, Napi::Function callback) { callback.Call({build(env)}); });
+}
+
+/**
+ * Deliver an event in binary form (`binaryEvents`)
+ * @param payload Message contents, with `BINARY_EVENT_HEADER_SIZE` room in front for the header
+ * @param zclHeader Written in place of message tag and status (incomingMessage)
+ */
+static void EmitBinaryEvent(PooledPayload payload, uint8_t kind, uint8_t type, const sl_zigbee_aps_frame_t *apsFrame, uint16_t address, uint8_t lqi,
+                            int8_t rssi, uint16_t messageTag, uint32_t status, const ZclHeader *zclHeader = nullptr)
+{
+    WriteBinaryEventHeader(payload.slot->data, kind, type, apsFrame, address, lqi, rssi, messageTag, status);
+
+    if (zclHeader)
+    {
+        WriteBinaryEventZclHeader(payload.slot->data, *zclHeader);
+    }
+
+    payload.length += payload.offset;
+    payload.offset = 0;
+
+    EmitEvent([payload = std::move(payload)](Napi::Env env) -> Napi::Value { return PayloadToBuffer(env, payload); });
+}
+
+// #endregion Event dispatch
+
+// #region Delivery tracking
+
+// `messageTag` range of tracked sends, untracked ones (`ezspNextSequence`) stay below
+#define TRACKED_TAG_FIRST 0x0080
+#define TRACKED_TAG_COUNT (0x10000 - TRACKED_TAG_FIRST)
+
+struct PendingDelivery
+{
+    Napi::Promise::Deferred deferred;
+    /** `uv_hrtime` based, in milliseconds */
+    uint64_t deadline;
+};
+
+// In-flight tracked sends by `messageTag`, guarded by `deliveryMutex` (never acquire `stackMutex` while holding it)
+static std::mutex deliveryMutex;
+static std::unordered_map<uint16_t, PendingDelivery> pendingDeliveries;
+static std::set<std::pair<uint64_t, uint16_t>> deliveryDeadlines;
+static uint16_t nextTrackedTag = TRACKED_TAG_FIRST;
+static uint32_t deliveryTimeoutMs = DELIVERY_DEFAULT_TIMEOUT_MS;
+// Rejects timed out deliveries, armed for the earliest deadline (JS thread only).
+// Heap allocated, freed by its close callback: a new one may be armed while the previous close is pending.
+static uv_timer_t *deliveryTimer = nullptr;
+static bool deliveryTimerActive = false;
+
+static uint64_t NowMs(void) { return uv_hrtime() / 1000000; }
+
+/**
+ * Validate the `messageTag` of a raw `ezspSend*` call: while tracked sends are in flight, the tracked range is reserved,
+ * its `messageSent` would settle one of them. Throws on failure.
+ */
+static bool CheckUntrackedTag(Napi::Env env, Napi::Value value, uint16_t *messageTag)
+{
+    uint32_t tag = value.As<Napi::Number>().Uint32Value();
+
+    if (tag >= TRACKED_TAG_FIRST)
+    {
+        std::lock_guard<std::mutex> lock(deliveryMutex);
+
+        if (!pendingDeliveries.empty())
+        {
+            Napi::RangeError::New(env, "messageTag 0x0080 and up is reserved while sendTracked is in flight").ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+
+    *messageTag = tag;
+
+    return true;
+}
+
+/**
+ * Register a tracked send.
+ * @param messageTag Output free tag from the tracked range
+ * @return false if all tracked tags are in flight
+ */
+static bool TrackDelivery(Napi::Promise::Deferred deferred, uint32_t timeoutMs, uint16_t *messageTag)
+{
+    std::lock_guard<std::mutex> lock(deliveryMutex);
+
+    if (pendingDeliveries.size() >= TRACKED_TAG_COUNT)
+    {
+        return false;
+    }
+
+    while (pendingDeliveries.count(nextTrackedTag))
+    {
+        nextTrackedTag = nextTrackedTag == 0xFFFF ? TRACKED_TAG_FIRST : nextTrackedTag + 1;
+    }
+
+    uint64_t deadline = NowMs() + timeoutMs;
+    *messageTag = nextTrackedTag;
+    nextTrackedTag = nextTrackedTag == 0xFFFF ? TRACKED_TAG_FIRST : nextTrackedTag + 1;
+
+    pendingDeliveries.emplace(*messageTag, PendingDelivery{deferred, deadline});
+    deliveryDeadlines.emplace(deadline, *messageTag);
+
+    return true;
+}
+
+/**
+ * Unregister a tracked send, to settle it.
+ * @return Empty if not in flight (settled already, or not a tracked tag)
+ */
+static std::optional<Napi::Promise::Deferred> TakeDelivery(uint16_t messageTag)
+{
+    std::lock_guard<std::mutex> lock(deliveryMutex);
+
+    auto it = pendingDeliveries.find(messageTag);
+
+    if (it == pendingDeliveries.end())
+    {
+        return std::nullopt;
+    }
+
+    Napi::Promise::Deferred deferred = it->second.deferred;
+
+    deliveryDeadlines.erase({it->second.deadline, messageTag});
+    pendingDeliveries.erase(it);
+
+    return deferred;
+}
+
+/**
+ * Reject a tracked send, on the JS thread.
+ * The error carries `status` and `messageTag`.
+ */
+static void RejectDelivery(Napi::Promise::Deferred deferred, const char *message, sl_status_t status, uint16_t messageTag)
+{
+    Napi::Env env = deferred.Env();
+    Napi::Error error = Napi::Error::New(env, message);
+    error.Set("status", Napi::Number::New(env, status));
+    error.Set("messageTag", Napi::Number::New(env, messageTag));
+
+    deferred.Reject(error.Value());
+}
+
+/**
+ * Settle a tracked send from `sl_zigbee_ezsp_message_sent_handler` (any thread, stack lock held).
+ * Always through `tsfn`: settling from within a tick would run Promise reactions there.
+ */
+static void SettleDelivery(uint16_t messageTag, sl_status_t status, uint8_t apsSequence)
+{
+    if (messageTag < TRACKED_TAG_FIRST)
+    {
+        return;
+    }
+
+    std::optional<Napi::Promise::Deferred> taken = TakeDelivery(messageTag);
+
+    if (!taken)
+    {
+        return;
+    }
+
+    QueueJsCall(
+        [deferred = *taken, messageTag, status, apsSequence](Napi::Env env, Napi::Function)
+        {
+            if (status != SL_STATUS_OK)
+            {
+                RejectDelivery(deferred, "Delivery failed", status, messageTag);
+                return;
+            }
+
+            napi_property_descriptor props[] = {
+                Prop(env, KEY_messageTag, Napi::Number::New(env, messageTag)),
+                Prop(env, KEY_apsSequence, Napi::Number::New(env, apsSequence)),
+            };
+
+            deferred.Resolve(NewObject(env, props));
+        });
+}
+
+static void ArmDeliveryTimer(void);
+
+static void deliveryTimerCallback(uv_timer_t *handle)
+{
+    std::vector<std::pair<uint16_t, Napi::Promise::Deferred>> expired;
+
+    {
+        std::lock_guard<std::mutex> lock(deliveryMutex);
+
+        uint64_t now = NowMs();
+
+        while (!deliveryDeadlines.empty() && deliveryDeadlines.begin()->first <= now)
+        {
+            uint16_t messageTag = deliveryDeadlines.begin()->second;
+            auto it = pendingDeliveries.find(messageTag);
+
+            expired.emplace_back(messageTag, it->second.deferred);
+            pendingDeliveries.erase(it);
+            deliveryDeadlines.erase(deliveryDeadlines.begin());
+        }
+    }
+
+    if (!expired.empty())
+    {
+        Napi::Env env = expired.front().second.Env();
+        Napi::HandleScope scope(env);
+        // own context, `jsCallbackContext` is released on stop
+        Napi::AsyncContext asyncContext(env, "EZSP Delivery");
+        // processes Promise reactions on return
+        Napi::CallbackScope callbackScope(env, asyncContext);
+
+        for (auto &[messageTag, deferred] : expired)
+        {
+            RejectDelivery(deferred, "Delivery timed out", SL_STATUS_TIMEOUT, messageTag);
+        }
+    }
+
+    ArmDeliveryTimer();
+}
+
+/**
+ * (Re)arm the timeout timer for the earliest deadline, stop it if nothing is in flight (JS thread).
+ */
+static void ArmDeliveryTimer(void)
+{
+    uint64_t deadline;
+
+    {
+        std::lock_guard<std::mutex> lock(deliveryMutex);
+
+        deadline = deliveryDeadlines.empty() ? UINT64_MAX : deliveryDeadlines.begin()->first;
+    }
+
+    if (deadline == UINT64_MAX)
+    {
+        if (deliveryTimerActive)
+        {
+            uv_timer_stop(deliveryTimer);
+        }
+
+        return;
+    }
+
+    if (!deliveryTimerActive)
+    {
+        deliveryTimer = new uv_timer_t;
+        uv_timer_init(uv_default_loop(), deliveryTimer);
+
+        deliveryTimerActive = true;
+    }
+
+    uint64_t now = NowMs();
+
+    uv_timer_start(deliveryTimer, deliveryTimerCallback, deadline > now ? deadline - now : 0, 0);
+}
+
+/**
+ * Reject all tracked sends and release the timer (JS thread, on stop).
+ */
+static void AbortDeliveries(void)
+{
+    std::unordered_map<uint16_t, PendingDelivery> aborted;
+
+    {
+        std::lock_guard<std::mutex> lock(deliveryMutex);
+
+        aborted.swap(pendingDeliveries);
+        deliveryDeadlines.clear();
+    }
+
+    for (auto &[messageTag, delivery] : aborted)
+    {
+        RejectDelivery(delivery.deferred, "Stopped", SL_STATUS_ABORT, messageTag);
+    }
+
+    if (deliveryTimerActive)
+    {
+        uv_timer_stop(deliveryTimer);
+        uv_close((uv_handle_t *)deliveryTimer, [](uv_handle_t *handle) { delete (uv_timer_t *)handle; });
+
+        deliveryTimer = nullptr;
+        deliveryTimerActive = false;
+    }
+}
+
+// #endregion Delivery tracking
+
+// #region Outgoing messages
+
+/**
+ * Send through the EZSP command matching the outgoing message type (`sli_zigbee_af_send`), bypassing admission (see `AdmitMessage`).
+ * @param apsFrame APS frame, receives the assigned APS sequence
+ * @param alias NWK alias, for GP/alias types
+ * @param sequence NWK sequence, for GP/alias types
+ * @return `SL_STATUS_INVALID_PARAMETER` for unsupported types
+ */
+static sl_status_t SendMessage(sl_zigbee_outgoing_message_type_t type, uint16_t indexOrDestination, sl_zigbee_aps_frame_t *apsFrame,
+                               uint16_t messageTag, uint16_t alias, uint8_t sequence, uint8_t messageLength, uint8_t *message)
+{
+    uint8_t nwkRadius = 12; // ZA_MAX_HOPS
+    sl_802154_short_addr_t nwkAlias = SL_ZIGBEE_NULL_NODE_ID;
+
+    switch (type)
+    {
+    case SL_ZIGBEE_OUTGOING_VIA_BINDING:
+    case SL_ZIGBEE_OUTGOING_VIA_ADDRESS_TABLE:
+    case SL_ZIGBEE_OUTGOING_DIRECT:
+    {
+        return sl_zigbee_ezsp_send_unicast(type, indexOrDestination, apsFrame, messageTag, messageLength, message, &apsFrame->sequence);
+    }
+    case SL_ZIGBEE_OUTGOING_MULTICAST:
+    case SL_ZIGBEE_OUTGOING_MULTICAST_WITH_ALIAS:
+    {
+        if (type == SL_ZIGBEE_OUTGOING_MULTICAST_WITH_ALIAS ||
+            (apsFrame->sourceEndpoint == SL_ZIGBEE_GP_ENDPOINT && apsFrame->destinationEndpoint == SL_ZIGBEE_GP_ENDPOINT &&
+             apsFrame->options & SL_ZIGBEE_APS_OPTION_USE_ALIAS_SEQUENCE_NUMBER))
+        {
+            nwkRadius = apsFrame->radius;
+            nwkAlias = alias;
+        }
+
+        return sl_zigbee_ezsp_send_multicast(apsFrame, nwkRadius, 0, nwkAlias, sequence, messageTag, messageLength, message,
+                                             &apsFrame->sequence);
+    }
+    case SL_ZIGBEE_OUTGOING_BROADCAST:
+    case SL_ZIGBEE_OUTGOING_BROADCAST_WITH_ALIAS:
+    {
+        if (type == SL_ZIGBEE_OUTGOING_BROADCAST_WITH_ALIAS ||
+            (apsFrame->sourceEndpoint == SL_ZIGBEE_GP_ENDPOINT && apsFrame->destinationEndpoint == SL_ZIGBEE_GP_ENDPOINT &&
+             apsFrame->options & SL_ZIGBEE_APS_OPTION_USE_ALIAS_SEQUENCE_NUMBER))
+        {
+            nwkRadius = apsFrame->radius;
+            nwkAlias = alias;
+        }
+
+        return sl_zigbee_ezsp_send_broadcast(nwkAlias, indexOrDestination, sequence, apsFrame, nwkRadius, messageTag, messageLength, message,
+                                             &apsFrame->sequence);
+    }
+    default:
+        return SL_STATUS_INVALID_PARAMETER;
+    }
+}
+
+/**
+ * Settle the matching tracked send and emit `messageSent`.
+ * Also called for queued sends failing once released (`DrainQueuedSends`), as their caller only gets their tag.
+ */
+static void EmitMessageSent(sl_status_t status, sl_zigbee_outgoing_message_type_t type, uint16_t indexOrDestination, sl_zigbee_aps_frame_t *apsFrame,
+                            uint16_t messageTag, uint8_t messageLength, uint8_t *messageContents)
+{
+    if (tsfn && apsFrame && messageContents)
+    {
+        SettleDelivery(messageTag, status, apsFrame->sequence);
+
+        if (binaryEventsEnabled)
+        {
+            PooledPayload payload = CopyToPayloadPool(messageContents, messageLength, BINARY_EVENT_HEADER_SIZE);
+
+            EmitBinaryEvent(std::move(payload), BINARY_EVENT_MESSAGE_SENT, type, apsFrame, indexOrDestination, 0, 0, messageTag, status);
+            return;
+        }
+
+        // Capture data before async call
+        PooledPayload payload = CopyToPayloadPool(messageContents, messageLength);
+        sl_zigbee_aps_frame_t frameCopy = *apsFrame;
+
+        EmitEvent(
+            [status, type, indexOrDestination, frameCopy, messageTag, payload](Napi::Env env)
+            {
+                napi_property_descriptor props[] = {
+                    Prop(env, KEY_name, Key(env, KEY_messageSent)),
+                    Prop(env, KEY_status, Napi::Number::New(env, status)),
+                    Prop(env, KEY_type, Napi::Number::New(env, type)),
+                    Prop(env, KEY_indexOrDestination, Napi::Number::New(env, indexOrDestination)),
+                    Prop(env, KEY_apsFrame, ApsFrameToObject(env, &frameCopy)),
+                    Prop(env, KEY_messageTag, Napi::Number::New(env, messageTag)),
+                    Prop(env, KEY_messageContents, PayloadToBuffer(env, payload)),
+                };
+
+                return NewObject(env, props);
+            });
+    }
+}
+
+// Congestion control (opt-in via `congestionControl`): AIMD window of sends awaiting `messageSent`, sends over it are queued.
+// All state guarded by `stackMutex`.
+static bool congestionEnabled = false;
+static struct
+{
+    /** Allowed sends awaiting `messageSent`, fractional for additive increase */
+    double window;
+    uint32_t minWindow;
+    uint32_t maxWindow;
+    size_t maxQueued;
+    /** Admitted sends awaiting `messageSent`, by `InFlightKey` (raw `ezspSend*` ones are not accounted) */
+    std::unordered_multiset<uint32_t> inFlight;
+    /** Last `messageSent` or window decrease, `NowMs` */
+    uint64_t lastProgressMs;
+    uint64_t lastDecreaseMs;
+} congestion;
+
+static struct
+{
+    uint64_t admitted;
+    uint64_t deferred;
+    uint64_t dropped;
+    uint64_t overflowErrors;
+    uint64_t queueFullErrors;
+    uint64_t decreases;
+} congestionStats;
+
+// Priority classes of queued sends, released by weighted round-robin (`congestion.quotas`) so bulk traffic is never starved
+enum SendPriority
+{
+    // ZDO
+    SEND_PRIORITY_HIGH,
+    SEND_PRIORITY_NORMAL,
+    // `bulkClusters` (OTA...)
+    SEND_PRIORITY_BULK,
+    SEND_PRIORITY_COUNT
+};
+
+static uint32_t priorityQuotas[SEND_PRIORITY_COUNT] = CONGESTION_DEFAULT_QUOTAS;
+// Sends left in the current round for each class
+static uint32_t priorityCredits[SEND_PRIORITY_COUNT];
+static std::vector<uint16_t> bulkClusters = {CONGESTION_DEFAULT_BULK_CLUSTER};
+
+static SendPriority ClassifyMessage(const sl_zigbee_aps_frame_t *apsFrame)
+{
+    if (apsFrame->profileId == 0)
+    {
+        return SEND_PRIORITY_HIGH;
+    }
+
+    if (std::find(bulkClusters.begin(), bulkClusters.end(), apsFrame->clusterId) != bulkClusters.end())
+    {
+        return SEND_PRIORITY_BULK;
+    }
+
+    return SEND_PRIORITY_NORMAL;
+}
+
+struct QueuedMessage
+{
+    sl_zigbee_outgoing_message_type_t type;
+    uint16_t indexOrDestination;
+    sl_zigbee_aps_frame_t apsFrame;
+    uint16_t messageTag;
+    uint16_t alias;
+    uint8_t sequence;
+    std::vector<uint8_t> message;
+};
+
+static std::deque<QueuedMessage> queuedMessages[SEND_PRIORITY_COUNT];
+static size_t queuedCount = 0;
+
+/**
+ * Next queued send by weighted round-robin: classes in priority order while they have credits, all refilled once spent.
+ * @return `SEND_PRIORITY_COUNT` if nothing queued
+ */
+static SendPriority NextQueuedPriority(void)
+{
+    if (queuedCount == 0)
+    {
+        return SEND_PRIORITY_COUNT;
+    }
+
+    for (int round = 0; round < 2; round++)
+    {
+        for (int priority = 0; priority < SEND_PRIORITY_COUNT; priority++)
+        {
+            if (!queuedMessages[priority].empty() && priorityCredits[priority] > 0)
+            {
+                priorityCredits[priority]--;
+
+                return static_cast<SendPriority>(priority);
+            }
+        }
+
+        std::copy(std::begin(priorityQuotas), std::end(priorityQuotas), std::begin(priorityCredits));
+    }
+
+    return SEND_PRIORITY_COUNT;
+}
+
+/**
+ * Reset the controller to its full window, nothing in flight or queued (init, start, stop).
+ */
+static void ResetCongestion(void)
+{
+    congestion.window = congestion.maxWindow;
+    congestion.inFlight.clear();
+    congestion.lastProgressMs = NowMs();
+    congestion.lastDecreaseMs = 0;
+    congestionStats = {};
+
+    for (auto &queue : queuedMessages)
+    {
+        queue.clear();
+    }
+
+    queuedCount = 0;
+    std::copy(std::begin(priorityQuotas), std::end(priorityQuotas), std::begin(priorityCredits));
+}
+
+/**
+ * Multiplicative decrease, once per `CONGESTION_DECREASE_HOLDOFF_MS` (a burst of errors is a single congestion event).
+ */
+static void CongestionDecrease(void)
+{
+    uint64_t now = NowMs();
+
+    if (now - congestion.lastDecreaseMs < CONGESTION_DECREASE_HOLDOFF_MS)
+    {
+        return;
+    }
+
+    congestion.window = std::max<double>(congestion.minWindow, congestion.window / 2);
+    congestion.lastDecreaseMs = now;
+    congestion.lastProgressMs = now;
+    congestionStats.decreases++;
+}
+
+/**
+ * NCP signaled buffer starvation (`SL_ZIGBEE_EZSP_ERROR_OVERFLOW`, `SL_ZIGBEE_EZSP_ERROR_QUEUE_FULL`).
+ */
+static void CongestionOnError(sl_zigbee_ezsp_status_t status)
+{
+    if (status == SL_ZIGBEE_EZSP_ERROR_OVERFLOW)
+    {
+        congestionStats.overflowErrors++;
+    }
+    else
+    {
+        congestionStats.queueFullErrors++;
+    }
+
+    if (congestionEnabled)
+    {
+        CongestionDecrease();
+    }
+}
+
+// `messageTag` and APS sequence of a send, matched against its `messageSent`
+static uint32_t InFlightKey(uint16_t messageTag, uint8_t apsSequence) { return (static_cast<uint32_t>(messageTag) << 8) | apsSequence; }
+
+/**
+ * A send left the window, additive increase (about +1 per window of successes).
+ * Ignored for sends not admitted through the window.
+ */
+static void CongestionOnMessageSent(sl_status_t status, uint16_t messageTag, const sl_zigbee_aps_frame_t *apsFrame)
+{
+    if (!congestionEnabled || !apsFrame)
+    {
+        return;
+    }
+
+    auto it = congestion.inFlight.find(InFlightKey(messageTag, apsFrame->sequence));
+
+    if (it == congestion.inFlight.end())
+    {
+        return;
+    }
+
+    congestion.inFlight.erase(it);
+    congestion.lastProgressMs = NowMs();
+
+    if (status == SL_STATUS_OK)
+    {
+        congestion.window = std::min<double>(congestion.maxWindow, congestion.window + 1.0 / congestion.window);
+    }
+}
+
+static bool CongestionWindowOpen(void)
+{
+    if (congestion.inFlight.size() >= static_cast<uint32_t>(congestion.window) && NowMs() - congestion.lastProgressMs > CONGESTION_STALL_MS)
+    {
+        // `messageSent` lost (NCP reset...), don't stay closed forever
+        congestion.inFlight.clear();
+    }
+
+    return congestion.inFlight.size() < static_cast<uint32_t>(congestion.window);
+}
+
+/**
+ * Time until queued sends can be released (window open) or the window is considered stalled, for the tick schedulers.
+ * Keeps the queue moving without relying on serial activity.
+ */
+static uint64_t CongestionDelayMs(void)
+{
+    if (queuedCount == 0)
+    {
+        return UINT64_MAX;
+    }
+
+    if (congestion.inFlight.size() < static_cast<uint32_t>(congestion.window))
+    {
+        return 0;
+    }
+
+    uint64_t elapsed = NowMs() - congestion.lastProgressMs;
+
+    return elapsed > CONGESTION_STALL_MS ? 0 : (CONGESTION_STALL_MS - elapsed + 1);
+}
+
+/**
+ * Send and account for it in the window.
+ */
+static sl_status_t SendInWindow(sl_zigbee_outgoing_message_type_t type, uint16_t indexOrDestination, sl_zigbee_aps_frame_t *apsFrame,
+                                uint16_t messageTag, uint16_t alias, uint8_t sequence, uint8_t messageLength, uint8_t *message)
+{
+    sl_status_t status = SendMessage(type, indexOrDestination, apsFrame, messageTag, alias, sequence, messageLength, message);
+
+    if (status == SL_STATUS_OK)
+    {
+        congestion.inFlight.insert(InFlightKey(messageTag, apsFrame->sequence));
+        congestionStats.admitted++;
+    }
+    else if (status == SL_STATUS_ALLOCATION_FAILED)
+    {
+        // NCP out of message buffers
+        CongestionDecrease();
+    }
+
+    return status;
+}
+
+static bool IsOutgoingMessageType(sl_zigbee_outgoing_message_type_t type)
+{
+    switch (type)
+    {
+    case SL_ZIGBEE_OUTGOING_VIA_BINDING:
+    case SL_ZIGBEE_OUTGOING_VIA_ADDRESS_TABLE:
+    case SL_ZIGBEE_OUTGOING_DIRECT:
+    case SL_ZIGBEE_OUTGOING_MULTICAST:
+    case SL_ZIGBEE_OUTGOING_MULTICAST_WITH_ALIAS:
+    case SL_ZIGBEE_OUTGOING_BROADCAST:
+    case SL_ZIGBEE_OUTGOING_BROADCAST_WITH_ALIAS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Send through the outbound admission controller, entry point of `send`, `sendBatch` and `sendTracked`.
+ * With `congestionControl`, sends over the window are queued by priority class (`ClassifyMessage`),
+ * released as `messageSent` arrive (see `DrainQueuedSends`), in order within a class.
+ * @param sent Set if handed to the NCP, `apsFrame` then holds the assigned APS sequence (whatever the status)
+ * @return `SL_STATUS_IN_PROGRESS` if queued (no APS sequence yet, `messageSent` follows), `SL_STATUS_BUSY` if dropped (queue full)
+ */
+static sl_status_t AdmitMessage(sl_zigbee_outgoing_message_type_t type, uint16_t indexOrDestination, sl_zigbee_aps_frame_t *apsFrame,
+                                uint16_t messageTag, uint16_t alias, uint8_t sequence, uint8_t messageLength, uint8_t *message, bool *sent)
+{
+    *sent = false;
+
+    if (!IsOutgoingMessageType(type))
+    {
+        return SL_STATUS_INVALID_PARAMETER;
+    }
+
+    if (!congestionEnabled)
+    {
+        *sent = true;
+
+        return SendMessage(type, indexOrDestination, apsFrame, messageTag, alias, sequence, messageLength, message);
+    }
+
+    if (queuedCount == 0 && CongestionWindowOpen())
+    {
+        *sent = true;
+
+        return SendInWindow(type, indexOrDestination, apsFrame, messageTag, alias, sequence, messageLength, message);
+    }
+
+    if (queuedCount >= congestion.maxQueued)
+    {
+        congestionStats.dropped++;
+
+        return SL_STATUS_BUSY;
+    }
+
+    queuedMessages[ClassifyMessage(apsFrame)].push_back(
+        {type, indexOrDestination, *apsFrame, messageTag, alias, sequence, std::vector<uint8_t>(message, message + messageLength)});
+    queuedCount++;
+    congestionStats.deferred++;
+
+    return SL_STATUS_IN_PROGRESS;
+}
+
+/**
+ * Release queued sends the window has room for, at the end of every tick (stack lock held, outside callback dispatch).
+ */
+static void DrainQueuedSends(void)
+{
+    while (queuedCount > 0 && CongestionWindowOpen())
+    {
+        std::deque<QueuedMessage> &queue = queuedMessages[NextQueuedPriority()];
+        QueuedMessage queued = std::move(queue.front());
+        queue.pop_front();
+        queuedCount--;
+
+        uint8_t empty = 0;
+        uint8_t *message = queued.message.empty() ? &empty : queued.message.data();
+        sl_status_t status = SendInWindow(queued.type, queued.indexOrDestination, &queued.apsFrame, queued.messageTag, queued.alias,
+                                          queued.sequence, queued.message.size(), message);
+
+        if (status != SL_STATUS_OK)
+        {
+            EmitMessageSent(status, queued.type, queued.indexOrDestination, &queued.apsFrame, queued.messageTag, queued.message.size(), message);
+        }
+    }
+}
+
+/**
+ * Fail the sends still queued with a `messageSent` (`SL_STATUS_ABORT`), their callers only got their tag (init, start, stop, stack lock held).
+ */
+static void AbortQueuedSends(void)
+{
+    for (std::deque<QueuedMessage> &queue : queuedMessages)
+    {
+        for (QueuedMessage &queued : queue)
+        {
+            uint8_t empty = 0;
+            uint8_t *message = queued.message.empty() ? &empty : queued.message.data();
+
+            EmitMessageSent(SL_STATUS_ABORT, queued.type, queued.indexOrDestination, &queued.apsFrame, queued.messageTag, queued.message.size(),
+                            message);
+        }
+
+        queue.clear();
+    }
+
+    queuedCount = 0;
+}
+
+// #endregion Outgoing messages
+
+// #region Command stats
+
+// Log-linear latency histogram (HDR-style): 4 sub-buckets per power of two, 1us to ~71min, ~25% relative precision
+#define LATENCY_SUB_BUCKET_BITS 2
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_MAX_MSB 31
+#define LATENCY_BUCKETS ((LATENCY_MAX_MSB - LATENCY_SUB_BUCKET_BITS + 2) * LATENCY_SUB_BUCKETS)
+
+struct LatencyHistogram
+{
+    uint64_t count;
+    uint64_t sumUs;
+    uint64_t minUs;
+    uint64_t maxUs;
+    uint32_t buckets[LATENCY_BUCKETS];
+
+    static size_t BucketIndex(uint64_t us)
+    {
+        if (us < LATENCY_SUB_BUCKETS)
+        {
+            return us;
+        }
+
+        int msb = std::min(63 - __builtin_clzll(us), LATENCY_MAX_MSB);
+
+        if (msb == LATENCY_MAX_MSB)
+        {
+            us = std::min<uint64_t>(us, (2ull << LATENCY_MAX_MSB) - 1);
+        }
+
+        return (msb - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS + ((us >> (msb - LATENCY_SUB_BUCKET_BITS)) & (LATENCY_SUB_BUCKETS - 1));
+    }
+
+    /** Lowest value of a bucket */
+    static uint64_t BucketLowerBound(size_t index)
+    {
+        if (index < LATENCY_SUB_BUCKETS)
+        {
+            return index;
+        }
+
+        size_t msb = index / LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKET_BITS - 1;
+
+        return static_cast<uint64_t>(LATENCY_SUB_BUCKETS + index % LATENCY_SUB_BUCKETS) << (msb - LATENCY_SUB_BUCKET_BITS);
+    }
+
+    void Record(uint64_t us)
+    {
+        minUs = count == 0 ? us : std::min(minUs, us);
+        maxUs = std::max(maxUs, us);
+        count++;
+        sumUs += us;
+        buckets[BucketIndex(us)]++;
+    }
+
+    /** Lower bound of the bucket holding the given percentile, clamped to the recorded range */
+    uint64_t Percentile(double percentile) const
+    {
+        uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * count + 0.5);
+        uint64_t seen = 0;
+
+        for (size_t i = 0; i < LATENCY_BUCKETS; i++)
+        {
+            seen += buckets[i];
+
+            if (seen >= rank && seen > 0)
+            {
+                return std::min(std::max(BucketLowerBound(i), minUs), maxUs);
+            }
+        }
+
+        return maxUs;
+    }
+
+    void Merge(const LatencyHistogram &other)
+    {
+        if (other.count == 0)
+        {
+            return;
+        }
+
+        minUs = count == 0 ? other.minUs : std::min(minUs, other.minUs);
+        maxUs = std::max(maxUs, other.maxUs);
+        count += other.count;
+        sumUs += other.sumUs;
+
+        for (size_t i = 0; i < LATENCY_BUCKETS; i++)
+        {
+            buckets[i] += other.buckets[i];
+        }
+    }
+};
+
+struct CommandStats
+{
+    LatencyHistogram latency;
+    /** Ended without a matching response (command error, see `IsCommandError`, or superseded by the next command) */
+    uint64_t timeouts;
+    /** ASH DATA frame retransmissions while waiting for the response */
+    uint64_t retries;
+};
+
+// Per EZSP frame ID, guarded by `commandStatsMutex` (read from JS without waiting on the stack lock)
+static std::mutex commandStatsMutex;
+static std::unordered_map<uint16_t, CommandStats> commandStats;
+
+// Command awaiting its response, only touched by SDK hooks (stack lock held)
+static struct
+{
+    bool active;
+    uint16_t frameId;
+    uint8_t sequence;
+    uint64_t sentAt;
+    uint32_t txReDataFrames;
+} pendingCommand;
+
+/**
+ * End the pending command, recording its latency or a timeout.
+ */
+static void CommandStatsEnd(bool responded)
+{
+    if (!pendingCommand.active)
+    {
+        return;
+    }
+
+    pendingCommand.active = false;
+
+    uint64_t latencyUs = (uv_hrtime() - pendingCommand.sentAt) / 1000;
+    uint32_t retries = ashCount.txReDataFrames - pendingCommand.txReDataFrames;
+
+    std::lock_guard<std::mutex> lock(commandStatsMutex);
+
+    CommandStats &stats = commandStats[pendingCommand.frameId];
+    stats.retries += retries;
+
+    if (responded)
+    {
+        stats.latency.Record(latencyUs);
+    }
+    else
+    {
+        stats.timeouts++;
+    }
+}
+
+/**
+ * EZSP errors ending the command in progress without its response.
+ * NCP buffer starvation (`SL_ZIGBEE_EZSP_ERROR_OVERFLOW`, `SL_ZIGBEE_EZSP_ERROR_QUEUE_FULL`) is reported on its own, not a command failure.
+ */
+static bool IsCommandError(sl_zigbee_ezsp_status_t status)
+{
+    switch (status)
+    {
+    case SL_ZIGBEE_EZSP_ERROR_NO_RESPONSE:
+    case SL_ZIGBEE_EZSP_ASH_ERROR_TIMEOUTS:
+    case SL_ZIGBEE_EZSP_ASH_ERROR_NCP_RESET:
+    case SL_ZIGBEE_EZSP_ERROR_WRONG_DIRECTION:
+    case SL_ZIGBEE_EZSP_ERROR_TRUNCATED:
+    case SL_ZIGBEE_EZSP_ERROR_INVALID_FRAME_ID:
+    case SL_ZIGBEE_EZSP_ERROR_INVALID_CALL:
+    case SL_ZIGBEE_EZSP_ERROR_COMMAND_TOO_LONG:
+    case SL_ZIGBEE_EZSP_ERROR_UNSUPPORTED_CONTROL:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// #endregion Command stats
+
+// #region Loop stats
+
+enum LoopStallSource : uint8_t
+{
+    LOOP_STALL_NONE,
+    LOOP_STALL_TICK,
+    LOOP_STALL_DISPATCH,
+};
+
+// Histograms of one `LOOP_STATS_INTERVAL_MS` interval
+struct LoopStatsInterval
+{
+    /** Intervals since the last reset */
+    uint64_t epoch;
+    /** `ezspTickOnLoop` durations, including the callbacks it delivers synchronously */
+    LatencyHistogram tick;
+    /** JS callback invocations, direct or through `tsfn` */
+    LatencyHistogram dispatch;
+};
+
+// Time spent by the binding on the JS thread, only touched from the JS thread
+static struct
+{
+    /** Ring of the last intervals, by `epoch % LOOP_STATS_INTERVALS`, merged on read */
+    LoopStatsInterval intervals[LOOP_STATS_INTERVALS];
+    /** Since the last reset, not windowed */
+    uint64_t worstStallUs;
+    LoopStallSource worstStallSource;
+    /** Wall clock (ms since epoch) at the end of the worst stall */
+    uint64_t worstStallAt;
+    /** `uv_hrtime` of the last reset */
+    uint64_t since;
+} loopStats;
+
+static void LoopStatsReset(void)
+{
+    loopStats = {};
+    loopStats.since = uv_hrtime();
+}
+
+static uint64_t LoopStatsEpoch(uint64_t nowNs) { return (nowNs - loopStats.since) / (LOOP_STATS_INTERVAL_MS * 1000000ull); }
+
+/**
+ * Interval of the given time, cleared if it last held an older one.
+ */
+static LoopStatsInterval &LoopStatsCurrentInterval(uint64_t nowNs)
+{
+    uint64_t epoch = LoopStatsEpoch(nowNs);
+    LoopStatsInterval &interval = loopStats.intervals[epoch % LOOP_STATS_INTERVALS];
+
+    if (interval.epoch != epoch)
+    {
+        interval = {};
+        interval.epoch = epoch;
+    }
+
+    return interval;
+}
+
+static void LoopStatsRecord(LatencyHistogram LoopStatsInterval::*histogram, LoopStallSource source, uint64_t startNs)
+{
+    uint64_t nowNs = uv_hrtime();
+    uint64_t us = (nowNs - startNs) / 1000;
+
+    (LoopStatsCurrentInterval(nowNs).*histogram).Record(us);
+
+    if (us > loopStats.worstStallUs || loopStats.worstStallSource == LOOP_STALL_NONE)
+    {
+        uv_timeval64_t now;
+        uv_gettimeofday(&now);
+
+        loopStats.worstStallUs = us;
+        loopStats.worstStallSource = source;
+        loopStats.worstStallAt = static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_usec / 1000;
+    }
+}
+
+static void LoopStatsRecordTick(uint64_t startNs) { LoopStatsRecord(&LoopStatsInterval::tick, LOOP_STALL_TICK, startNs); }
+
+static void LoopStatsRecordDispatch(uint64_t startNs) { LoopStatsRecord(&LoopStatsInterval::dispatch, LOOP_STALL_DISPATCH, startNs); }
+
+/**
+ * Merge the intervals still in the window.
+ * @param windowStartNs Output start of the time covered, `uv_hrtime` based
+ */
+static void LoopStatsMerge(uint64_t nowNs, LatencyHistogram &tick, LatencyHistogram &dispatch, uint64_t *windowStartNs)
+{
+    uint64_t epoch = LoopStatsEpoch(nowNs);
+
+    for (const LoopStatsInterval &interval : loopStats.intervals)
+    {
+        if (interval.epoch <= epoch && epoch - interval.epoch < LOOP_STATS_INTERVALS)
+        {
+            tick.Merge(interval.tick);
+            dispatch.Merge(interval.dispatch);
+        }
+    }
+
+    uint64_t firstEpoch = epoch >= LOOP_STATS_INTERVALS ? epoch - LOOP_STATS_INTERVALS + 1 : 0;
+    *windowStartNs = loopStats.since + firstEpoch * LOOP_STATS_INTERVAL_MS * 1000000ull;
+}
+
+/**
+ * Set count, min/max/mean, percentiles and non-empty buckets (`[lowerBoundUs, count]`) of a histogram on `target`.
+ */
+static void SetLatencyHistogram(Napi::Env env, Napi::Object target, const LatencyHistogram &histogram)
+{
+    Napi::Array buckets = Napi::Array::New(env);
+
+    for (size_t b = 0; b < LATENCY_BUCKETS; b++)
+    {
+        if (histogram.buckets[b] > 0)
+        {
+            Napi::Array bucket = Napi::Array::New(env, 2);
+            bucket[0u] = Napi::Number::New(env, LatencyHistogram::BucketLowerBound(b));
+            bucket[1u] = Napi::Number::New(env, histogram.buckets[b]);
+
+            buckets[buckets.Length()] = bucket;
+        }
+    }
+
+    target.Set("count", Napi::Number::New(env, histogram.count));
+    target.Set("min", Napi::Number::New(env, histogram.minUs));
+    target.Set("max", Napi::Number::New(env, histogram.maxUs));
+    target.Set("mean", Napi::Number::New(env, histogram.count ? static_cast<double>(histogram.sumUs) / histogram.count : 0));
+    target.Set("p50", Napi::Number::New(env, histogram.Percentile(50)));
+    target.Set("p90", Napi::Number::New(env, histogram.Percentile(90)));
+    target.Set("p99", Napi::Number::New(env, histogram.Percentile(99)));
+    target.Set("buckets", buckets);
+}
+
+// #endregion Loop stats
+
+// #region Message filters
+
+// `MessageFilter::fields` bits, unset fields match anything
+#define MESSAGE_FILTER_TYPE 0x01
+#define MESSAGE_FILTER_PROFILE 0x02
+#define MESSAGE_FILTER_CLUSTER 0x04
+#define MESSAGE_FILTER_SOURCE_ENDPOINT 0x08
+#define MESSAGE_FILTER_DESTINATION_ENDPOINT 0x10
+#define MESSAGE_FILTER_SENDER 0x20
+#define MESSAGE_FILTER_FRAME_TYPE 0x40
+#define MESSAGE_FILTER_COMMAND 0x80
+
+struct MessageFilter
+{
+    uint8_t fields;
+    /** Drop on match, accept (stop evaluating) otherwise */
+    bool drop;
+    uint8_t type;
+    uint16_t profileId;
+    uint16_t clusterId;
+    uint8_t sourceEndpoint;
+    uint8_t destinationEndpoint;
+    uint16_t sender;
+    /** ZCL header fields, never match a ZDO message or a malformed header */
+    uint8_t frameType;
+    uint8_t commandId;
+    uint64_t matches;
+};
+
+// Evaluated in order on every incoming message (first match wins), guarded by `stackMutex`
+static std::vector<MessageFilter> messageFilters;
+
+static bool MessageFilterMatches(const MessageFilter &filter, sl_zigbee_incoming_message_type_t type, const sl_zigbee_aps_frame_t *apsFrame,
+                                 uint16_t sender, const ZclHeader &zclHeader)
+{
+    if ((filter.fields & (MESSAGE_FILTER_FRAME_TYPE | MESSAGE_FILTER_COMMAND)) && !zclHeader.Valid())
+    {
+        return false;
+    }
+
+    return (!(filter.fields & MESSAGE_FILTER_TYPE) || filter.type == type) &&
+           (!(filter.fields & MESSAGE_FILTER_PROFILE) || filter.profileId == apsFrame->profileId) &&
+           (!(filter.fields & MESSAGE_FILTER_CLUSTER) || filter.clusterId == apsFrame->clusterId) &&
+           (!(filter.fields & MESSAGE_FILTER_SOURCE_ENDPOINT) || filter.sourceEndpoint == apsFrame->sourceEndpoint) &&
+           (!(filter.fields & MESSAGE_FILTER_DESTINATION_ENDPOINT) || filter.destinationEndpoint == apsFrame->destinationEndpoint) &&
+           (!(filter.fields & MESSAGE_FILTER_SENDER) || filter.sender == sender) &&
+           (!(filter.fields & MESSAGE_FILTER_FRAME_TYPE) || filter.frameType == (zclHeader.frameControl & ZCL_FRAME_TYPE_MASK)) &&
+           (!(filter.fields & MESSAGE_FILTER_COMMAND) || filter.commandId == zclHeader.commandId);
+}
+
+/**
+ * Run an incoming message through `messageFilters`, before anything is copied for JS.
+ * @return true if the message must not be delivered
+ */
+static bool MessageFiltered(sl_zigbee_incoming_message_type_t type, const sl_zigbee_aps_frame_t *apsFrame, uint16_t sender,
+                            const ZclHeader &zclHeader)
+{
+    for (MessageFilter &filter : messageFilters)
+    {
+        if (MessageFilterMatches(filter, type, apsFrame, sender, zclHeader))
+        {
+            filter.matches++;
+
+            return filter.drop;
+        }
+    }
+
+    return false;
+}
+
+// #endregion Message filters
+
+// #region Duplicate suppression
+
+// Recent incoming frames, open addressing with linear probing (power of two)
+#define DUPLICATE_TABLE_SIZE 512
+// Slots probed per lookup, the oldest one is replaced when all are live
+#define DUPLICATE_MAX_PROBES 8
+
+struct RecentFrame
+{
+    /** `sender << 32 | clusterId << 16 | sourceEndpoint << 8 | sequence`, 0 for empty (any key is made non-zero by bit 48) */
+    uint64_t key;
+    /** FNV-1a of the message, a wrapped APS counter with another payload is not a duplicate */
+    uint32_t messageHash;
+    uint64_t seenMs;
+};
+
+// Opt-in via `duplicateWindow`, guarded by `stackMutex`
+static uint32_t duplicateWindowMs = 0;
+static RecentFrame recentFrames[DUPLICATE_TABLE_SIZE];
+static struct
+{
+    uint64_t checked;
+    uint64_t duplicates;
+    /** Live entries replaced because all probed slots were taken */
+    uint64_t evictions;
+} duplicateStats;
+
+static void ResetDuplicates(void)
+{
+    std::fill(std::begin(recentFrames), std::end(recentFrames), RecentFrame{});
+    duplicateStats = {};
+}
+
+static uint32_t MessageHash(const uint8_t *message, uint8_t messageLength)
+{
+    uint32_t hash = 0x811C9DC5;
+
+    for (uint8_t i = 0; i < messageLength; i++)
+    {
+        hash = (hash ^ message[i]) * 0x01000193;
+    }
+
+    return hash;
+}
+
+/**
+ * Check an incoming frame against the ones seen within `duplicateWindowMs`, recording it if new.
+ * @return true if the same (sender, APS counter, cluster, source endpoint) with the same payload was seen within the window
+ */
+static bool IsDuplicateFrame(const sl_zigbee_aps_frame_t *apsFrame, uint16_t sender, const uint8_t *message, uint8_t messageLength)
+{
+    uint64_t key = (1ull << 48) | (static_cast<uint64_t>(sender) << 32) | (static_cast<uint64_t>(apsFrame->clusterId) << 16) |
+                   (static_cast<uint64_t>(apsFrame->sourceEndpoint) << 8) | apsFrame->sequence;
+    uint32_t messageHash = MessageHash(message, messageLength);
+    size_t index = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (DUPLICATE_TABLE_SIZE - 1);
+    uint64_t now = NowMs();
+    auto live = [now](const RecentFrame &frame) { return frame.key != 0 && now - frame.seenMs < duplicateWindowMs; };
+    RecentFrame *slot = nullptr;
+
+    duplicateStats.checked++;
+
+    for (size_t probe = 0; probe < DUPLICATE_MAX_PROBES; probe++)
+    {
+        RecentFrame &frame = recentFrames[(index + probe) & (DUPLICATE_TABLE_SIZE - 1)];
+
+        if (live(frame) && frame.key == key && frame.messageHash == messageHash)
+        {
+            duplicateStats.duplicates++;
+
+            return true;
+        }
+
+        // first free (empty or expired) slot, else the oldest one
+        if (!slot || (live(*slot) && (!live(frame) || frame.seenMs < slot->seenMs)))
+        {
+            slot = &frame;
+        }
+    }
+
+    if (live(*slot))
+    {
+        duplicateStats.evictions++;
+    }
+
+    slot->key = key;
+    slot->messageHash = messageHash;
+    slot->seenMs = now;
+
+    return false;
+}
+
+// #endregion Duplicate suppression
+
+// #region Green Power deduplication
+
+// Sources tracked at once, expired ones are pruned first when full, then the least recently seen
+#define GP_DEDUP_MAX_SOURCES 1024
+
+// Last GPDF forwarded per GPD source ID
+struct GpSource
+{
+    uint32_t frameCounter;
+    uint8_t sequenceNumber;
+    uint8_t commandId;
+    uint64_t seenMs;
+    uint64_t forwarded;
+    uint64_t duplicates;
+};
+
+// Opt-in via `gpDuplicateWindow`, guarded by `stackMutex`
+static uint32_t gpDuplicateWindowMs = 0;
+static std::unordered_map<uint32_t, GpSource> gpSources;
+
+static void GpDedupPrune(uint64_t now)
+{
+    for (auto it = gpSources.begin(); it != gpSources.end();)
+    {
+        it = now - it->second.seenMs >= gpDuplicateWindowMs ? gpSources.erase(it) : std::next(it);
+    }
+
+    if (gpSources.size() >= GP_DEDUP_MAX_SOURCES)
+    {
+        gpSources.erase(std::min_element(gpSources.begin(), gpSources.end(),
+                                         [](const auto &a, const auto &b) { return a.second.seenMs < b.second.seenMs; }));
+    }
+}
+
+/**
+ * Check a GPDF against the last one forwarded for its source, recording it if new.
+ * GPDs send each frame several times on purpose, possibly also relayed by several proxies.
+ * @return true if the same frame counter, sequence number and command were seen within the window
+ */
+static bool IsDuplicateGpdf(const sl_zigbee_gp_params_t *param)
+{
+    uint64_t now = NowMs();
+    auto it = gpSources.find(param->addr.id.sourceId);
+
+    if (it != gpSources.end())
+    {
+        GpSource &source = it->second;
+
+        if (source.frameCounter == param->gpdSecurityFrameCounter && source.sequenceNumber == param->sequenceNumber &&
+            source.commandId == param->gpdCommandId && now - source.seenMs < gpDuplicateWindowMs)
+        {
+            source.duplicates++;
+
+            return true;
+        }
+    }
+    else
+    {
+        if (gpSources.size() >= GP_DEDUP_MAX_SOURCES)
+        {
+            GpDedupPrune(now);
+        }
+
+        it = gpSources.emplace(param->addr.id.sourceId, GpSource{}).first;
+    }
+
+    GpSource &source = it->second;
+    source.frameCounter = param->gpdSecurityFrameCounter;
+    source.sequenceNumber = param->sequenceNumber;
+    source.commandId = param->gpdCommandId;
+    source.seenMs = now;
+    source.forwarded++;
+
+    return false;
+}
+
+// #endregion Green Power deduplication
+
+// #region Incoming messages
+
+/**
+ * Deliver an incoming message as `zdoResponse` (ZDO profile) or `incomingMessage`, copies the message contents.
+ * @param zclHeader Decoded from `message`, ignored for ZDO
+ */
+static void EmitIncomingMessage(sl_zigbee_incoming_message_type_t type, const sl_zigbee_aps_frame_t *apsFrame,
+                                const sl_zigbee_rx_packet_info_t *packetInfo, uint8_t messageLength, const uint8_t *message,
+                                const ZclHeader &zclHeader)
+{
+    if (binaryEventsEnabled)
+    {
+        uint8_t kind = apsFrame->profileId == 0 ? BINARY_EVENT_ZDO_RESPONSE : BINARY_EVENT_INCOMING_MESSAGE;
+
+        PooledPayload payload = CopyToPayloadPool(message, messageLength, BINARY_EVENT_HEADER_SIZE);
+
+        EmitBinaryEvent(std::move(payload), kind, type, apsFrame, packetInfo->sender_short_id, packetInfo->last_hop_lqi, packetInfo->last_hop_rssi,
+                        0, 0, apsFrame->profileId != 0 ? &zclHeader : nullptr);
+        return;
+    }
+
+    // Capture data before async call
+    PooledPayload payload = CopyToPayloadPool(message, messageLength);
+    sl_zigbee_aps_frame_t frameCopy = *apsFrame;
+    sl_zigbee_rx_packet_info_t packetCopy = *packetInfo;
+
+    if (apsFrame->profileId == 0)
+    {
+        // ZDO
+        EmitEvent(
+            [frameCopy, packetCopy, payload](Napi::Env env)
+            {
+                napi_property_descriptor props[] = {
+                    Prop(env, KEY_name, Key(env, KEY_zdoResponse)),
+                    Prop(env, KEY_apsFrame, ApsFrameToObject(env, &frameCopy)),
+                    Prop(env, KEY_sender, Napi::Number::New(env, packetCopy.sender_short_id)),
+                    Prop(env, KEY_messageContents, PayloadToBuffer(env, payload)),
+                };
+
+                return NewObject(env, props);
+            });
+    }
+    else
+    {
+        // assumed ZCL
+        EmitEvent(
+            [type, frameCopy, packetCopy, zclHeader, payload](Napi::Env env)
+            {
+                return IncomingMessageToObject(env, type, &frameCopy, packetCopy.last_hop_lqi, packetCopy.sender_short_id, zclHeader,
+                                               PayloadToBuffer(env, payload));
+            });
+    }
+}
+
+// #endregion Incoming messages
+
+// #region Report coalescing
+
+#define ZCL_COMMAND_REPORT_ATTRIBUTES 0x0A
+// Sender/endpoint/cluster tracked at once, beyond that reports are delivered as is
+#define REPORT_COALESCING_DEFAULT_MAX_SOURCES 256
+
+/**
+ * Size of a ZCL attribute value of the given data type, for the types a report record can be coalesced with.
+ * @return Bytes, -1 for variable-size collections (array, structure, set, bag), unknown types or truncated strings
+ */
+static int ZclValueSize(uint8_t dataType, const uint8_t *value, size_t remaining)
+{
+    // data8-64 (0x08-0x0F), map8-64 (0x18-0x1F), uint8-64 (0x20-0x27), int8-64 (0x28-0x2F): size from the low 3 bits
+    if ((dataType >= 0x08 && dataType <= 0x0F) || (dataType >= 0x18 && dataType <= 0x2F))
+    {
+        return (dataType & 0x07) + 1;
+    }
+
+    switch (dataType)
+    {
+    case 0x00: // no data
+        return 0;
+    case 0x10: // boolean
+    case 0x30: // enum8
+        return 1;
+    case 0x31: // enum16
+    case 0x38: // semi-precision
+    case 0xE8: // cluster ID
+    case 0xE9: // attribute ID
+        return 2;
+    case 0x39: // single precision
+    case 0xE0: // time of day
+    case 0xE1: // date
+    case 0xE2: // UTC
+    case 0xEA: // BACnet OID
+        return 4;
+    case 0x3A: // double precision
+    case 0xF0: // EUI64
+        return 8;
+    case 0xF1: // 128-bit security key
+        return 16;
+    case 0x41: // octet string
+    case 0x42: // character string
+        // 0xFF is invalid (no contents)
+        return remaining < 1 ? -1 : 1 + (value[0] == 0xFF ? 0 : value[0]);
+    case 0x43: // long octet string
+    case 0x44: // long character string
+    {
+        if (remaining < 2)
+        {
+            return -1;
+        }
+
+        uint16_t length = HIGH_LOW_TO_INT(value[1], value[0]);
+
+        return 2 + (length == 0xFFFF ? 0 : length);
+    }
+    default:
+        return -1;
+    }
+}
+
+// Record of a Report Attributes payload (attribute ID, data type, value), pointing into the received message
+struct ReportRecord
+{
+    uint16_t attributeId;
+    const uint8_t *data;
+    uint8_t size;
+};
+
+// Records fit a single frame, at least 3 bytes each
+#define REPORT_MAX_RECORDS (UINT8_MAX / 3)
+
+// Held record, in `ReportSource::held`
+struct HeldRecord
+{
+    uint16_t attributeId;
+    uint8_t offset;
+    uint8_t size;
+};
+
+// Latest report records of a sender/endpoint/cluster, guarded by `stackMutex`
+struct ReportSource
+{
+    /** Last delivery (as is or coalesced), `NowMs` */
+    uint64_t lastEmitMs;
+    /** Held records back to back, latest per attribute, in first-seen order (capacity kept across deliveries) */
+    std::vector<uint8_t> held;
+    std::vector<HeldRecord> records;
+    /** Of the latest held report */
+    sl_zigbee_incoming_message_type_t type;
+    sl_zigbee_aps_frame_t apsFrame;
+    sl_zigbee_rx_packet_info_t packetInfo;
+    ZclHeader zclHeader;
+};
+
+// Coalesced report taken out of its source, emitted once no source is referenced anymore (the callback may re-enter the stack)
+struct CoalescedReport
+{
+    sl_zigbee_incoming_message_type_t type;
+    sl_zigbee_aps_frame_t apsFrame;
+    sl_zigbee_rx_packet_info_t packetInfo;
+    ZclHeader zclHeader;
+    uint8_t length;
+    uint8_t message[UINT8_MAX];
+};
+
+// Opt-in via `reportCoalescing`, guarded by `stackMutex`
+static bool reportCoalescingEnabled = false;
+static uint32_t reportCoalescingIntervalMs = 0;
+static size_t reportCoalescingMaxSources = REPORT_COALESCING_DEFAULT_MAX_SOURCES;
+static std::unordered_map<uint64_t, ReportSource> reportSources;
+static size_t heldReportSources = 0;
+static struct
+{
+    /** Reports delivered as is (first in their interval, or not coalescible) */
+    uint64_t passed;
+    /** Reports held for a later coalesced delivery */
+    uint64_t held;
+    /** Held records replaced by a newer value of the same attribute */
+    uint64_t replaced;
+    /** Coalesced reports delivered */
+    uint64_t flushed;
+    /** Reports with a record that could not be parsed (collection type, truncated) */
+    uint64_t unparsed;
+    /** Reports delivered as is because `maxSources` was reached */
+    uint64_t overflows;
+} reportCoalescingStats;
+
+static void ResetReportCoalescing(void)
+{
+    reportSources.clear();
+    heldReportSources = 0;
+    reportCoalescingStats = {};
+}
+
+/**
+ * Take the held records of a source as one Report Attributes frame, with the APS frame, header and link info of the latest report.
+ * @param due Receives the frame, to emit with `EmitCoalescedReports`
+ */
+static void TakeCoalescedReport(ReportSource &source, uint64_t now, std::vector<CoalescedReport> &due)
+{
+    if (source.records.empty())
+    {
+        return;
+    }
+
+    CoalescedReport &report = due.emplace_back();
+    uint8_t *message = report.message;
+    uint8_t length = source.zclHeader.payloadOffset;
+
+    message[0] = source.zclHeader.frameControl;
+    message[length - 2] = source.zclHeader.transactionSequenceNumber;
+    message[length - 1] = source.zclHeader.commandId;
+
+    if (source.zclHeader.frameControl & ZCL_FRAME_CONTROL_MANUFACTURER_SPECIFIC)
+    {
+        message[1] = LOW_BYTE(source.zclHeader.manufacturerCode);
+        message[2] = HIGH_BYTE(source.zclHeader.manufacturerCode);
+    }
+
+    memcpy(&message[length], source.held.data(), source.held.size());
+
+    report.type = source.type;
+    report.apsFrame = source.apsFrame;
+    report.packetInfo = source.packetInfo;
+    report.zclHeader = source.zclHeader;
+    report.length = length + source.held.size();
+
+    source.held.clear();
+    source.records.clear();
+    source.lastEmitMs = now;
+    heldReportSources--;
+    reportCoalescingStats.flushed++;
+}
+
+static void EmitCoalescedReports(std::vector<CoalescedReport> &due)
+{
+    for (CoalescedReport &report : due)
+    {
+        EmitIncomingMessage(report.type, &report.apsFrame, &report.packetInfo, report.length, report.message, report.zclHeader);
+    }
+}
+
+/**
+ * Split the records of a Report Attributes payload, without copying them.
+ * @param records At least `REPORT_MAX_RECORDS`
+ * @return false if any record could not be parsed
+ */
+static bool ParseReportRecords(const uint8_t *payload, size_t length, ReportRecord *records, size_t *count)
+{
+    size_t offset = 0;
+
+    *count = 0;
+
+    while (offset < length)
+    {
+        if (length - offset < 3)
+        {
+            return false;
+        }
+
+        int size = ZclValueSize(payload[offset + 2], &payload[offset + 3], length - offset - 3);
+
+        if (size < 0 || static_cast<size_t>(size) > length - offset - 3)
+        {
+            return false;
+        }
+
+        records[(*count)++] = {static_cast<uint16_t>(HIGH_LOW_TO_INT(payload[offset + 1], payload[offset])), &payload[offset],
+                               static_cast<uint8_t>(3 + size)};
+        offset += 3 + size;
+    }
+
+    return true;
+}
+
+/**
+ * Replace the value of a held record, shifting the ones after it if the size changed.
+ */
+static void ReplaceHeldRecord(ReportSource &source, std::vector<HeldRecord>::iterator held, const ReportRecord &record)
+{
+    auto at = source.held.begin() + held->offset;
+
+    if (held->size == record.size)
+    {
+        std::copy(record.data, record.data + record.size, at);
+        return;
+    }
+
+    int delta = static_cast<int>(record.size) - held->size;
+
+    at = source.held.erase(at, at + held->size);
+    source.held.insert(at, record.data, record.data + record.size);
+    held->size = record.size;
+
+    for (auto next = held + 1; next != source.records.end(); next++)
+    {
+        next->offset = static_cast<uint8_t>(next->offset + delta);
+    }
+}
+
+/**
+ * Drop the least recently delivered source without held records, to make room for a new one.
+ * @return false if all sources have held records
+ */
+static bool EvictReportSource(void)
+{
+    auto oldest = reportSources.end();
+
+    for (auto it = reportSources.begin(); it != reportSources.end(); it++)
+    {
+        if (it->second.records.empty() && (oldest == reportSources.end() || it->second.lastEmitMs < oldest->second.lastEmitMs))
+        {
+            oldest = it;
+        }
+    }
+
+    if (oldest == reportSources.end())
+    {
+        return false;
+    }
+
+    reportSources.erase(oldest);
+
+    return true;
+}
+
+/**
+ * See `CoalesceReport`.
+ * @param due Receives the coalesced reports to deliver before this frame
+ */
+static bool HoldReport(sl_zigbee_incoming_message_type_t type, const sl_zigbee_aps_frame_t *apsFrame, const sl_zigbee_rx_packet_info_t *packetInfo,
+                       uint8_t messageLength, const uint8_t *message, const ZclHeader &zclHeader, std::vector<CoalescedReport> &due)
+{
+    uint64_t now = NowMs();
+    uint64_t key = (static_cast<uint64_t>(packetInfo->sender_short_id) << 24) | (static_cast<uint64_t>(apsFrame->sourceEndpoint) << 16) |
+                   apsFrame->clusterId;
+
+    if (!zclHeader.Valid() || (zclHeader.frameControl & ZCL_FRAME_TYPE_MASK) != 0 || zclHeader.commandId != ZCL_COMMAND_REPORT_ATTRIBUTES)
+    {
+        if (heldReportSources > 0)
+        {
+            auto it = reportSources.find(key);
+
+            // held values are older than this frame (e.g. a Read Attributes response)
+            if (it != reportSources.end())
+            {
+                TakeCoalescedReport(it->second, now, due);
+            }
+        }
+
+        return false;
+    }
+
+    auto it = reportSources.find(key);
+
+    if (it == reportSources.end())
+    {
+        if (reportSources.size() >= reportCoalescingMaxSources && !EvictReportSource())
+        {
+            reportCoalescingStats.overflows++;
+            reportCoalescingStats.passed++;
+
+            return false;
+        }
+
+        // first report of this source goes through, later ones within the interval are held
+        reportSources.emplace(key, ReportSource{now});
+        reportCoalescingStats.passed++;
+
+        return false;
+    }
+
+    ReportSource &source = it->second;
+
+    if (source.records.empty() && now - source.lastEmitMs >= reportCoalescingIntervalMs)
+    {
+        source.lastEmitMs = now;
+        reportCoalescingStats.passed++;
+
+        return false;
+    }
+
+    ReportRecord records[REPORT_MAX_RECORDS];
+    size_t recordCount = 0;
+
+    if (!ParseReportRecords(&message[zclHeader.payloadOffset], messageLength - zclHeader.payloadOffset, records, &recordCount))
+    {
+        // keep ordering with the held older values
+        TakeCoalescedReport(source, now, due);
+
+        source.lastEmitMs = now;
+        reportCoalescingStats.unparsed++;
+        reportCoalescingStats.passed++;
+
+        return false;
+    }
+
+    // different direction, manufacturer... not merged together
+    if (!source.records.empty() && (source.zclHeader.frameControl != zclHeader.frameControl ||
+                                    source.zclHeader.manufacturerCode != zclHeader.manufacturerCode))
+    {
+        TakeCoalescedReport(source, now, due);
+    }
+
+    size_t mergedLength = zclHeader.payloadOffset + source.held.size();
+
+    for (size_t i = 0; i < recordCount; i++)
+    {
+        const ReportRecord &record = records[i];
+        auto held = std::find_if(source.records.begin(), source.records.end(),
+                                 [&record](const HeldRecord &h) { return h.attributeId == record.attributeId; });
+        size_t heldSize = held != source.records.end() ? held->size : 0;
+
+        if (mergedLength - heldSize + record.size > UINT8_MAX)
+        {
+            TakeCoalescedReport(source, now, due);
+
+            mergedLength = zclHeader.payloadOffset;
+            held = source.records.end();
+            heldSize = 0;
+        }
+
+        mergedLength = mergedLength - heldSize + record.size;
+
+        if (held != source.records.end())
+        {
+            ReplaceHeldRecord(source, held, record);
+            reportCoalescingStats.replaced++;
+            continue;
+        }
+
+        if (source.records.empty())
+        {
+            heldReportSources++;
+        }
+
+        source.records.push_back({record.attributeId, static_cast<uint8_t>(source.held.size()), record.size});
+        source.held.insert(source.held.end(), record.data, record.data + record.size);
+    }
+
+    source.type = type;
+    source.apsFrame = *apsFrame;
+    source.packetInfo = *packetInfo;
+    source.zclHeader = zclHeader;
+    reportCoalescingStats.held++;
+
+    return true;
+}
+
+/**
+ * Hold a Report Attributes frame received within `reportCoalescingIntervalMs` of the previous delivery for its sender/endpoint/cluster,
+ * keeping only the latest value per attribute. Held reports of the source are delivered first when a frame goes through.
+ * @return true if held, false if it must be delivered now
+ */
+static bool CoalesceReport(sl_zigbee_incoming_message_type_t type, const sl_zigbee_aps_frame_t *apsFrame,
+                           const sl_zigbee_rx_packet_info_t *packetInfo, uint8_t messageLength, const uint8_t *message, const ZclHeader &zclHeader)
+{
+    std::vector<CoalescedReport> due;
+    bool held = HoldReport(type, apsFrame, packetInfo, messageLength, message, zclHeader, due);
+
+    EmitCoalescedReports(due);
+
+    return held;
+}
+
+/**
+ * Time until the next held report is due (`reportCoalescing`).
+ * @return Delay in milliseconds, UINT64_MAX if nothing held
+ */
+static uint64_t ReportFlushDelayMs(void)
+{
+    if (heldReportSources == 0)
+    {
+        return UINT64_MAX;
+    }
+
+    uint64_t now = NowMs();
+    uint64_t delay = UINT64_MAX;
+
+    for (const auto &[key, source] : reportSources)
+    {
+        if (!source.records.empty())
+        {
+            uint64_t elapsed = now - source.lastEmitMs;
+
+            delay = std::min(delay, elapsed >= reportCoalescingIntervalMs ? 0 : reportCoalescingIntervalMs - elapsed);
+        }
+    }
+
+    return delay;
+}
+
+// Called at the end of every tick, delivers held reports once their interval has elapsed
+static void FlushDueReports(void)
+{
+    if (heldReportSources == 0)
+    {
+        return;
+    }
+
+    uint64_t now = NowMs();
+    std::vector<CoalescedReport> due;
+
+    for (auto &[key, source] : reportSources)
+    {
+        if (!source.records.empty() && now - source.lastEmitMs >= reportCoalescingIntervalMs)
+        {
+            TakeCoalescedReport(source, now, due);
+        }
+    }
+
+    EmitCoalescedReports(due);
+}
+
+// #endregion Report coalescing
+
+// #region Frame capture
+
+// File: header, then records (all little-endian)
+// header: "EZSPCAP" + format version (8), wall clock at start (u64 µs since epoch), monotonic clock at start (u64 ns)
+// record: delta since previous record (u32 µs), flags (u8), length (u16),
+//         raw serial bytes of one ASH frame (stuffed, closing Flag or Cancel included)
+#define CAPTURE_MAGIC "EZSPCAP"
+#define CAPTURE_FORMAT_VERSION 1
+#define CAPTURE_FILE_HEADER_SIZE 24
+#define CAPTURE_RECORD_HEADER_SIZE 7
+// Frame bytes kept per record, the rest is counted as truncated
+#define CAPTURE_MAX_FRAME_SIZE 512
+#define CAPTURE_DEFAULT_BUFFER_SIZE (1u << 20)
+#define CAPTURE_MIN_BUFFER_SIZE (1u << 16)
+#define CAPTURE_MAX_BUFFER_SIZE (1u << 26)
+// Max time captured frames wait in the ring before the writer thread picks them up
+#define CAPTURE_WRITER_INTERVAL_MS 20
+// ASH Flag byte, ends every frame
+#define CAPTURE_FRAME_END 0x7e
+// ASH Cancel byte, ends the frame in progress (discarded by the receiver). Substitute (0x18) doesn't: the frame runs to its Flag.
+#define CAPTURE_FRAME_CANCEL 0x1a
+
+#define CAPTURE_FLAG_NCP_TO_HOST 0x01
+#define CAPTURE_FLAG_TRUNCATED 0x02
+// records were dropped right before this one (ring full)
+#define CAPTURE_FLAG_DROPPED 0x04
+// not a frame: 8-byte payload, monotonic ns since start (delta would overflow), later deltas are relative to it
+#define CAPTURE_FLAG_TIME 0x80
+
+enum CaptureDirection : uint8_t
+{
+    CAPTURE_HOST_TO_NCP,
+    CAPTURE_NCP_TO_HOST,
+};
+
+// Producer side (ASH serial I/O) runs under `stackMutex`, so it is single-producer/single-consumer with the writer thread
+static struct
+{
+    std::atomic<bool> active{false};
+    std::string path;
+    int fd = -1;
+    std::vector<uint8_t> ring;
+    /** written up to (producer), monotonic, masked on access */
+    std::atomic<uint64_t> head{0};
+    /** written to file up to (writer thread) */
+    std::atomic<uint64_t> tail{0};
+    std::thread writer;
+    std::atomic<bool> writerRunning{false};
+    /** `uv_hrtime` at start and of the previous record */
+    uint64_t startNs;
+    uint64_t lastNs;
+    bool dropping;
+    struct
+    {
+        uint8_t bytes[CAPTURE_MAX_FRAME_SIZE];
+        uint16_t length;
+        bool truncated;
+    } frames[2];
+    std::atomic<uint64_t> records{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> truncated{0};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> writeErrors{0};
+} capture;
+
+// Env that started the capture and its cleanup hook argument (capture generation), see `StartCapture`
+static napi_env captureEnv = nullptr;
+static std::atomic<uintptr_t> captureGeneration{0};
+
+static void CaptureRingWrite(uint64_t &head, const uint8_t *data, size_t length)
+{
+    size_t mask = capture.ring.size() - 1;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        capture.ring[(head + i) & mask] = data[i];
+    }
+
+    head += length;
+}
+
+static void CaptureRecordHeader(uint8_t *header, uint32_t deltaUs, uint8_t flags, uint16_t length)
+{
+    header[0] = static_cast<uint8_t>(deltaUs);
+    header[1] = static_cast<uint8_t>(deltaUs >> 8);
+    header[2] = static_cast<uint8_t>(deltaUs >> 16);
+    header[3] = static_cast<uint8_t>(deltaUs >> 24);
+    header[4] = flags;
+    header[5] = LOW_BYTE(length);
+    header[6] = HIGH_BYTE(length);
+}
+
+/**
+ * Queue the frame assembled for `direction` as a record (dropped if the ring is full, never blocks).
+ */
+static void CaptureCommit(CaptureDirection direction)
+{
+    auto &frame = capture.frames[direction];
+    uint64_t now = uv_hrtime();
+    uint64_t deltaUs = (now - capture.lastNs) / 1000;
+    bool sync = deltaUs > UINT32_MAX;
+    size_t size = (sync ? CAPTURE_RECORD_HEADER_SIZE + 8 : 0) + CAPTURE_RECORD_HEADER_SIZE + frame.length;
+    uint64_t head = capture.head.load(std::memory_order_relaxed);
+
+    if (capture.ring.size() - (head - capture.tail.load(std::memory_order_acquire)) < size)
+    {
+        capture.dropped.fetch_add(1, std::memory_order_relaxed);
+        capture.dropping = true;
+    }
+    else
+    {
+        uint8_t header[CAPTURE_RECORD_HEADER_SIZE];
+
+        if (sync)
+        {
+            uint64_t sinceStart = now - capture.startNs;
+            uint8_t payload[8];
+
+            for (size_t i = 0; i < sizeof(payload); i++)
+            {
+                payload[i] = static_cast<uint8_t>(sinceStart >> (i * 8));
+            }
+
+            CaptureRecordHeader(header, 0, CAPTURE_FLAG_TIME, sizeof(payload));
+            CaptureRingWrite(head, header, sizeof(header));
+            CaptureRingWrite(head, payload, sizeof(payload));
+
+            deltaUs = 0;
+            capture.lastNs = now;
+        }
+        else
+        {
+            // keep sub-µs remainders, deltas sum up to the real elapsed time
+            capture.lastNs += deltaUs * 1000;
+        }
+
+        uint8_t flags = (direction == CAPTURE_NCP_TO_HOST ? CAPTURE_FLAG_NCP_TO_HOST : 0) | (frame.truncated ? CAPTURE_FLAG_TRUNCATED : 0) |
+                        (capture.dropping ? CAPTURE_FLAG_DROPPED : 0);
+
+        CaptureRecordHeader(header, static_cast<uint32_t>(deltaUs), flags, frame.length);
+        CaptureRingWrite(head, header, sizeof(header));
+        CaptureRingWrite(head, frame.bytes, frame.length);
+        capture.head.store(head, std::memory_order_release);
+
+        capture.dropping = false;
+        capture.records.fetch_add(1, std::memory_order_relaxed);
+
+        if (frame.truncated)
+        {
+            capture.truncated.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    frame.length = 0;
+    frame.truncated = false;
+}
+
+/**
+ * Serial byte hook, assembles frames up to their closing Flag or Cancel.
+ */
+static inline void CaptureByte(CaptureDirection direction, uint8_t byte)
+{
+    if (!capture.active.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    auto &frame = capture.frames[direction];
+
+    if (frame.length < CAPTURE_MAX_FRAME_SIZE)
+    {
+        frame.bytes[frame.length++] = byte;
+    }
+    else
+    {
+        frame.truncated = true;
+    }
+
+    if (byte == CAPTURE_FRAME_END || byte == CAPTURE_FRAME_CANCEL)
+    {
+        CaptureCommit(direction);
+    }
+}
+
+/**
+ * Drain the ring to the file until stopped, then one last time.
+ */
+static void CaptureWriterLoop(void)
+{
+    size_t mask = capture.ring.size() - 1;
+
+    for (;;)
+    {
+        // read before `head`: once stopped, everything produced is already visible
+        bool running = capture.writerRunning.load(std::memory_order_acquire);
+        uint64_t head = capture.head.load(std::memory_order_acquire);
+        uint64_t tail = capture.tail.load(std::memory_order_relaxed);
+
+        while (tail != head)
+        {
+            size_t offset = tail & mask;
+            size_t chunk = std::min<uint64_t>(head - tail, capture.ring.size() - offset);
+            ssize_t n = write(capture.fd, capture.ring.data() + offset, chunk);
+
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (n <= 0)
+            {
+                // unwritable, drop what is buffered rather than stall the producer
+                capture.writeErrors.fetch_add(1, std::memory_order_relaxed);
+                tail = head;
+                break;
+            }
+
+            tail += n;
+            capture.written.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        capture.tail.store(tail, std::memory_order_release);
+
+        if (!running)
+        {
+            break;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(CAPTURE_WRITER_INTERVAL_MS));
+    }
+}
+
+/**
+ * @return errno of the failed open/write, 0 on success
+ */
+static int CaptureStart(const std::string &path, size_t bufferSize)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0)
+    {
+        return errno;
+    }
+
+    uv_timeval64_t wallClock;
+    uv_gettimeofday(&wallClock);
+
+    uint64_t startNs = uv_hrtime();
+    uint64_t startUs = static_cast<uint64_t>(wallClock.tv_sec) * 1000000 + wallClock.tv_usec;
+    uint8_t header[CAPTURE_FILE_HEADER_SIZE] = {0};
+
+    memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC) - 1);
+    header[7] = CAPTURE_FORMAT_VERSION;
+
+    for (size_t i = 0; i < 8; i++)
+    {
+        header[8 + i] = static_cast<uint8_t>(startUs >> (i * 8));
+        header[16 + i] = static_cast<uint8_t>(startNs >> (i * 8));
+    }
+
+    if (write(fd, header, sizeof(header)) != static_cast<ssize_t>(sizeof(header)))
+    {
+        int error = errno ? errno : EIO;
+
+        close(fd);
+        return error;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+    capture.path = path;
+    capture.fd = fd;
+    capture.ring.assign(bufferSize, 0);
+    capture.head.store(0, std::memory_order_relaxed);
+    capture.tail.store(0, std::memory_order_relaxed);
+    capture.startNs = startNs;
+    capture.lastNs = startNs;
+    capture.dropping = false;
+    capture.frames[CAPTURE_HOST_TO_NCP].length = 0;
+    capture.frames[CAPTURE_HOST_TO_NCP].truncated = false;
+    capture.frames[CAPTURE_NCP_TO_HOST].length = 0;
+    capture.frames[CAPTURE_NCP_TO_HOST].truncated = false;
+    capture.records.store(0, std::memory_order_relaxed);
+    capture.dropped.store(0, std::memory_order_relaxed);
+    capture.truncated.store(0, std::memory_order_relaxed);
+    capture.written.store(sizeof(header), std::memory_order_relaxed);
+    capture.writeErrors.store(0, std::memory_order_relaxed);
+
+    capture.writerRunning.store(true, std::memory_order_release);
+    capture.writer = std::thread(CaptureWriterLoop);
+    capture.active.store(true, std::memory_order_relaxed);
+
+    return 0;
+}
+
+/**
+ * Stop capturing, flush the ring and close the file. Frames still being assembled are not written.
+ */
+static void CaptureStop(void)
+{
+    {
+        // no producer past this point
+        std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+        if (!capture.active.exchange(false))
+        {
+            return;
+        }
+    }
+
+    capture.writerRunning.store(false, std::memory_order_release);
+
+    if (capture.writer.joinable())
+    {
+        capture.writer.join();
+    }
+
+    if (fsync(capture.fd) != 0 && errno != EINVAL)
+    {
+        capture.writeErrors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    close(capture.fd);
+    capture.fd = -1;
+    capture.ring.clear();
+    capture.ring.shrink_to_fit();
+}
+
+/**
+ * Stop the capture when the env that started it goes away (process exit, worker terminated), flushing and joining the writer.
+ * @param arg Generation of that capture, a later one (started from another env) is left running
+ */
+static void CaptureCleanupHook(void *arg)
+{
+    if (reinterpret_cast<uintptr_t>(arg) == captureGeneration.load())
+    {
+        captureEnv = nullptr;
+        CaptureStop();
+    }
+}
+
+// #endregion Frame capture
+
+extern "C"
+{
+    extern sli_ash_host_config_t ashHostConfig;
+
+    // #region EZSP Callbacks Bindings
+
+    void sl_zigbee_ezsp_error_handler(sl_zigbee_ezsp_status_t status)
+    {
+        if (IsCommandError(status))
+        {
+            // the command in progress, if any, won't get its response
+            CommandStatsEnd(false);
+        }
+
+        if (status != SL_ZIGBEE_EZSP_ERROR_QUEUE_FULL)
+        {
+            sl_zigbee_ezsp_print_elapsed_time();
+            ezspDebugPrintf("EZSP: ERROR: sl_zigbee_ezsp_error_handler 0x%02X", status);
+        }
+
+        if (status == SL_ZIGBEE_EZSP_ERROR_OVERFLOW)
+        {
+            sl_zigbee_ezsp_print_elapsed_time();
+            ezspDebugPrintf("EZSP: WARNING: the NCP has run out of buffers, causing general malfunction. Remediate network congestion, if present.");
+        }
+
+        if (status == SL_ZIGBEE_EZSP_ERROR_OVERFLOW || status == SL_ZIGBEE_EZSP_ERROR_QUEUE_FULL)
+        {
+            // throttle sends (`congestionControl`)
+            CongestionOnError(status);
+        }
+
+        bool ncpNeedsResetAndInit = false;
+
+        // Do not reset if this is a decryption failure, as we ignored the packet
+        // Do not reset for a callback overflow or error queue, as we don't want the device to reboot under stress;
+        // Resetting under these conditions does not solve the problem as the problem is external to the NCP.
+        // Throttling the additional traffic and staggering things might make it better instead.
+        // For all other errors, we reset the NCP
+        if ((status != SL_ZIGBEE_EZSP_ERROR_SECURITY_PARAMETERS_INVALID) && (status != SL_ZIGBEE_EZSP_ERROR_OVERFLOW) &&
+            (status != SL_ZIGBEE_EZSP_ERROR_QUEUE_FULL))
+        {
+            ncpNeedsResetAndInit = true;
+        }
+
+        if (ncpNeedsResetAndInit && tsfn)
+        {
+            EmitEvent(
+                [status](Napi::Env env)
+                {
+                    napi_property_descriptor props[] = {
+                        Prop(env, KEY_name, Key(env, KEY_ncpNeedsResetAndInit)),
+                        Prop(env, KEY_status, Napi::Number::New(env, status)),
+                    };
+
+                    return NewObject(env, props);
+                });
+        }
+    }
+
+    void sl_zigbee_ezsp_stack_status_handler(sl_status_t status)
+    {
+        if (tsfn)
+        {
+            EmitEvent(
+                [status](Napi::Env env)
+                {
+                    napi_property_descriptor props[] = {
+                        Prop(env, KEY_name, Key(env, KEY_stackStatus)),
+                        Prop(env, KEY_status, Napi::Number::New(env, status)),
+                    };
+
+                    return NewObject(env, props);
+                });
+        }
+    }
+
+    void sl_zigbee_ezsp_message_sent_handler(sl_status_t status, sl_zigbee_outgoing_message_type_t type, uint16_t indexOrDestination,
+                                             sl_zigbee_aps_frame_t *apsFrame, uint16_t messageTag, uint8_t messageLength, uint8_t *messageContents)
+    {
+        CongestionOnMessageSent(status, messageTag, apsFrame);
+        EmitMessageSent(status, type, indexOrDestination, apsFrame, messageTag, messageLength, messageContents);
+    }
+
+    void sl_zigbee_ezsp_incoming_message_handler(sl_zigbee_incoming_message_type_t type, sl_zigbee_aps_frame_t *apsFrame,
+                                                 sl_zigbee_rx_packet_info_t *packetInfo, uint8_t messageLength, uint8_t *message)
+    {
+        if (tsfn && apsFrame && packetInfo && message)
+        {
+            if (type != SL_ZIGBEE_INCOMING_BROADCAST_LOOPBACK && type != SL_ZIGBEE_INCOMING_MULTICAST_LOOPBACK)
+            {
+                // assumed ZCL for any profile other than ZDO
+                ZclHeader zclHeader = apsFrame->profileId != 0 ? ParseZclHeader(message, messageLength) : ZclHeader{};
+
+                if (!messageFilters.empty() && MessageFiltered(type, apsFrame, packetInfo->sender_short_id, zclHeader))
+                {
+                    return;
+                }
+
+                if (duplicateWindowMs > 0 && IsDuplicateFrame(apsFrame, packetInfo->sender_short_id, message, messageLength))
+                {
+                    return;
+                }
+
+                if (reportCoalescingEnabled && CoalesceReport(type, apsFrame, packetInfo, messageLength, message, zclHeader))
+                {
+                    return;
+                }
+
+                EmitIncomingMessage(type, apsFrame, packetInfo, messageLength, message, zclHeader);
+            }
+        }
+    }
+
+    void sl_zigbee_ezsp_mac_filter_match_message_handler(sl_zigbee_mac_filter_match_data_t filterValueMatch,
+                                                         sl_zigbee_mac_passthrough_type_t legacyPassthroughType,
+                                                         sl_zigbee_rx_packet_info_t *packetInfo, uint8_t messageLength, uint8_t *messageContents)
+    {
+        if (tsfn && packetInfo && messageContents)
+        {
+            InterpanMessage interpan;
+
+            if (!ParseInterpanMessage(messageContents, messageLength, &interpan))
+            {
+                return;
+            }
+
+            if (interpan.clusterId != 0x1000 || interpan.profileId != 0xc05e)
+            {
+                // not TOUCHLINK
+                return;
+            }
+
+            uint16_t panId = interpan.panId;
+            uint16_t groupId = interpan.groupId;
+            uint8_t *payload = messageContents + interpan.payloadOffset;
+            uint8_t payloadLength = messageLength - interpan.payloadOffset;
+
+            PooledPayload payloadCopy = CopyToPayloadPool(payload, payloadLength);
+            sl_zigbee_rx_packet_info_t packetCopy = *packetInfo;
+
+            char sourceAddressRaw[19];
+            Eui64ToHexString(interpan.longAddress, sourceAddressRaw);
+            std::string sourceAddress(sourceAddressRaw);
+
+            EmitEvent(
+                [panId, sourceAddress, groupId, packetCopy, payloadCopy](Napi::Env env)
+                {
+                    napi_property_descriptor props[] = {
+                        Prop(env, KEY_name, Key(env, KEY_touchlinkMessage)),
+                        Prop(env, KEY_sourcePanId, Napi::Number::New(env, panId)),
+                        Prop(env, KEY_sourceAddress, Napi::String::New(env, sourceAddress)),
+                        Prop(env, KEY_groupId, Napi::Number::New(env, groupId)),
+                        Prop(env, KEY_lastHopLqi, Napi::Number::New(env, packetCopy.last_hop_lqi)),
+                        Prop(env, KEY_messageContents, PayloadToBuffer(env, payloadCopy)),
+                    };
+
+                    return NewObject(env, props);
+                });
+        }
+    }
+
+    void sl_zigbee_ezsp_trust_center_post_join_handler(sl_802154_short_addr_t newNodeId, sl_802154_long_addr_t newNodeEui64,
+                                                       sl_zigbee_device_update_t status, sl_zigbee_join_decision_t policyDecision,
+                                                       sl_802154_short_addr_t parentOfNewNodeId)
+    {
+        if (tsfn)
+        {
+            char hexStringRaw[19];
+            Eui64ToHexString(newNodeEui64, hexStringRaw);
+            std::string hexString(hexStringRaw);
+
+            EmitEvent(
+                [newNodeId, hexString, status, policyDecision, parentOfNewNodeId](Napi::Env env)
+                {
+                    napi_property_descriptor props[] = {
+                        Prop(env, KEY_name, Key(env, KEY_trustCenterJoin)),
+                        Prop(env, KEY_newNodeId, Napi::Number::New(env, newNodeId)),
+                        Prop(env, KEY_newNodeEui64, Napi::String::New(env, hexString)),
+                        Prop(env, KEY_status, Napi::Number::New(env, status)),
+                        Prop(env, KEY_policyDecision, Napi::Number::New(env, policyDecision)),
+                        Prop(env, KEY_parentOfNewNodeId, Napi::Number::New(env, parentOfNewNodeId)),
+                    };
+
+                    return NewObject(env, props);
+                });
+        }
+    }
+
+    void sl_zigbee_ezsp_gpep_incoming_message_handler(sl_zigbee_gp_params_t *param)
+    {
+        if (tsfn && param)
+        {
+            // ZCL frame transformation
+            // XXX: specific to zigbee-herdsman
+            if (param->addr.applicationId == SL_ZIGBEE_GP_APPLICATION_IEEE_ADDRESS)
+            {
+                fprintf(stderr, "ERROR: GreenPower Unsupported IEEE application ID");
+                return;
+            }
+
+            if (param->gpdCommandId == 0xe0 && param->gpdCommandPayloadLength == 0)
+            {
+                // XXX: seem to be receiving duplicate commissioningNotification from some devices, second one with empty payload?
+                //      this will mess with the process no doubt, so dropping them
+                return;
+            }
+
+            // after dropping empty commissioning notifications, the complete one would otherwise be seen as a repeat
+            if (gpDuplicateWindowMs > 0 && IsDuplicateGpdf(param))
+            {
+                return;
+            }
+
+            sl_zigbee_aps_frame_t apsFrame;
+            // leave room for the binary event header
+            PooledPayload payload = {AcquirePayloadSlot(), BINARY_EVENT_HEADER_SIZE, 0};
+            payload.length = BuildGpNotification(param, &apsFrame, payload.Data());
+
+            ZclHeader zclHeader = ParseZclHeader(payload.Data(), payload.length);
+            uint8_t lastHopLqi = param->packetInfo.last_hop_lqi;
+            // convert to uint16_t for regular Zigbee node ID
+            uint16_t sourceId = param->addr.id.sourceId & 0xffff;
+
+            if (binaryEventsEnabled)
+            {
+                EmitBinaryEvent(std::move(payload), BINARY_EVENT_INCOMING_MESSAGE, SL_ZIGBEE_INCOMING_UNICAST, &apsFrame, sourceId, lastHopLqi,
+                                param->packetInfo.last_hop_rssi, 0, 0, &zclHeader);
+                return;
+            }
+
+            EmitEvent(
+                [apsFrame, lastHopLqi, sourceId, zclHeader, payload](Napi::Env env)
+                {
+                    return IncomingMessageToObject(env, SL_ZIGBEE_INCOMING_UNICAST, &apsFrame, lastHopLqi, sourceId, zclHeader,
+                                                   PayloadToBuffer(env, payload));
+                });
+        }
+    }
+
+    void sl_zigbee_ezsp_incoming_route_error_handler(sl_status_t status, sl_802154_short_addr_t target)
+    {
+        sl_zigbee_ezsp_print_elapsed_time();
+        ezspDebugPrintf("EZSP: ERROR: Routing error 0x%02X for 0x%04X\r\n", status, target);
+    }
+
+    void sl_zigbee_ezsp_incoming_network_status_handler(uint8_t errorCode, sl_802154_short_addr_t target)
+    {
+        sl_zigbee_ezsp_print_elapsed_time();
+        ezspDebugPrintf("EZSP: ERROR: Routing error 0x%02X for 0x%04X", errorCode, target);
+    }
+
+    void sl_zigbee_ezsp_id_conflict_handler(sl_802154_short_addr_t id)
+    {
+        sl_zigbee_ezsp_print_elapsed_time();
+        ezspDebugPrintf("EZSP: ERROR: ID conflict for 0x%04X", id);
+    }
+
+    void sl_zigbee_ezsp_zigbee_key_establishment_handler(sl_802154_long_addr_t partner, sl_zigbee_key_status_t status)
+    {
+        char partnerEui64[19];
+        Eui64ToHexString(partner, partnerEui64);
+
+        sl_zigbee_ezsp_print_elapsed_time();
+        ezspDebugPrintf("EZSP: Key establishment status 0x%02X for 0x%s", status, partnerEui64);
+    }
+
+    // #endregion EZSP Callbacks Bindings
+
+    // #region SDK hooks (see `scripts/patches.ts`)
+
+    // `serialSendCommand`, frame about to be sent to the NCP
+    void ezspNapiOnCommandSent(uint16_t frameId, uint8_t sequence)
+    {
+        // previous one never got its response
+        CommandStatsEnd(false);
+
+        pendingCommand.active = true;
+        pendingCommand.frameId = frameId;
+        pendingCommand.sequence = sequence;
+        pendingCommand.txReDataFrames = ashCount.txReDataFrames;
+        pendingCommand.sentAt = uv_hrtime();
+    }
+
+    // `serialResponseReceived`, frame from the NCP (response or callback)
+    void ezspNapiOnResponseReceived(uint16_t frameId, uint8_t sequence)
+    {
+        if (pendingCommand.active && pendingCommand.frameId == frameId && pendingCommand.sequence == sequence)
+        {
+            CommandStatsEnd(true);
+        }
+    }
+
+    // `ash-host.c` serial I/O, renamed to these at compile time (see the `ash_host` target in `binding.gyp`)
+    sl_zigbee_ezsp_status_t ezspCaptureSerialWriteByte(uint8_t byte)
+    {
+        sl_zigbee_ezsp_status_t status = ezspSerialWriteByte(byte);
+
+        if (status == SL_ZIGBEE_EZSP_SUCCESS)
+        {
+            CaptureByte(CAPTURE_HOST_TO_NCP, byte);
+        }
+
+        return status;
+    }
+
+    sl_zigbee_ezsp_status_t ezspCaptureSerialReadByte(uint8_t *byte)
+    {
+        sl_zigbee_ezsp_status_t status = ezspSerialReadByte(byte);
+
+        if (status == SL_ZIGBEE_EZSP_SUCCESS)
+        {
+            CaptureByte(CAPTURE_NCP_TO_HOST, *byte);
+        }
+
+        return status;
+    }
+
+    // #endregion SDK hooks
+}
+
+namespace EzspNapi
+{
+    /**
+     * @param callback Empty if not given
+     */
+    static Napi::Value InitStack(Napi::Env env, Napi::Object config, Napi::Value callbackVal)
+    {
+        if (!config.Has("baudRate") || !config.Has("stopBits") || !config.Has("rtsCts") || !config.Has("outBlockLen") || !config.Has("inBlockLen") ||
+            !config.Has("traceFlags") || !config.Has("txK") || !config.Has("randomize") || !config.Has("ackTimeInit") || !config.Has("ackTimeMin") ||
+            !config.Has("ackTimeMax") || !config.Has("timeRst") || !config.Has("nrLowLimit") || !config.Has("nrHighLimit") || !config.Has("nrTime") ||
+            !config.Has("resetMethod"))
+        {
+            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        std::string serialPort = config.Has("serialPort") ? config.Get("serialPort").As<Napi::String>().Utf8Value() : "/dev/ttyS0";
+
+        if (serialPort.length() > 39)
+        {
+            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        strncpy(ashHostConfig.serialPort, serialPort.c_str(), sizeof(ashHostConfig.serialPort) - 1);
+        ashHostConfig.serialPort[sizeof(ashHostConfig.serialPort) - 1] = '\0';
+        ashHostConfig.baudRate = config.Get("baudRate").As<Napi::Number>().Uint32Value();
+        ashHostConfig.stopBits = config.Get("stopBits").As<Napi::Number>().Uint32Value();
+        ashHostConfig.rtsCts = config.Get("rtsCts").As<Napi::Boolean>().Value();
+        ashHostConfig.outBlockLen = config.Get("outBlockLen").As<Napi::Number>().Uint32Value();
+        ashHostConfig.inBlockLen = config.Get("inBlockLen").As<Napi::Number>().Uint32Value();
+        ashHostConfig.traceFlags = config.Get("traceFlags").As<Napi::Number>().Uint32Value();
+        ashHostConfig.txK = config.Get("txK").As<Napi::Number>().Uint32Value();
+        ashHostConfig.randomize = config.Get("randomize").As<Napi::Boolean>().Value();
+        ashHostConfig.ackTimeInit = config.Get("ackTimeInit").As<Napi::Number>().Uint32Value();
+        ashHostConfig.ackTimeMin = config.Get("ackTimeMin").As<Napi::Number>().Uint32Value();
+        ashHostConfig.ackTimeMax = config.Get("ackTimeMax").As<Napi::Number>().Uint32Value();
+        ashHostConfig.timeRst = config.Get("timeRst").As<Napi::Number>().Uint32Value();
+        ashHostConfig.nrLowLimit = config.Get("nrLowLimit").As<Napi::Number>().Uint32Value();
+        ashHostConfig.nrHighLimit = config.Get("nrHighLimit").As<Napi::Number>().Uint32Value();
+        ashHostConfig.nrTime = config.Get("nrTime").As<Napi::Number>().Uint32Value();
+        ashHostConfig.resetMethod = config.Get("resetMethod").As<Napi::Number>().Uint32Value();
+
+        if (config.Has("ioThread"))
+        {
+            Napi::Value ioThreadVal = config.Get("ioThread");
+
+            if (!ioThreadVal.IsBoolean())
+            {
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            ioThreadEnabled = ioThreadVal.As<Napi::Boolean>().Value();
+        }
+        else
+        {
+            ioThreadEnabled = false;
+        }
+
+        if (config.Has("eventDriven"))
+        {
+            Napi::Value eventDrivenVal = config.Get("eventDriven");
+
+            if (!eventDrivenVal.IsBoolean())
+            {
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            eventDrivenEnabled = eventDrivenVal.As<Napi::Boolean>().Value();
+        }
+        else
+        {
+            eventDrivenEnabled = false;
+        }
+
+        if (config.Has("binaryEvents"))
+        {
+            Napi::Value binaryEventsVal = config.Get("binaryEvents");
+
+            if (!binaryEventsVal.IsBoolean())
+            {
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            binaryEventsEnabled = binaryEventsVal.As<Napi::Boolean>().Value();
+        }
+        else
+        {
+            binaryEventsEnabled = false;
+        }
+
+        {
+            std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+            // sends queued (their callers only got their tag) and events batched under the previous settings (re-init without stop)
+            // are owed to the current callback
+            AbortQueuedSends();
+            FlushEvents();
+        }
+
+        eventBatchEnabled = false;
+        eventBatchMaxSize = EVENT_BATCH_DEFAULT_MAX_SIZE;
+        eventBatchMaxDelayMs = 0;
+
+        if (config.Has("eventBatch"))
+        {
+            Napi::Value eventBatchVal = config.Get("eventBatch");
+
+            if (!eventBatchVal.IsObject())
+            {
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            Napi::Object eventBatch = eventBatchVal.As<Napi::Object>();
+
+            if (eventBatch.Has("maxSize"))
+            {
+                Napi::Value maxSizeVal = eventBatch.Get("maxSize");
+
+                if (!maxSizeVal.IsNumber() || maxSizeVal.As<Napi::Number>().Uint32Value() < 1)
+                {
+                    Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+
+                eventBatchMaxSize = maxSizeVal.As<Napi::Number>().Uint32Value();
+            }
+
+            if (eventBatch.Has("maxDelay"))
+            {
+                Napi::Value maxDelayVal = eventBatch.Get("maxDelay");
+
+                if (!maxDelayVal.IsNumber())
+                {
+                    Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+
+                eventBatchMaxDelayMs = maxDelayVal.As<Napi::Number>().Uint32Value();
+            }
+
+            eventBatchEnabled = true;
+        }
+
+        // validated in full before any is applied, a throw leaves the previous settings
+        bool congestionOn = false;
+        uint32_t windowBounds[] = {CONGESTION_DEFAULT_MIN_WINDOW, CONGESTION_DEFAULT_MAX_WINDOW};
+        uint32_t maxQueued = CONGESTION_DEFAULT_MAX_QUEUED;
+        uint32_t quotas[SEND_PRIORITY_COUNT] = CONGESTION_DEFAULT_QUOTAS;
+        std::vector<uint16_t> bulk = {CONGESTION_DEFAULT_BULK_CLUSTER};
+
+        if (config.Has("congestionControl"))
+        {
+            Napi::Value congestionVal = config.Get("congestionControl");
+
+            if (!congestionVal.IsObject())
+            {
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            Napi::Object congestionControl = congestionVal.As<Napi::Object>();
+            const char *const windowNames[] = {"minWindow", "maxWindow"};
+
+            for (size_t i = 0; i < 2; i++)
+            {
+                if (congestionControl.Has(windowNames[i]) &&
+                    !GetIntegerInRange(congestionControl.Get(windowNames[i]), 1, CONGESTION_MAX_WINDOW, &windowBounds[i]))
+                {
+                    Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+            }
+
+            if (windowBounds[1] < windowBounds[0] ||
+                (congestionControl.Has("maxQueued") && !GetIntegerInRange(congestionControl.Get("maxQueued"), 0, CONGESTION_MAX_QUEUED, &maxQueued)))
+            {
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            if (congestionControl.Has("quotas"))
+            {
+                Napi::Value quotasVal = congestionControl.Get("quotas");
+
+                if (!quotasVal.IsArray() || quotasVal.As<Napi::Array>().Length() != SEND_PRIORITY_COUNT)
+                {
+                    Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+
+                for (uint32_t i = 0; i < SEND_PRIORITY_COUNT; i++)
+                {
+                    if (!GetIntegerInRange(quotasVal.As<Napi::Array>()[i], 1, CONGESTION_MAX_QUOTA, &quotas[i]))
+                    {
+                        Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                        return env.Undefined();
+                    }
+                }
+            }
+
+            if (congestionControl.Has("bulkClusters"))
+            {
+                Napi::Value bulkVal = congestionControl.Get("bulkClusters");
+
+                if (!bulkVal.IsArray())
+                {
+                    Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+
+                Napi::Array bulkArray = bulkVal.As<Napi::Array>();
+                bulk.clear();
+
+                for (uint32_t i = 0; i < bulkArray.Length(); i++)
+                {
+                    uint32_t clusterId;
+
+                    if (!GetIntegerInRange(bulkArray[i], 0, 0xFFFF, &clusterId))
+                    {
+                        Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                        return env.Undefined();
+                    }
+
+                    bulk.push_back(clusterId);
+                }
+            }
+
+            congestionOn = true;
+        }
+
+        {
+            // the I/O thread may be draining the queue
+            std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+            congestionEnabled = congestionOn;
+            congestion.minWindow = windowBounds[0];
+            congestion.maxWindow = windowBounds[1];
+            congestion.maxQueued = maxQueued;
+            std::copy(std::begin(quotas), std::end(quotas), std::begin(priorityQuotas));
+            bulkClusters = std::move(bulk);
+            ResetCongestion();
+        }
+
+        LoopStatsReset();
+
+        deliveryTimeoutMs = DELIVERY_DEFAULT_TIMEOUT_MS;
+
+        if (config.Has("deliveryTimeout"))
+        {
+            Napi::Value deliveryTimeoutVal = config.Get("deliveryTimeout");
+
+            if (!deliveryTimeoutVal.IsNumber() || deliveryTimeoutVal.As<Napi::Number>().Uint32Value() < 1)
+            {
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            deliveryTimeoutMs = deliveryTimeoutVal.As<Napi::Number>().Uint32Value();
+        }
+
+        duplicateWindowMs = 0;
+
+        if (config.Has("duplicateWindow"))
+        {
+            Napi::Value duplicateWindowVal = config.Get("duplicateWindow");
+
+            if (!duplicateWindowVal.IsNumber() || duplicateWindowVal.As<Napi::Number>().Int64Value() < 0 ||
+                duplicateWindowVal.As<Napi::Number>().Int64Value() > UINT32_MAX)
+            {
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            duplicateWindowMs = duplicateWindowVal.As<Napi::Number>().Uint32Value();
+        }
+
+        ResetDuplicates();
+
+        gpDuplicateWindowMs = 0;
+
+        if (config.Has("gpDuplicateWindow"))
+        {
+            Napi::Value gpDuplicateWindowVal = config.Get("gpDuplicateWindow");
+
+            if (!gpDuplicateWindowVal.IsNumber() || gpDuplicateWindowVal.As<Napi::Number>().Int64Value() < 0 ||
+                gpDuplicateWindowVal.As<Napi::Number>().Int64Value() > UINT32_MAX)
+            {
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            gpDuplicateWindowMs = gpDuplicateWindowVal.As<Napi::Number>().Uint32Value();
+        }
+
+        gpSources.clear();
+
+        reportCoalescingEnabled = false;
+        reportCoalescingIntervalMs = 0;
+        reportCoalescingMaxSources = REPORT_COALESCING_DEFAULT_MAX_SOURCES;
+
+        if (config.Has("reportCoalescing"))
+        {
+            Napi::Value reportCoalescingVal = config.Get("reportCoalescing");
+
+            if (!reportCoalescingVal.IsObject())
+            {
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            Napi::Object reportCoalescing = reportCoalescingVal.As<Napi::Object>();
+            Napi::Value intervalVal = reportCoalescing.Get("interval");
+            Napi::Value maxSourcesVal = reportCoalescing.Get("maxSources");
+
+            if (!intervalVal.IsNumber() || intervalVal.As<Napi::Number>().Uint32Value() < 1 ||
+                (!maxSourcesVal.IsUndefined() && (!maxSourcesVal.IsNumber() || maxSourcesVal.As<Napi::Number>().Uint32Value() < 1)))
+            {
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            reportCoalescingIntervalMs = intervalVal.As<Napi::Number>().Uint32Value();
+
+            if (!maxSourcesVal.IsUndefined())
+            {
+                reportCoalescingMaxSources = maxSourcesVal.As<Napi::Number>().Uint32Value();
+            }
+
+            reportCoalescingEnabled = true;
+        }
+
+        ResetReportCoalescing();
+
+        // Register callback handler if provided
+        if (!callbackVal.IsEmpty())
+        {
+            Napi::Function callback = callbackVal.As<Napi::Function>();
+            tsfn = CallbackTsfn::New(env, callback, "EZSP Callback", 0, 1);
+            jsCallback = Napi::Persistent(callback);
+            jsCallbackContext = std::make_unique<Napi::AsyncContext>(env, "EZSP Callback");
+        }
+
+        initialized = true;
+
+        return env.Undefined();
+    }
+
+    Napi::Value Init(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsObject() || (info.Length() >= 2 && !info[1].IsFunction()))
+        {
+            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Object config = info[0].As<Napi::Object>();
+        Napi::Value callback = info.Length() >= 2 ? info[1] : Napi::Value();
+
+        if (loopTickRunning)
+        {
+            auto configRef = std::make_shared<Napi::ObjectReference>(Napi::Persistent(config));
+            std::shared_ptr<Napi::FunctionReference> callbackRef;
+
+            if (!callback.IsEmpty())
+            {
+                callbackRef = std::make_shared<Napi::FunctionReference>(Napi::Persistent(callback.As<Napi::Function>()));
+            }
+
+            DeferLifecycle(env, [configRef, callbackRef](Napi::Env env)
+                           { InitStack(env, configRef->Value(), callbackRef ? callbackRef->Value() : Napi::Value()); });
+
+            return env.Undefined();
+        }
+
+        return InitStack(env, config, callback);
+    }
+
+    /**
+     * @param async Run `sl_zigbee_ezsp_init` off the JS thread, returns a Promise
+     */
+    static Napi::Value StartStack(Napi::Env env, bool async)
+    {
+        if (!initialized)
+        {
+            Napi::Error::New(env, "Not initialized - call init() first").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        ezspSequenceNumber = 0;
+        tickStats.pollWakeups = 0;
+        tickStats.timerWakeups = 0;
+        tickStats.ticks = 0;
+        LoopStatsReset();
+
+        auto execute = []()
+        {
+            // queued callers only got their tag
+            AbortQueuedSends();
+            ResetCongestion();
+
+            // Initialize EZSP (resets NCP and starts ASH protocol)
+            sl_zigbee_ezsp_status_t status = sl_zigbee_ezsp_init();
+
+            return [status](Napi::Env env) -> Napi::Value
+            {
+                ezspStartTick(status);
+
+                return Napi::Number::New(env, status);
+            };
+        };
+
+        return RunCommand(env, async, execute);
+    }
+
+    Napi::Value Start(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        bool async = info.Data() == &asyncCommandMarker;
+
+        if (loopTickRunning)
+        {
+            if (!async)
+            {
+                // the status can't be returned anymore, `async.start` resolves with it
+                DeferLifecycle(env, [](Napi::Env env) { StartStack(env, false); });
+
+                return env.Undefined();
+            }
+
+            auto deferred = std::make_shared<Napi::Promise::Deferred>(env);
+
+            DeferLifecycle(env,
+                           [deferred](Napi::Env env)
+                           {
+                               Napi::Value promise = StartStack(env, true);
+
+                               if (env.IsExceptionPending())
+                               {
+                                   deferred->Reject(env.GetAndClearPendingException().Value());
+                               }
+                               else
+                               {
+                                   deferred->Resolve(promise);
+                               }
+                           });
+
+            return deferred->Promise();
+        }
+
+        return StartStack(env, async);
+    }
+
+    static Napi::Value StopStack(Napi::Env env)
+    {
+        directDispatch = false;
+
+        // before the I/O thread goes: the ones it already ran resolve, the others reject
+        CancelQueuedCommands();
 
-    return true;
-}
+        // Stop tick timer
+        if (tickTimerActive)
+        {
+            uv_timer_stop(tickTimer);
+            uv_close((uv_handle_t *)tickTimer, [](uv_handle_t *handle) { delete (uv_timer_t *)handle; });
 
-/**
- * Convert sl_zigbee_key_data_t from native struct to JavaScript object
- * @param env Napi environment
- * @param key Native struct pointer
- * @return JavaScript object with `SLZigbeeKeyData`
- */
-inline Napi::Object ZigbeeKeyDataToObject(Napi::Env env, const sl_zigbee_key_data_t *key)
-{
-    Napi::Object obj = Napi::Object::New(env);
-    obj.Set("contents", Napi::Buffer<uint8_t>::Copy(env, key->contents, 16));
+            tickTimer = nullptr;
+            tickTimerActive = false;
+        }
 
-    return obj;
-}
-// #endregion Helper Functions for Type Conversions
+        serialPollClose();
 
-extern "C"
-{
-    extern sli_ash_host_config_t ashHostConfig;
+        // Stop I/O thread (must not hold the stack lock while joining)
+        bool ioThreadWasRunning;
 
-    // #region EZSP Callbacks Bindings
+        {
+            std::lock_guard<std::mutex> lock(ioTasksMutex);
 
-    void sl_zigbee_ezsp_error_handler(sl_zigbee_ezsp_status_t status)
-    {
-        if (status != SL_ZIGBEE_EZSP_ERROR_QUEUE_FULL)
+            ioThreadWasRunning = ioThreadRunning.exchange(false);
+        }
+
+        if (ioThreadWasRunning)
         {
-            sl_zigbee_ezsp_print_elapsed_time();
-            ezspDebugPrintf("EZSP: ERROR: sl_zigbee_ezsp_error_handler 0x%02X", status);
+            ioThreadWakeup();
+
+            if (ioThread.joinable())
+            {
+                ioThread.join();
+            }
+
+            // async commands still waiting for their turn are rejected
+            CancelIoTasks();
+            ioWakeupPipeClose();
         }
 
-        if (status == SL_ZIGBEE_EZSP_ERROR_OVERFLOW)
+        if (initialized)
         {
-            sl_zigbee_ezsp_print_elapsed_time();
-            ezspDebugPrintf("EZSP: WARNING: the NCP has run out of buffers, causing general malfunction. Remediate network congestion, if present.");
+            std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+            // Stop ASH protocol and cleanup serialPort
+            ashStop();
+
+            initialized = false;
         }
 
-        bool ncpNeedsResetAndInit = false;
+        // after the I/O thread is gone, nothing can settle them anymore
+        AbortDeliveries();
 
-        // Do not reset if this is a decryption failure, as we ignored the packet
-        // Do not reset for a callback overflow or error queue, as we don't want the device to reboot under stress;
-        // Resetting under these conditions does not solve the problem as the problem is external to the NCP.
-        // Throttling the additional traffic and staggering things might make it better instead.
-        // For all other errors, we reset the NCP
-        if ((status != SL_ZIGBEE_EZSP_ERROR_SECURITY_PARAMETERS_INVALID) && (status != SL_ZIGBEE_EZSP_ERROR_OVERFLOW) &&
-            (status != SL_ZIGBEE_EZSP_ERROR_QUEUE_FULL))
         {
-            ncpNeedsResetAndInit = true;
+            std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+            // before `tsfn` is released, tracked ones were rejected above
+            AbortQueuedSends();
         }
 
-        if (ncpNeedsResetAndInit && tsfn)
+        ResetCongestion();
+        // no tick left to deliver held reports
+        ResetReportCoalescing();
+
+        if (tsfn)
         {
-            tsfn.BlockingCall(
-                [status](Napi::Env env, Napi::Function jsCallback)
-                {
-                    Napi::Object event = Napi::Object::New(env);
-                    event.Set("name", Napi::String::New(env, "ncpNeedsResetAndInit"));
-                    event.Set("status", Napi::Number::New(env, status));
-                    jsCallback.Call({event});
-                });
+            std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+            // batched events are still delivered: `tsfn` runs the calls queued before its release,
+            // their builders (and payload slots) are released with them
+            FlushEvents();
+            tsfn.Release();
         }
+
+        jsCallback.Reset();
+        jsCallbackContext.reset();
+        // slabs still referenced by JS Buffers (or by the events flushed above) are kept
+        FreeIdlePayloadSlabs();
+
+        return env.Undefined();
     }
 
-    void sl_zigbee_ezsp_stack_status_handler(sl_status_t status)
+    Napi::Value Stop(const Napi::CallbackInfo &info)
     {
-        if (tsfn)
+        Napi::Env env = info.Env();
+
+        if (loopTickRunning)
         {
-            tsfn.BlockingCall(
-                [status](Napi::Env env, Napi::Function jsCallback)
-                {
-                    Napi::Object event = Napi::Object::New(env);
-                    event.Set("name", Napi::String::New(env, "stackStatus"));
-                    event.Set("status", Napi::Number::New(env, status));
-                    jsCallback.Call({event});
-                });
+            // tearing down mid-tick would pull the callback, timer and tsfn from under the running dispatch
+            DeferLifecycle(env, [](Napi::Env env) { StopStack(env); });
+
+            return env.Undefined();
         }
+
+        return StopStack(env);
     }
 
-    void sl_zigbee_ezsp_message_sent_handler(sl_status_t status, sl_zigbee_outgoing_message_type_t type, uint16_t indexOrDestination,
-                                             sl_zigbee_aps_frame_t *apsFrame, uint16_t messageTag, uint8_t messageLength, uint8_t *messageContents)
+    Napi::Value GetTickStats(const Napi::CallbackInfo &info)
     {
-        if (tsfn && apsFrame && messageContents)
-        {
-            // Capture data before async call
-            uint8_t *msgCopy = new uint8_t[messageLength];
-            memcpy(msgCopy, messageContents, messageLength);
-            sl_zigbee_aps_frame_t frameCopy = *apsFrame;
+        Napi::Env env = info.Env();
 
-            tsfn.BlockingCall(
-                [status, type, indexOrDestination, frameCopy, messageTag, messageLength, msgCopy](Napi::Env env, Napi::Function jsCallback)
-                {
-                    Napi::Object event = Napi::Object::New(env);
-                    event.Set("name", Napi::String::New(env, "messageSent"));
-                    event.Set("status", Napi::Number::New(env, status));
-                    event.Set("type", Napi::Number::New(env, type));
-                    event.Set("indexOrDestination", Napi::Number::New(env, indexOrDestination));
-                    event.Set("apsFrame", ApsFrameToObject(env, &frameCopy));
-                    event.Set("messageTag", Napi::Number::New(env, messageTag));
-                    event.Set("messageContents", Napi::Buffer<uint8_t>::Copy(env, msgCopy, messageLength));
-
-                    jsCallback.Call({event});
-                    delete[] msgCopy;
-                });
+        uint64_t pollWakeups = tickStats.pollWakeups.load(std::memory_order_relaxed);
+        uint64_t timerWakeups = tickStats.timerWakeups.load(std::memory_order_relaxed);
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("wakeups", Napi::Number::New(env, pollWakeups + timerWakeups));
+        result.Set("pollWakeups", Napi::Number::New(env, pollWakeups));
+        result.Set("timerWakeups", Napi::Number::New(env, timerWakeups));
+        result.Set("ticks", Napi::Number::New(env, tickStats.ticks.load(std::memory_order_relaxed)));
+
+        return result;
+    }
+
+    Napi::Value GetPayloadPoolStats(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        std::lock_guard<std::mutex> lock(payloadPoolMutex);
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("slabAllocations", Napi::Number::New(env, payloadPoolStats.slabAllocations));
+        result.Set("slabFrees", Napi::Number::New(env, payloadPoolStats.slabFrees));
+        result.Set("slots", Napi::Number::New(env, payloadSlabs.size() * PAYLOAD_SLAB_SLOTS));
+        result.Set("acquired", Napi::Number::New(env, payloadPoolStats.acquired));
+        result.Set("released", Napi::Number::New(env, payloadPoolStats.released));
+        result.Set("inUse", Napi::Number::New(env, payloadPoolStats.acquired - payloadPoolStats.released));
+
+        return result;
+    }
+
+    Napi::Value GetCongestionStats(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("enabled", Napi::Boolean::New(env, congestionEnabled));
+        result.Set("window", Napi::Number::New(env, static_cast<uint32_t>(congestion.window)));
+        result.Set("inFlight", Napi::Number::New(env, congestion.inFlight.size()));
+        result.Set("queued", Napi::Number::New(env, queuedCount));
+
+        Napi::Array queuedByPriority = Napi::Array::New(env, SEND_PRIORITY_COUNT);
+
+        for (uint32_t i = 0; i < SEND_PRIORITY_COUNT; i++)
+        {
+            queuedByPriority[i] = Napi::Number::New(env, queuedMessages[i].size());
         }
+
+        result.Set("queuedByPriority", queuedByPriority);
+        result.Set("admitted", Napi::Number::New(env, congestionStats.admitted));
+        result.Set("deferred", Napi::Number::New(env, congestionStats.deferred));
+        result.Set("dropped", Napi::Number::New(env, congestionStats.dropped));
+        result.Set("overflowErrors", Napi::Number::New(env, congestionStats.overflowErrors));
+        result.Set("queueFullErrors", Napi::Number::New(env, congestionStats.queueFullErrors));
+        result.Set("decreases", Napi::Number::New(env, congestionStats.decreases));
+
+        return result;
     }
 
-    void sl_zigbee_ezsp_incoming_message_handler(sl_zigbee_incoming_message_type_t type, sl_zigbee_aps_frame_t *apsFrame,
-                                                 sl_zigbee_rx_packet_info_t *packetInfo, uint8_t messageLength, uint8_t *message)
+    Napi::Value GetCommandStats(const Napi::CallbackInfo &info)
     {
-        if (tsfn && apsFrame && packetInfo && message)
+        Napi::Env env = info.Env();
+
+        if (info.Length() > 0 && !info[0].IsUndefined() && !info[0].IsBoolean())
         {
-            if (type != SL_ZIGBEE_INCOMING_BROADCAST_LOOPBACK && type != SL_ZIGBEE_INCOMING_MULTICAST_LOOPBACK)
-            {
-                // Capture data before async call
-                uint8_t *msgCopy = new uint8_t[messageLength];
-                memcpy(msgCopy, message, messageLength);
-                sl_zigbee_aps_frame_t frameCopy = *apsFrame;
-                sl_zigbee_rx_packet_info_t packetCopy = *packetInfo;
+            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
 
-                if (apsFrame->profileId == 0)
-                {
-                    // ZDO
-                    tsfn.BlockingCall(
-                        [type, frameCopy, packetCopy, messageLength, msgCopy](Napi::Env env, Napi::Function jsCallback)
-                        {
-                            Napi::Object event = Napi::Object::New(env);
-                            event.Set("name", Napi::String::New(env, "zdoResponse"));
-                            event.Set("apsFrame", ApsFrameToObject(env, &frameCopy));
-                            event.Set("sender", Napi::Number::New(env, packetCopy.sender_short_id));
-                            event.Set("messageContents", Napi::Buffer<uint8_t>::Copy(env, msgCopy, messageLength));
-
-                            jsCallback.Call({event});
-                            delete[] msgCopy;
-                        });
-                }
-                else
-                {
-                    // assumed ZCL
-                    tsfn.BlockingCall(
-                        [type, frameCopy, packetCopy, messageLength, msgCopy](Napi::Env env, Napi::Function jsCallback)
-                        {
-                            Napi::Object event = Napi::Object::New(env);
-                            event.Set("name", Napi::String::New(env, "incomingMessage"));
-                            event.Set("type", Napi::Number::New(env, type));
-                            event.Set("apsFrame", ApsFrameToObject(env, &frameCopy));
-                            event.Set("lastHopLqi", Napi::Number::New(env, packetCopy.last_hop_lqi));
-                            event.Set("sender", Napi::Number::New(env, packetCopy.sender_short_id));
-                            event.Set("messageContents", Napi::Buffer<uint8_t>::Copy(env, msgCopy, messageLength));
-
-                            jsCallback.Call({event});
-                            delete[] msgCopy;
-                        });
-                }
+        bool reset = info.Length() > 0 && info[0].IsBoolean() && info[0].As<Napi::Boolean>().Value();
+        std::vector<std::pair<uint16_t, CommandStats>> snapshot;
+
+        {
+            std::lock_guard<std::mutex> lock(commandStatsMutex);
+
+            snapshot.assign(commandStats.begin(), commandStats.end());
+
+            if (reset)
+            {
+                commandStats.clear();
             }
         }
+
+        std::sort(snapshot.begin(), snapshot.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+        Napi::Array result = Napi::Array::New(env, snapshot.size());
+
+        for (size_t i = 0; i < snapshot.size(); i++)
+        {
+            const CommandStats &stats = snapshot[i].second;
+
+            Napi::Object entry = Napi::Object::New(env);
+            entry.Set("frameId", Napi::Number::New(env, snapshot[i].first));
+            entry.Set("timeouts", Napi::Number::New(env, stats.timeouts));
+            entry.Set("retries", Napi::Number::New(env, stats.retries));
+            SetLatencyHistogram(env, entry, stats.latency);
+
+            result[static_cast<uint32_t>(i)] = entry;
+        }
+
+        return result;
     }
 
-    void sl_zigbee_ezsp_mac_filter_match_message_handler(sl_zigbee_mac_filter_match_data_t filterValueMatch,
-                                                         sl_zigbee_mac_passthrough_type_t legacyPassthroughType,
-                                                         sl_zigbee_rx_packet_info_t *packetInfo, uint8_t messageLength, uint8_t *messageContents)
+    Napi::Value GetLoopStats(const Napi::CallbackInfo &info)
     {
-        if (tsfn && packetInfo && messageContents)
+        Napi::Env env = info.Env();
+
+        if (info.Length() > 0 && !info[0].IsUndefined() && !info[0].IsBoolean())
         {
-            // cf `parseInterpanMessage` in `simplicity_sdk/protocol/zigbee/app/framework/plugin/interpan/interpan.c`
-            uint8_t *finger = messageContents;
+            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
 
-            // We rely on the stack to insure that the MAC frame is formatted
-            // correctly and that the length is at least long enough
-            // to contain that frame.
+        static const char *const stallSources[] = {"none", "tick", "dispatch"};
 
-            uint16_t macFrameControl = HIGH_LOW_TO_INT(finger[1], finger[0]) & ~(MAC_ACK_REQUIRED);
+        uint64_t nowNs = uv_hrtime();
+        uint64_t windowStartNs;
+        LatencyHistogram tickHistogram = {};
+        LatencyHistogram dispatchHistogram = {};
 
-            if (macFrameControl == LONG_DEST_FRAME_CONTROL)
-            {
-                // control, sequence, dest PAN ID, long dest
-                finger += 2 + 1 + 2 + 8;
-            }
-            else if (macFrameControl == SHORT_DEST_FRAME_CONTROL)
-            {
-                // control, sequence, dest PAN ID, short dest
-                finger += 2 + 1 + 2 + 2;
-            }
-            else
-            {
-                return;
-            }
+        LoopStatsMerge(nowNs, tickHistogram, dispatchHistogram, &windowStartNs);
 
-            uint16_t panId = HIGH_LOW_TO_INT(finger[1], finger[0]);
-            finger += 2;
-            sl_802154_long_addr_t longAddress;
-            memmove(longAddress, finger, 8);
-            finger += 8;
+        Napi::Object tick = Napi::Object::New(env);
+        SetLatencyHistogram(env, tick, tickHistogram);
 
-            uint8_t remainingLength = messageLength - (uint8_t)(finger - messageContents);
+        Napi::Object dispatch = Napi::Object::New(env);
+        SetLatencyHistogram(env, dispatch, dispatchHistogram);
 
-            if (remainingLength < (STUB_NWK_SIZE + MIN_STUB_APS_SIZE))
-            {
-                return;
-            }
+        Napi::Object worstStall = Napi::Object::New(env);
+        worstStall.Set("duration", Napi::Number::New(env, loopStats.worstStallUs));
+        worstStall.Set("source", Napi::String::New(env, stallSources[loopStats.worstStallSource]));
+        worstStall.Set("at", Napi::Number::New(env, loopStats.worstStallAt));
 
-            if (HIGH_LOW_TO_INT(finger[1], finger[0]) != STUB_NWK_FRAME_CONTROL)
-            {
-                return;
-            }
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("elapsed", Napi::Number::New(env, (nowNs - windowStartNs) / 1000));
+        result.Set("tick", tick);
+        result.Set("dispatch", dispatch);
+        result.Set("worstStall", worstStall);
+
+        if (info.Length() > 0 && info[0].IsBoolean() && info[0].As<Napi::Boolean>().Value())
+        {
+            LoopStatsReset();
+        }
 
-            finger += 2;
-            remainingLength -= 2;
+        return result;
+    }
 
-            uint8_t apsFrameControl = (*finger++);
+    Napi::Value SetMessageFilters(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
 
-            if ((apsFrameControl & ~(INTERPAN_APS_FRAME_DELIVERY_MODE_MASK) & ~INTERPAN_APS_FRAME_SECURITY) !=
-                INTERPAN_APS_FRAME_CONTROL_NO_DELIVERY_MODE)
-            {
-                fprintf(stderr, "ERROR: Inter-PAN Bad APS frame control 0x%02X", apsFrameControl);
-                return;
-            }
+        if (info.Length() < 1 || !info[0].IsArray())
+        {
+            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        static const struct
+        {
+            const char *name;
+            uint8_t field;
+            uint32_t max;
+        } filterFields[] = {
+            {"type", MESSAGE_FILTER_TYPE, 0xFF},
+            {"profileId", MESSAGE_FILTER_PROFILE, 0xFFFF},
+            {"clusterId", MESSAGE_FILTER_CLUSTER, 0xFFFF},
+            {"sourceEndpoint", MESSAGE_FILTER_SOURCE_ENDPOINT, 0xFF},
+            {"destinationEndpoint", MESSAGE_FILTER_DESTINATION_ENDPOINT, 0xFF},
+            {"sender", MESSAGE_FILTER_SENDER, 0xFFFF},
+            {"frameType", MESSAGE_FILTER_FRAME_TYPE, 0x01},
+            {"commandId", MESSAGE_FILTER_COMMAND, 0xFF},
+        };
+
+        Napi::Array filtersArray = info[0].As<Napi::Array>();
+        std::vector<MessageFilter> filters;
+
+        for (uint32_t i = 0; i < filtersArray.Length(); i++)
+        {
+            Napi::Value filterVal = filtersArray[i];
 
-            if (apsFrameControl & INTERPAN_APS_FRAME_SECURITY)
+            if (!filterVal.IsObject())
             {
-                // !ALLOW_APS_ENCRYPTED_MESSAGES => SL_STATUS_NOT_AVAILABLE
-                return;
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
             }
 
-            uint8_t messageType = (apsFrameControl & INTERPAN_APS_FRAME_DELIVERY_MODE_MASK);
-            uint16_t groupId = 0;
+            Napi::Object filterObj = filterVal.As<Napi::Object>();
+            MessageFilter filter = {};
+            uint32_t values[std::size(filterFields)] = {};
 
-            switch (messageType)
+            for (size_t f = 0; f < std::size(filterFields); f++)
             {
-            case SL_ZIGBEE_AF_INTER_PAN_UNICAST:
-            case SL_ZIGBEE_AF_INTER_PAN_BROADCAST:
-                // Broadcast and unicast have the same size messages
-                if (remainingLength < INTERPAN_APS_UNICAST_SIZE)
+                Napi::Value value = filterObj.Get(filterFields[f].name);
+
+                if (value.IsUndefined())
                 {
-                    return;
+                    continue;
                 }
 
-                break;
-            case SL_ZIGBEE_AF_INTER_PAN_MULTICAST:
-                if (remainingLength < INTERPAN_APS_MULTICAST_SIZE)
+                if (!value.IsNumber() || value.As<Napi::Number>().Uint32Value() > filterFields[f].max)
                 {
-                    return;
+                    Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                    return env.Undefined();
                 }
 
-                groupId = HIGH_LOW_TO_INT(finger[1], finger[0]);
-                finger += 2;
-
-                break;
-            default:
-                fprintf(stderr, "ERROR: Inter-PAN Bad Delivery Mode 0x%02X", messageType);
-                return;
+                filter.fields |= filterFields[f].field;
+                values[f] = value.As<Napi::Number>().Uint32Value();
             }
 
-            uint16_t clusterId = HIGH_LOW_TO_INT(finger[1], finger[0]);
-            finger += 2;
+            filter.type = values[0];
+            filter.profileId = values[1];
+            filter.clusterId = values[2];
+            filter.sourceEndpoint = values[3];
+            filter.destinationEndpoint = values[4];
+            filter.sender = values[5];
+            filter.frameType = values[6];
+            filter.commandId = values[7];
 
-            if (clusterId != 0x1000)
+            Napi::Value actionVal = filterObj.Get("action");
+            std::string action = actionVal.IsString() ? actionVal.As<Napi::String>().Utf8Value() : "";
+
+            if (!actionVal.IsUndefined() && action != "drop" && action != "accept")
             {
-                // not TOUCHLINK
-                return;
+                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+                return env.Undefined();
             }
 
-            uint16_t profileId = HIGH_LOW_TO_INT(finger[1], finger[0]);
-            finger += 2;
+            filter.drop = action != "accept";
+
+            filters.push_back(filter);
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(stackMutex);
 
-            if (profileId != 0xc05e)
+        messageFilters = std::move(filters);
+
+        return env.Undefined();
+    }
+
+    Napi::Value GetMessageFilterStats(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        if (info.Length() > 0 && !info[0].IsUndefined() && !info[0].IsBoolean())
+        {
+            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        bool reset = info.Length() > 0 && info[0].IsBoolean() && info[0].As<Napi::Boolean>().Value();
+
+        std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+        Napi::Array result = Napi::Array::New(env, messageFilters.size());
+
+        for (size_t i = 0; i < messageFilters.size(); i++)
+        {
+            result[static_cast<uint32_t>(i)] = Napi::Number::New(env, messageFilters[i].matches);
+
+            if (reset)
             {
-                // not TOUCHLINK
-                return;
+                messageFilters[i].matches = 0;
             }
+        }
+
+        return result;
+    }
+
+    Napi::Value GetDuplicateStats(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("window", Napi::Number::New(env, duplicateWindowMs));
+        result.Set("checked", Napi::Number::New(env, duplicateStats.checked));
+        result.Set("duplicates", Napi::Number::New(env, duplicateStats.duplicates));
+        result.Set("evictions", Napi::Number::New(env, duplicateStats.evictions));
+
+        return result;
+    }
+
+    Napi::Value GetGpDedupTable(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+        uint64_t now = NowMs();
+        Napi::Array result = Napi::Array::New(env, gpSources.size());
+        uint32_t i = 0;
+
+        for (const auto &[sourceId, source] : gpSources)
+        {
+            Napi::Object entry = Napi::Object::New(env);
+            entry.Set("sourceId", Napi::Number::New(env, sourceId));
+            entry.Set("frameCounter", Napi::Number::New(env, source.frameCounter));
+            entry.Set("sequenceNumber", Napi::Number::New(env, source.sequenceNumber));
+            entry.Set("commandId", Napi::Number::New(env, source.commandId));
+            entry.Set("age", Napi::Number::New(env, now - source.seenMs));
+            entry.Set("forwarded", Napi::Number::New(env, source.forwarded));
+            entry.Set("duplicates", Napi::Number::New(env, source.duplicates));
+
+            result[i++] = entry;
+        }
+
+        return result;
+    }
+
+    Napi::Value GetReportCoalescingStats(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("enabled", Napi::Boolean::New(env, reportCoalescingEnabled));
+        result.Set("interval", Napi::Number::New(env, reportCoalescingIntervalMs));
+        result.Set("sources", Napi::Number::New(env, reportSources.size()));
+        result.Set("heldSources", Napi::Number::New(env, heldReportSources));
+        result.Set("passed", Napi::Number::New(env, reportCoalescingStats.passed));
+        result.Set("held", Napi::Number::New(env, reportCoalescingStats.held));
+        result.Set("replaced", Napi::Number::New(env, reportCoalescingStats.replaced));
+        result.Set("flushed", Napi::Number::New(env, reportCoalescingStats.flushed));
+        result.Set("unparsed", Napi::Number::New(env, reportCoalescingStats.unparsed));
+        result.Set("overflows", Napi::Number::New(env, reportCoalescingStats.overflows));
+
+        return result;
+    }
+
+// `AshCount` fields, exposed as is
+#define ASH_COUNTERS(X)                                                                                                                 \
+    X(txBytes) X(txBlocks) X(txData) X(txAllFrames) X(txDataFrames) X(txAckFrames) X(txNakFrames) X(txReDataFrames) X(txN0Frames)     \
+    X(txN1Frames) X(txCancelled) X(rxBytes) X(rxBlocks) X(rxData) X(rxAllFrames) X(rxDataFrames) X(rxAckFrames) X(rxNakFrames)        \
+    X(rxReDataFrames) X(rxN0Frames) X(rxN1Frames) X(rxCancelled) X(rxCrcErrors) X(rxCommErrors) X(rxTooShort) X(rxTooLong)            \
+    X(rxBadControl) X(rxBadLength) X(rxBadAckNumber) X(rxNoBuffer) X(rxDuplicates) X(rxOutOfSequence) X(rxAckTimeouts)
+
+    // Last read of the ASH state (JS thread only)
+    static struct
+    {
+        AshCount counters;
+        uint16_t ackPeriod;
+        bool connected;
+    } ashStatsSnapshot;
+
+    Napi::Value GetAshStats(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
 
-            uint8_t payloadOffset = (finger - messageContents);
+        {
+            // an async command holds the stack for its whole round trip, polling must not wait for it: previous read then
+            std::unique_lock<std::recursive_mutex> lock(stackMutex, std::try_to_lock);
 
-            if (payloadOffset == 0)
+            if (lock.owns_lock())
             {
-                return;
+                ashStatsSnapshot.counters = ashCount;
+                ashStatsSnapshot.ackPeriod = ashGetAckPeriod();
+                ashStatsSnapshot.connected = ashIsConnected();
             }
+        }
+
+        const AshCount &counters = ashStatsSnapshot.counters;
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("connected", Napi::Boolean::New(env, ashStatsSnapshot.connected));
+        result.Set("ackPeriod", Napi::Number::New(env, ashStatsSnapshot.ackPeriod));
+        result.Set("ackTimeMin", Napi::Number::New(env, ashHostConfig.ackTimeMin));
+        result.Set("ackTimeMax", Napi::Number::New(env, ashHostConfig.ackTimeMax));
+#define ASH_COUNTER_SET(counter) result.Set(#counter, Napi::Number::New(env, counters.counter));
+        ASH_COUNTERS(ASH_COUNTER_SET)
+#undef ASH_COUNTER_SET
+
+        return result;
+    }
 
-            uint8_t *payload = messageContents + payloadOffset;
-            uint8_t payloadLength = messageLength - payloadOffset;
+    Napi::Value GetCaptureStats(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
 
-            uint8_t *payloadCopy = new uint8_t[payloadLength];
-            memcpy(payloadCopy, payload, payloadLength);
-            sl_zigbee_rx_packet_info_t packetCopy = *packetInfo;
+        uint64_t head = capture.head.load(std::memory_order_acquire);
+        uint64_t tail = capture.tail.load(std::memory_order_acquire);
 
-            char sourceAddressRaw[19];
-            Eui64ToHexString(longAddress, sourceAddressRaw);
-            std::string sourceAddress(sourceAddressRaw);
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("active", Napi::Boolean::New(env, capture.active.load(std::memory_order_relaxed)));
+        result.Set("path", Napi::String::New(env, capture.path));
+        result.Set("bufferSize", Napi::Number::New(env, capture.ring.size()));
+        result.Set("buffered", Napi::Number::New(env, head - tail));
+        result.Set("records", Napi::Number::New(env, capture.records.load(std::memory_order_relaxed)));
+        result.Set("dropped", Napi::Number::New(env, capture.dropped.load(std::memory_order_relaxed)));
+        result.Set("truncated", Napi::Number::New(env, capture.truncated.load(std::memory_order_relaxed)));
+        result.Set("written", Napi::Number::New(env, capture.written.load(std::memory_order_relaxed)));
+        result.Set("writeErrors", Napi::Number::New(env, capture.writeErrors.load(std::memory_order_relaxed)));
 
-            tsfn.BlockingCall(
-                [panId, sourceAddress, groupId, packetCopy, payloadLength, payloadCopy](Napi::Env env, Napi::Function jsCallback)
-                {
-                    Napi::Object event = Napi::Object::New(env);
-                    event.Set("name", Napi::String::New(env, "touchlinkMessage"));
-                    event.Set("sourcePanId", Napi::Number::New(env, panId));
-                    event.Set("sourceAddress", Napi::String::New(env, sourceAddress));
-                    event.Set("groupId", Napi::Number::New(env, groupId));
-                    event.Set("lastHopLqi", Napi::Number::New(env, packetCopy.last_hop_lqi));
-                    event.Set("messageContents", Napi::Buffer<uint8_t>::Copy(env, payloadCopy, payloadLength));
-
-                    jsCallback.Call({event});
-                    delete[] payloadCopy;
-                });
-        }
+        return result;
     }
 
-    void sl_zigbee_ezsp_trust_center_post_join_handler(sl_802154_short_addr_t newNodeId, sl_802154_long_addr_t newNodeEui64,
-                                                       sl_zigbee_device_update_t status, sl_zigbee_join_decision_t policyDecision,
-                                                       sl_802154_short_addr_t parentOfNewNodeId)
+    Napi::Value StartCapture(const Napi::CallbackInfo &info)
     {
-        if (tsfn)
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString() || (info.Length() > 1 && !info[1].IsUndefined() && !info[1].IsNumber()))
         {
-            char hexStringRaw[19];
-            Eui64ToHexString(newNodeEui64, hexStringRaw);
-            std::string hexString(hexStringRaw);
+            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
 
-            tsfn.BlockingCall(
-                [newNodeId, hexString, status, policyDecision, parentOfNewNodeId](Napi::Env env, Napi::Function jsCallback)
-                {
-                    Napi::Object event = Napi::Object::New(env);
-                    event.Set("name", Napi::String::New(env, "trustCenterJoin"));
-                    event.Set("newNodeId", Napi::Number::New(env, newNodeId));
-                    event.Set("newNodeEui64", Napi::String::New(env, hexString));
-                    event.Set("status", Napi::Number::New(env, status));
-                    event.Set("policyDecision", Napi::Number::New(env, policyDecision));
-                    event.Set("parentOfNewNodeId", Napi::Number::New(env, parentOfNewNodeId));
-                    jsCallback.Call({event});
-                });
+        if (capture.active.load(std::memory_order_relaxed))
+        {
+            Napi::Error::New(env, "Capture already active - call stopCapture() first").ThrowAsJavaScriptException();
+            return env.Undefined();
         }
-    }
 
-    void sl_zigbee_ezsp_gpep_incoming_message_handler(sl_zigbee_gp_params_t *param)
-    {
-        if (tsfn && param)
+        size_t bufferSize = CAPTURE_DEFAULT_BUFFER_SIZE;
+
+        if (info.Length() > 1 && info[1].IsNumber())
         {
-            // ZCL frame transformation
-            // XXX: specific to zigbee-herdsman
-            if (param->addr.applicationId == SL_ZIGBEE_GP_APPLICATION_IEEE_ADDRESS)
+            int64_t requested = info[1].As<Napi::Number>().Int64Value();
+
+            if (requested < CAPTURE_MIN_BUFFER_SIZE || requested > CAPTURE_MAX_BUFFER_SIZE)
             {
-                fprintf(stderr, "ERROR: GreenPower Unsupported IEEE application ID");
-                return;
+                Napi::RangeError::New(env, "Invalid bufferSize").ThrowAsJavaScriptException();
+                return env.Undefined();
             }
 
-            uint8_t commandIdentifier = 0x00;
-            uint16_t options = 0;
-
-            if (param->gpdCommandId == 0xe0)
-            {
-                // commissioning
-                if (param->gpdCommandPayloadLength == 0)
-                {
-                    // XXX: seem to be receiving duplicate commissioningNotification from some devices, second one with empty payload?
-                    //      this will mess with the process no doubt, so dropping them
-                    return;
-                }
+            // power of two for masking
+            bufferSize = CAPTURE_MIN_BUFFER_SIZE;
 
-                commandIdentifier = 0x04;
-                options = (param->addr.applicationId & 0x7) | ((param->bidirectionalInfo & 0x1) << 3) | ((param->gpdfSecurityLevel & 0x3) << 4) |
-                          ((param->gpdfSecurityKeyType & 0x7) << 6);
-            }
-            else
+            while (bufferSize < static_cast<size_t>(requested))
             {
-                options = (param->addr.applicationId & 0x7) | ((param->gpdfSecurityLevel & 0x3) << 6) | ((param->gpdfSecurityKeyType & 0x7) << 8) |
-                          ((param->bidirectionalInfo & 0x1) << 11);
+                bufferSize <<= 1;
             }
+        }
 
-            sl_zigbee_aps_frame_t apsFrame = {0};
-            apsFrame.profileId = 0xa1e0;         // GP
-            apsFrame.clusterId = 0x0021;         // GP
-            apsFrame.sourceEndpoint = 0xf2;      // GP
-            apsFrame.destinationEndpoint = 0xf2; // GP
-            apsFrame.options = 0;                // not used
-            apsFrame.groupId = 0x0b84;           // GP
-            apsFrame.sequence = 0;               // not used
-
-            uint8_t messageLength = 15 + param->gpdCommandPayloadLength;
-            uint8_t *msgCopy = new uint8_t[messageLength];
-
-            uint8_t *finger = msgCopy;
-            finger[0] = 0x01;
-            finger[1] = param->sequenceNumber;
-            finger[2] = commandIdentifier;
-            finger[3] = options & 0xFF;
-            finger[4] = (options >> 8) & 0xFF;
-            finger[5] = param->addr.id.sourceId & 0xFF;
-            finger[6] = (param->addr.id.sourceId >> 8) & 0xFF;
-            finger[7] = (param->addr.id.sourceId >> 16) & 0xFF;
-            finger[8] = (param->addr.id.sourceId >> 24) & 0xFF;
-            finger[9] = param->gpdSecurityFrameCounter & 0xFF;
-            finger[10] = (param->gpdSecurityFrameCounter >> 8) & 0xFF;
-            finger[11] = (param->gpdSecurityFrameCounter >> 16) & 0xFF;
-            finger[12] = (param->gpdSecurityFrameCounter >> 24) & 0xFF;
-            finger[13] = param->gpdCommandId;
-            finger[14] = param->gpdCommandPayloadLength;
-            memcpy(&finger[15], param->gpdCommandPayload, param->gpdCommandPayloadLength);
-
-            uint8_t lastHopLqi = param->packetInfo.last_hop_lqi;
-            // convert to uint16_t for regular Zigbee node ID
-            uint16_t sourceId = param->addr.id.sourceId & 0xffff;
+        int error = CaptureStart(info[0].As<Napi::String>().Utf8Value(), bufferSize);
 
-            tsfn.BlockingCall(
-                [apsFrame, lastHopLqi, sourceId, messageLength, msgCopy](Napi::Env env, Napi::Function jsCallback)
-                {
-                    Napi::Object event = Napi::Object::New(env);
-                    event.Set("name", Napi::String::New(env, "incomingMessage"));
-                    event.Set("type", Napi::Number::New(env, SL_ZIGBEE_INCOMING_UNICAST));
-                    event.Set("apsFrame", ApsFrameToObject(env, &apsFrame));
-                    event.Set("lastHopLqi", Napi::Number::New(env, lastHopLqi));
-                    event.Set("sender", Napi::Number::New(env, sourceId));
-                    event.Set("messageContents", Napi::Buffer<uint8_t>::Copy(env, msgCopy, messageLength));
-
-                    jsCallback.Call({event});
-                    delete[] msgCopy;
-                });
+        if (error != 0)
+        {
+            Napi::Error::New(env, std::string("Cannot open capture file: ") + strerror(error)).ThrowAsJavaScriptException();
+            return env.Undefined();
         }
-    }
 
-    void sl_zigbee_ezsp_incoming_route_error_handler(sl_status_t status, sl_802154_short_addr_t target)
-    {
-        sl_zigbee_ezsp_print_elapsed_time();
-        ezspDebugPrintf("EZSP: ERROR: Routing error 0x%02X for 0x%04X\r\n", status, target);
-    }
+        // only this env's teardown stops it, not that of any other env (worker) loading the addon
+        captureEnv = env;
+        napi_add_env_cleanup_hook(env, CaptureCleanupHook, reinterpret_cast<void *>(++captureGeneration));
 
-    void sl_zigbee_ezsp_incoming_network_status_handler(uint8_t errorCode, sl_802154_short_addr_t target)
-    {
-        sl_zigbee_ezsp_print_elapsed_time();
-        ezspDebugPrintf("EZSP: ERROR: Routing error 0x%02X for 0x%04X", errorCode, target);
+        return env.Undefined();
     }
 
-    void sl_zigbee_ezsp_id_conflict_handler(sl_802154_short_addr_t id)
+    Napi::Value StopCapture(const Napi::CallbackInfo &info)
     {
-        sl_zigbee_ezsp_print_elapsed_time();
-        ezspDebugPrintf("EZSP: ERROR: ID conflict for 0x%04X", id);
-    }
+        if (captureEnv == info.Env())
+        {
+            napi_remove_env_cleanup_hook(captureEnv, CaptureCleanupHook, reinterpret_cast<void *>(captureGeneration.load()));
+        }
 
-    void sl_zigbee_ezsp_zigbee_key_establishment_handler(sl_802154_long_addr_t partner, sl_zigbee_key_status_t status)
-    {
-        char partnerEui64[19];
-        Eui64ToHexString(partner, partnerEui64);
+        captureEnv = nullptr;
+        CaptureStop();
 
-        sl_zigbee_ezsp_print_elapsed_time();
-        ezspDebugPrintf("EZSP: Key establishment status 0x%02X for 0x%s", status, partnerEui64);
+        return GetCaptureStats(info);
     }
 
-    // #endregion EZSP Callbacks Bindings
-}
+#ifdef EZSP_BENCH
+    // Benchmark hooks, only built with `--ezsp_bench=1`
 
-namespace EzspNapi
-{
-    Napi::Value Init(const Napi::CallbackInfo &info)
+    Napi::Value BenchEventDispatch(const Napi::CallbackInfo &info)
     {
         Napi::Env env = info.Env();
 
-        if (info.Length() < 1 || !info[0].IsObject())
+        if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsBoolean())
         {
             Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
             return env.Undefined();
         }
 
-        Napi::Object config = info[0].As<Napi::Object>();
-
-        if (!config.Has("baudRate") || !config.Has("stopBits") || !config.Has("rtsCts") || !config.Has("outBlockLen") || !config.Has("inBlockLen") ||
-            !config.Has("traceFlags") || !config.Has("txK") || !config.Has("randomize") || !config.Has("ackTimeInit") || !config.Has("ackTimeMin") ||
-            !config.Has("ackTimeMax") || !config.Has("timeRst") || !config.Has("nrLowLimit") || !config.Has("nrHighLimit") || !config.Has("nrTime") ||
-            !config.Has("resetMethod"))
+        if (!tsfn || jsCallback.IsEmpty())
         {
-            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+            Napi::Error::New(env, "No callback - call init() with a callback first").ThrowAsJavaScriptException();
             return env.Undefined();
         }
 
-        std::string serialPort = config.Has("serialPort") ? config.Get("serialPort").As<Napi::String>().Utf8Value() : "/dev/ttyS0";
+        uint32_t count = info[0].As<Napi::Number>().Uint32Value();
+        bool direct = info[1].As<Napi::Boolean>().Value();
 
-        if (serialPort.length() > 39)
+        std::lock_guard<std::recursive_mutex> lock(stackMutex);
+
+        // same path as a callback fired by a tick run by the libuv loop (direct), or from any other context
+        directDispatch = direct;
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            sl_zigbee_ezsp_stack_status_handler(SL_STATUS_OK);
+        }
+
+        // end of tick
+        FlushEvents();
+
+        directDispatch = false;
+
+        return env.Undefined();
+    }
+
+    Napi::Value BenchEventMarshalling(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsBoolean())
         {
             Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
             return env.Undefined();
         }
 
-        strncpy(ashHostConfig.serialPort, serialPort.c_str(), sizeof(ashHostConfig.serialPort) - 1);
-        ashHostConfig.serialPort[sizeof(ashHostConfig.serialPort) - 1] = '\0';
-        ashHostConfig.baudRate = config.Get("baudRate").As<Napi::Number>().Uint32Value();
-        ashHostConfig.stopBits = config.Get("stopBits").As<Napi::Number>().Uint32Value();
-        ashHostConfig.rtsCts = config.Get("rtsCts").As<Napi::Boolean>().Value();
-        ashHostConfig.outBlockLen = config.Get("outBlockLen").As<Napi::Number>().Uint32Value();
-        ashHostConfig.inBlockLen = config.Get("inBlockLen").As<Napi::Number>().Uint32Value();
-        ashHostConfig.traceFlags = config.Get("traceFlags").As<Napi::Number>().Uint32Value();
-        ashHostConfig.txK = config.Get("txK").As<Napi::Number>().Uint32Value();
-        ashHostConfig.randomize = config.Get("randomize").As<Napi::Boolean>().Value();
-        ashHostConfig.ackTimeInit = config.Get("ackTimeInit").As<Napi::Number>().Uint32Value();
-        ashHostConfig.ackTimeMin = config.Get("ackTimeMin").As<Napi::Number>().Uint32Value();
-        ashHostConfig.ackTimeMax = config.Get("ackTimeMax").As<Napi::Number>().Uint32Value();
-        ashHostConfig.timeRst = config.Get("timeRst").As<Napi::Number>().Uint32Value();
-        ashHostConfig.nrLowLimit = config.Get("nrLowLimit").As<Napi::Number>().Uint32Value();
-        ashHostConfig.nrHighLimit = config.Get("nrHighLimit").As<Napi::Number>().Uint32Value();
-        ashHostConfig.nrTime = config.Get("nrTime").As<Napi::Number>().Uint32Value();
-        ashHostConfig.resetMethod = config.Get("resetMethod").As<Napi::Number>().Uint32Value();
+        uint32_t count = info[0].As<Napi::Number>().Uint32Value();
+        bool cached = info[1].As<Napi::Boolean>().Value();
 
-        // Register callback handler if provided
-        if (info.Length() >= 2)
+        sl_zigbee_aps_frame_t apsFrame = {0};
+        apsFrame.profileId = 0x0104;
+        apsFrame.clusterId = 0x0006;
+        apsFrame.sourceEndpoint = 0x01;
+        apsFrame.destinationEndpoint = 0x01;
+        apsFrame.options = 0x0140;
+        apsFrame.sequence = 0x2a;
+        // Report Attributes, OnOff = 1
+        const uint8_t report[] = {0x18, 0x2a, 0x0a, 0x00, 0x00, 0x10, 0x01};
+        Napi::Buffer<uint8_t> messageContents = Napi::Buffer<uint8_t>::Copy(env, report, sizeof(report));
+        ZclHeader zclHeader = ParseZclHeader(messageContents.Data(), messageContents.Length());
+
+        for (uint32_t i = 0; i < count; i++)
         {
-            if (!info[1].IsFunction())
+            Napi::HandleScope scope(env);
+
+            if (cached)
             {
-                Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
-                return env.Undefined();
+                IncomingMessageToObject(env, SL_ZIGBEE_INCOMING_UNICAST, &apsFrame, 0xff, 0x1234, zclHeader, messageContents);
+                continue;
             }
 
-            Napi::Function callback = info[1].As<Napi::Function>();
-            tsfn = Napi::ThreadSafeFunction::New(env, callback, "EZSP Callback", 0, 1);
+            // incremental construction with C string keys, as before the property key cache
+            Napi::Object frame = Napi::Object::New(env);
+            frame.Set("profileId", Napi::Number::New(env, apsFrame.profileId));
+            frame.Set("clusterId", Napi::Number::New(env, apsFrame.clusterId));
+            frame.Set("sourceEndpoint", Napi::Number::New(env, apsFrame.sourceEndpoint));
+            frame.Set("destinationEndpoint", Napi::Number::New(env, apsFrame.destinationEndpoint));
+            frame.Set("options", Napi::Number::New(env, apsFrame.options));
+            frame.Set("groupId", Napi::Number::New(env, apsFrame.groupId));
+            frame.Set("sequence", Napi::Number::New(env, apsFrame.sequence));
+            frame.Set("radius", Napi::Number::New(env, apsFrame.radius));
+
+            Napi::Object event = Napi::Object::New(env);
+            event.Set("name", Napi::String::New(env, "incomingMessage"));
+            event.Set("type", Napi::Number::New(env, SL_ZIGBEE_INCOMING_UNICAST));
+            event.Set("apsFrame", frame);
+            event.Set("lastHopLqi", Napi::Number::New(env, 0xff));
+            event.Set("sender", Napi::Number::New(env, 0x1234));
+            event.Set("messageContents", messageContents);
         }
 
-        initialized = true;
-
         return env.Undefined();
     }
 
-    Napi::Value Start(const Napi::CallbackInfo &info)
+    Napi::Value BenchApsFrame(const Napi::CallbackInfo &info)
     {
         Napi::Env env = info.Env();
 
-        if (!initialized)
+        if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsBoolean())
         {
-            Napi::Error::New(env, "Not initialized - call init() first").ThrowAsJavaScriptException();
+            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
             return env.Undefined();
         }
 
-        ezspSequenceNumber = 0;
-
-        // Initialize EZSP (resets NCP and starts ASH protocol)
-        sl_zigbee_ezsp_status_t status = sl_zigbee_ezsp_init();
+        uint32_t count = info[0].As<Napi::Number>().Uint32Value();
+        bool toObject = info[1].As<Napi::Boolean>().Value();
 
-        // Start tick timer for EZSP event processing (1ms interval)
-        if (status == SL_ZIGBEE_EZSP_SUCCESS && !tickTimerActive)
+        sl_zigbee_aps_frame_t apsFrame = {0};
+        apsFrame.profileId = 0x0104;
+        apsFrame.clusterId = 0x0006;
+        apsFrame.sourceEndpoint = 0x01;
+        apsFrame.destinationEndpoint = 0x01;
+        apsFrame.options = 0x0140;
+        apsFrame.sequence = 0x2a;
+        Napi::Object apsFrameObj = ApsFrameToObject(env, &apsFrame);
+
+        for (uint32_t i = 0; i < count; i++)
         {
-            uv_loop_t *loop = uv_default_loop();
-            uv_timer_init(loop, &tickTimer);
-            uv_timer_start(&tickTimer, ezspTickCallback, 1, 1); // 1ms initial, 1ms repeat
+            Napi::HandleScope scope(env);
 
-            tickTimerActive = true;
+            if (toObject)
+            {
+                ApsFrameToObject(env, &apsFrame);
+            }
+            else if (!ApsFrameFromObject(env, apsFrameObj, &apsFrame))
+            {
+                Napi::TypeError::New(env, "Invalid apsFrame").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
         }
 
-        return Napi::Number::New(env, status);
+        return env.Undefined();
     }
-
-    Napi::Value Stop(const Napi::CallbackInfo &info)
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+    /**
+     * Open a raw pseudo-terminal pair, for running the ASH host against an emulated NCP (no hardware, test tooling).
+     * The slave is held open so reads on the master don't fail (EIO) while no serial port is open on it.
+     */
+    Napi::Value OpenPseudoTerminal(const Napi::CallbackInfo &info)
     {
         Napi::Env env = info.Env();
 
-        // Stop tick timer
-        if (tickTimerActive)
-        {
-            uv_timer_stop(&tickTimer);
-            uv_close((uv_handle_t *)&tickTimer, nullptr);
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
 
-            tickTimerActive = false;
+        if (master < 0)
+        {
+            Napi::Error::New(env, std::string("posix_openpt: ") + strerror(errno)).ThrowAsJavaScriptException();
+            return env.Undefined();
         }
 
-        if (initialized)
-        {
-            // Stop ASH protocol and cleanup serialPort
-            ashStop();
+        // `ptsname_r` is missing from older macOS, `ptsname` (static buffer) is copied right away on the JS thread
+        const char *name = grantpt(master) == 0 && unlockpt(master) == 0 ? ptsname(master) : nullptr;
+        std::string path = name ? name : "";
+        int slave = name ? open(path.c_str(), O_RDWR | O_NOCTTY) : -1;
+        struct termios tios;
+        bool opened = slave >= 0 && tcgetattr(slave, &tios) == 0;
 
-            initialized = false;
+        if (opened)
+        {
+            // no line discipline processing before the host configures the port
+            cfmakeraw(&tios);
+            opened = tcsetattr(slave, TCSANOW, &tios) == 0;
         }
 
-        if (tsfn)
+        if (!opened)
         {
-            tsfn.Release();
+            std::string error = std::string("pseudo-terminal: ") + strerror(errno);
+
+            if (slave >= 0)
+            {
+                close(slave);
+            }
+
+            close(master);
+            Napi::Error::New(env, error).ThrowAsJavaScriptException();
+            return env.Undefined();
         }
 
-        return env.Undefined();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("master", Napi::Number::New(env, master));
+        result.Set("slave", Napi::Number::New(env, slave));
+        result.Set("path", Napi::String::New(env, path));
+
+        return result;
     }
+#endif
 
     // #region EZSP Command Bindings
 
@@ -1049,73 +5570,93 @@ namespace EzspNapi
 
         uint8_t desiredVersion = info[0].As<Napi::Number>().Uint32Value();
 
-        uint8_t stackType = 0;
-        uint16_t stackVersion = 0;
-        uint8_t protocolVersion = sl_zigbee_ezsp_version(desiredVersion, &stackType, &stackVersion);
-
-        // enforce protocol match (binding = 1 version supported)
-        if (protocolVersion != EZSP_PROTOCOL_VERSION)
+        auto execute = [desiredVersion]()
         {
-            Napi::TypeError::New(env, "ERROR: NCP EZSP protocol version does not match Host version! " + std::to_string(protocolVersion) + " vs " +
-                                          std::to_string(EZSP_PROTOCOL_VERSION))
-                .ThrowAsJavaScriptException();
-            return env.Undefined();
-        }
+            uint8_t stackType = 0;
+            uint16_t stackVersion = 0;
+            uint8_t protocolVersion = sl_zigbee_ezsp_version(desiredVersion, &stackType, &stackVersion);
 
-        Napi::Array result = Napi::Array::New(env, 3);
-        result[0u] = Napi::Number::New(env, protocolVersion);
-        result[1u] = Napi::Number::New(env, stackType);
-        result[2u] = Napi::Number::New(env, stackVersion);
+            return [protocolVersion, stackType, stackVersion](Napi::Env env) -> Napi::Value
+            {
+                // enforce protocol match (binding = 1 version supported)
+                if (protocolVersion != EZSP_PROTOCOL_VERSION)
+                {
+                    Napi::TypeError::New(env, "ERROR: NCP EZSP protocol version does not match Host version! " + std::to_string(protocolVersion) +
+                                                  " vs " + std::to_string(EZSP_PROTOCOL_VERSION))
+                        .ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
 
-        return result;
+                Napi::Array result = Napi::Array::New(env, 3);
+                result[0u] = Napi::Number::New(env, protocolVersion);
+                result[1u] = Napi::Number::New(env, stackType);
+                result[2u] = Napi::Number::New(env, stackVersion);
+
+                return result;
+            };
+        };
+
+        return RunCommand(info, execute);
     }
 
     Napi::Value GetEui64(const Napi::CallbackInfo &info)
     {
-        Napi::Env env = info.Env();
+        auto execute = []()
+        {
+            uint8_t eui64[8];
 
-        uint8_t eui64[8];
+            sl_zigbee_ezsp_get_eui64(eui64);
 
-        sl_zigbee_ezsp_get_eui64(eui64);
+            return [eui64](Napi::Env env) -> Napi::Value
+            {
+                char hexString[19];
+                Eui64ToHexString(eui64, hexString);
 
-        char hexString[19];
-        Eui64ToHexString(eui64, hexString);
+                return Napi::String::New(env, hexString);
+            };
+        };
 
-        return Napi::String::New(env, hexString);
+        return RunCommand(info, execute);
     }
 
     // Network Management Commands
 
     Napi::Value GetNetworkParameters(const Napi::CallbackInfo &info)
     {
-        Napi::Env env = info.Env();
-
-        sl_zigbee_node_type_t nodeType;
-
-        sl_zigbee_network_parameters_t params;
-        sl_status_t status = sl_zigbee_ezsp_get_network_parameters(&nodeType, &params);
+        auto execute = []()
+        {
+            sl_zigbee_node_type_t nodeType;
 
-        Napi::Array result = Napi::Array::New(env, 3);
-        result[0u] = Napi::Number::New(env, status);
+            sl_zigbee_network_parameters_t params;
+            sl_status_t status = sl_zigbee_ezsp_get_network_parameters(&nodeType, &params);
 
-        if (status == SL_STATUS_OK)
-        {
-            result[1u] = nodeType;
+            return [status, nodeType, params](Napi::Env env) -> Napi::Value
+            {
+                Napi::Array result = Napi::Array::New(env, 3);
+                result[0u] = Napi::Number::New(env, status);
 
-            Napi::Object response = Napi::Object::New(env);
-            response.Set("extendedPanId", Uint8ArrayToNumberArray(env, params.extendedPanId, 8));
-            response.Set("panId", Napi::Number::New(env, params.panId));
-            response.Set("radioTxPower", Napi::Number::New(env, params.radioTxPower));
-            response.Set("radioChannel", Napi::Number::New(env, params.radioChannel));
-            response.Set("joinMethod", Napi::Number::New(env, params.joinMethod));
-            response.Set("nwkManagerId", Napi::Number::New(env, params.nwkManagerId));
-            response.Set("nwkUpdateId", Napi::Number::New(env, params.nwkUpdateId));
-            response.Set("channels", Napi::Number::New(env, params.channels));
+                if (status == SL_STATUS_OK)
+                {
+                    result[1u] = nodeType;
+
+                    Napi::Object response = Napi::Object::New(env);
+                    response.Set("extendedPanId", Uint8ArrayToNumberArray(env, params.extendedPanId, 8));
+                    response.Set("panId", Napi::Number::New(env, params.panId));
+                    response.Set("radioTxPower", Napi::Number::New(env, params.radioTxPower));
+                    response.Set("radioChannel", Napi::Number::New(env, params.radioChannel));
+                    response.Set("joinMethod", Napi::Number::New(env, params.joinMethod));
+                    response.Set("nwkManagerId", Napi::Number::New(env, params.nwkManagerId));
+                    response.Set("nwkUpdateId", Napi::Number::New(env, params.nwkUpdateId));
+                    response.Set("channels", Napi::Number::New(env, params.channels));
+
+                    result[2u] = response;
+                }
 
-            result[2u] = response;
-        }
+                return result;
+            };
+        };
 
-        return result;
+        return RunCommand(info, execute);
     }
 
     Napi::Value NetworkInit(const Napi::CallbackInfo &info)
@@ -1139,18 +5680,12 @@ namespace EzspNapi
         sl_zigbee_network_init_struct_t initStruct = {0};
         initStruct.bitmask = paramsObj.Get("bitmask").As<Napi::Number>().Uint32Value();
 
-        sl_status_t status = sl_zigbee_ezsp_network_init(&initStruct);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() mutable { return StatusResult(sl_zigbee_ezsp_network_init(&initStruct)); });
     }
 
     Napi::Value NetworkState(const Napi::CallbackInfo &info)
     {
-        Napi::Env env = info.Env();
-
-        sl_zigbee_network_status_t status = sl_zigbee_ezsp_network_state();
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, []() { return StatusResult(sl_zigbee_ezsp_network_state()); });
     }
 
     Napi::Value FormNetwork(const Napi::CallbackInfo &info)
@@ -1190,20 +5725,14 @@ namespace EzspNapi
         params.nwkUpdateId = paramsObj.Get("nwkUpdateId").As<Napi::Number>().Uint32Value();
         params.channels = paramsObj.Get("channels").As<Napi::Number>().Uint32Value();
 
-        sl_status_t status = sl_zigbee_ezsp_form_network(&params);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() mutable { return StatusResult(sl_zigbee_ezsp_form_network(&params)); });
     }
 
     Napi::Value LeaveNetwork(const Napi::CallbackInfo &info)
     {
-        Napi::Env env = info.Env();
-
         sl_zigbee_leave_network_option_t options = info.Length() >= 1 && info[0].IsNumber() ? info[0].As<Napi::Number>().Uint32Value() : 0;
 
-        sl_status_t status = sl_zigbee_ezsp_leave_network(options);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() { return StatusResult(sl_zigbee_ezsp_leave_network(options)); });
     }
 
     Napi::Value PermitJoining(const Napi::CallbackInfo &info)
@@ -1218,9 +5747,7 @@ namespace EzspNapi
 
         uint8_t duration = info[0].As<Napi::Number>().Uint32Value();
 
-        sl_status_t status = sl_zigbee_ezsp_permit_joining(duration);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() { return StatusResult(sl_zigbee_ezsp_permit_joining(duration)); });
     }
 
     // Configuration Commands
@@ -1237,14 +5764,22 @@ namespace EzspNapi
 
         sl_zigbee_ezsp_config_id_t configId = info[0].As<Napi::Number>().Uint32Value();
 
-        uint16_t value = 0;
-        sl_status_t status = sl_zigbee_ezsp_get_configuration_value(configId, &value);
+        auto execute = [configId]()
+        {
+            uint16_t value = 0;
+            sl_status_t status = sl_zigbee_ezsp_get_configuration_value(configId, &value);
 
-        Napi::Array result = Napi::Array::New(env, 2);
-        result[0u] = Napi::Number::New(env, status);
-        result[1u] = (status == SL_STATUS_OK) ? Napi::Number::New(env, value) : env.Null();
+            return [status, value](Napi::Env env) -> Napi::Value
+            {
+                Napi::Array result = Napi::Array::New(env, 2);
+                result[0u] = Napi::Number::New(env, status);
+                result[1u] = (status == SL_STATUS_OK) ? Napi::Number::New(env, value) : env.Null();
 
-        return result;
+                return result;
+            };
+        };
+
+        return RunCommand(info, execute);
     }
 
     Napi::Value SetConfigurationValue(const Napi::CallbackInfo &info)
@@ -1260,9 +5795,7 @@ namespace EzspNapi
         sl_zigbee_ezsp_config_id_t configId = info[0].As<Napi::Number>().Uint32Value();
         uint16_t value = info[1].As<Napi::Number>().Uint32Value();
 
-        sl_status_t status = sl_zigbee_ezsp_set_configuration_value(configId, value);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() { return StatusResult(sl_zigbee_ezsp_set_configuration_value(configId, value)); });
     }
 
     Napi::Value GetValue(const Napi::CallbackInfo &info)
@@ -1277,20 +5810,16 @@ namespace EzspNapi
 
         sl_zigbee_ezsp_value_id_t valueId = info[0].As<Napi::Number>().Uint32Value();
 
-        uint8_t valueLength = 0;
-        uint8_t value[255] = {0};
-        sl_status_t status = sl_zigbee_ezsp_get_value(valueId, &valueLength, value);
-
-        Napi::Array result = Napi::Array::New(env, 3);
-        result[0u] = Napi::Number::New(env, status);
-
-        if (status == SL_STATUS_OK)
+        auto execute = [valueId]()
         {
-            result[1u] = Napi::Number::New(env, valueLength);
-            result[2u] = Napi::Buffer<uint8_t>::Copy(env, value, valueLength);
-        }
+            uint8_t valueLength = 0;
+            uint8_t value[255] = {0};
+            sl_status_t status = sl_zigbee_ezsp_get_value(valueId, &valueLength, value);
 
-        return result;
+            return ValueResult(status, valueLength, value);
+        };
+
+        return RunCommand(info, execute);
     }
 
     Napi::Value SetValue(const Napi::CallbackInfo &info)
@@ -1313,9 +5842,7 @@ namespace EzspNapi
             return env.Undefined();
         }
 
-        sl_status_t status = sl_zigbee_ezsp_set_value(valueId, valueLength, value);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() mutable { return StatusResult(sl_zigbee_ezsp_set_value(valueId, valueLength, value)); });
     }
 
     Napi::Value GetExtendedValue(const Napi::CallbackInfo &info)
@@ -1331,20 +5858,16 @@ namespace EzspNapi
         sl_zigbee_ezsp_extended_value_id_t extendedValueId = info[0].As<Napi::Number>().Uint32Value();
         uint32_t characteristics = info[1].As<Napi::Number>().Uint32Value();
 
-        uint8_t valueLength = 0;
-        uint8_t value[255] = {0};
-        sl_status_t status = sl_zigbee_ezsp_get_extended_value(extendedValueId, characteristics, &valueLength, value);
-
-        Napi::Array result = Napi::Array::New(env, 3);
-        result[0u] = Napi::Number::New(env, status);
-
-        if (status == SL_STATUS_OK)
+        auto execute = [extendedValueId, characteristics]()
         {
-            result[1u] = Napi::Number::New(env, valueLength);
-            result[2u] = Napi::Buffer<uint8_t>::Copy(env, value, valueLength);
-        }
+            uint8_t valueLength = 0;
+            uint8_t value[255] = {0};
+            sl_status_t status = sl_zigbee_ezsp_get_extended_value(extendedValueId, characteristics, &valueLength, value);
 
-        return result;
+            return ValueResult(status, valueLength, value);
+        };
+
+        return RunCommand(info, execute);
     }
 
     Napi::Value SetPolicy(const Napi::CallbackInfo &info)
@@ -1360,9 +5883,7 @@ namespace EzspNapi
         sl_zigbee_ezsp_policy_id_t policyId = info[0].As<Napi::Number>().Uint32Value();
         sl_zigbee_ezsp_decision_id_t decisionId = info[1].As<Napi::Number>().Uint32Value();
 
-        sl_status_t status = sl_zigbee_ezsp_set_policy(policyId, decisionId);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() { return StatusResult(sl_zigbee_ezsp_set_policy(policyId, decisionId)); });
     }
 
     Napi::Value TokenFactoryReset(const Napi::CallbackInfo &info)
@@ -1378,9 +5899,14 @@ namespace EzspNapi
         bool excludeOutgoingFC = info[0].As<Napi::Boolean>().Value();
         bool excludeBootCounter = info[1].As<Napi::Boolean>().Value();
 
-        sl_zigbee_ezsp_token_factory_reset(excludeOutgoingFC, excludeBootCounter);
+        auto execute = [excludeOutgoingFC, excludeBootCounter]()
+        {
+            sl_zigbee_ezsp_token_factory_reset(excludeOutgoingFC, excludeBootCounter);
+
+            return UndefinedResult();
+        };
 
-        return env.Undefined();
+        return RunCommand(info, execute);
     }
 
     // Security Commands
@@ -1434,34 +5960,38 @@ namespace EzspNapi
             return env.Undefined();
         }
 
-        sl_status_t status = sl_zigbee_ezsp_set_initial_security_state(&securityState);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() mutable { return StatusResult(sl_zigbee_ezsp_set_initial_security_state(&securityState)); });
     }
 
     Napi::Value GetNetworkKeyInfo(const Napi::CallbackInfo &info)
     {
-        Napi::Env env = info.Env();
-
-        sl_zigbee_sec_man_network_key_info_t networkKeyInfo = {0};
-        sl_status_t status = sl_zigbee_ezsp_sec_man_get_network_key_info(&networkKeyInfo);
+        auto execute = []()
+        {
+            sl_zigbee_sec_man_network_key_info_t networkKeyInfo = {0};
+            sl_status_t status = sl_zigbee_ezsp_sec_man_get_network_key_info(&networkKeyInfo);
 
-        Napi::Array result = Napi::Array::New(env, 2);
-        result[0u] = Napi::Number::New(env, status);
+            return [status, networkKeyInfo](Napi::Env env) -> Napi::Value
+            {
+                Napi::Array result = Napi::Array::New(env, 2);
+                result[0u] = Napi::Number::New(env, status);
 
-        if (status == SL_STATUS_OK)
-        {
-            Napi::Object response = Napi::Object::New(env);
-            response.Set("networkKeySet", Napi::Boolean::New(env, networkKeyInfo.network_key_set));
-            response.Set("alternateNetworkKeySet", Napi::Boolean::New(env, networkKeyInfo.alternate_network_key_set));
-            response.Set("networkKeySequenceNumber", Napi::Number::New(env, networkKeyInfo.network_key_sequence_number));
-            response.Set("altNetworkKeySequenceNumber", Napi::Number::New(env, networkKeyInfo.alt_network_key_sequence_number));
-            response.Set("networkKeyFrameCounter", Napi::Number::New(env, networkKeyInfo.network_key_frame_counter));
+                if (status == SL_STATUS_OK)
+                {
+                    Napi::Object response = Napi::Object::New(env);
+                    response.Set("networkKeySet", Napi::Boolean::New(env, networkKeyInfo.network_key_set));
+                    response.Set("alternateNetworkKeySet", Napi::Boolean::New(env, networkKeyInfo.alternate_network_key_set));
+                    response.Set("networkKeySequenceNumber", Napi::Number::New(env, networkKeyInfo.network_key_sequence_number));
+                    response.Set("altNetworkKeySequenceNumber", Napi::Number::New(env, networkKeyInfo.alt_network_key_sequence_number));
+                    response.Set("networkKeyFrameCounter", Napi::Number::New(env, networkKeyInfo.network_key_frame_counter));
+
+                    result[1u] = response;
+                }
 
-            result[1u] = response;
-        }
+                return result;
+            };
+        };
 
-        return result;
+        return RunCommand(info, execute);
     }
 
     Napi::Value GetApsKeyInfo(const Napi::CallbackInfo &info)
@@ -1498,24 +6028,26 @@ namespace EzspNapi
         context.flags = contextObj.Get("flags").As<Napi::Number>().Uint32Value();
         context.psa_key_alg_permission = contextObj.Get("psaKeyAlgPermission").As<Napi::Number>().Uint32Value();
 
-        sl_zigbee_sec_man_aps_key_metadata_t key_data = {0};
-        sl_status_t status = sl_zigbee_ezsp_sec_man_get_aps_key_info(&context, &key_data);
+        auto execute = [context]() mutable
+        {
+            sl_zigbee_sec_man_aps_key_metadata_t key_data = {0};
+            sl_status_t status = sl_zigbee_ezsp_sec_man_get_aps_key_info(&context, &key_data);
 
-        Napi::Array result = Napi::Array::New(env, 2);
-        result[0u] = Napi::Number::New(env, status);
+            return [status, key_data](Napi::Env env) -> Napi::Value
+            {
+                Napi::Array result = Napi::Array::New(env, 2);
+                result[0u] = Napi::Number::New(env, status);
 
-        if (status == SL_STATUS_OK)
-        {
-            Napi::Object response = Napi::Object::New(env);
-            response.Set("bitmask", Napi::Number::New(env, key_data.bitmask));
-            response.Set("outgoingFrameCounter", Napi::Number::New(env, key_data.outgoing_frame_counter));
-            response.Set("incomingFrameCounter", Napi::Number::New(env, key_data.incoming_frame_counter));
-            response.Set("ttlInSeconds", Napi::Number::New(env, key_data.ttl_in_seconds));
+                if (status == SL_STATUS_OK)
+                {
+                    result[1u] = ApsKeyMetadataToObject(env, &key_data);
+                }
 
-            result[1u] = response;
-        }
+                return result;
+            };
+        };
 
-        return result;
+        return RunCommand(info, execute);
     }
 
     Napi::Value ExportKey(const Napi::CallbackInfo &info)
@@ -1537,18 +6069,26 @@ namespace EzspNapi
             return env.Undefined();
         }
 
-        sl_zigbee_sec_man_key_t plaintext_key = {0};
-        sl_status_t status = sl_zigbee_ezsp_sec_man_export_key(&context, &plaintext_key);
+        auto execute = [context]() mutable
+        {
+            sl_zigbee_sec_man_key_t plaintext_key = {0};
+            sl_status_t status = sl_zigbee_ezsp_sec_man_export_key(&context, &plaintext_key);
 
-        Napi::Array result = Napi::Array::New(env, 2);
-        result[0u] = Napi::Number::New(env, status);
+            return [status, plaintext_key](Napi::Env env) -> Napi::Value
+            {
+                Napi::Array result = Napi::Array::New(env, 2);
+                result[0u] = Napi::Number::New(env, status);
 
-        if (status == SL_STATUS_OK)
-        {
-            result[1u] = SecManKeyToObject(env, &plaintext_key);
-        }
+                if (status == SL_STATUS_OK)
+                {
+                    result[1u] = SecManKeyToObject(env, &plaintext_key);
+                }
 
-        return result;
+                return result;
+            };
+        };
+
+        return RunCommand(info, execute);
     }
 
     Napi::Value ExportLinkKeyByIndex(const Napi::CallbackInfo &info)
@@ -1562,30 +6102,32 @@ namespace EzspNapi
         }
 
         uint8_t index = info[0].As<Napi::Number>().Uint32Value();
-        sl_zigbee_sec_man_context_t context = {0};
-        sl_zigbee_sec_man_key_t plaintext_key = {0};
-        sl_zigbee_sec_man_aps_key_metadata_t key_data = {0};
 
-        sl_status_t status = sl_zigbee_ezsp_sec_man_export_link_key_by_index(index, &context, &plaintext_key, &key_data);
+        auto execute = [index]()
+        {
+            sl_zigbee_sec_man_context_t context = {0};
+            sl_zigbee_sec_man_key_t plaintext_key = {0};
+            sl_zigbee_sec_man_aps_key_metadata_t key_data = {0};
 
-        Napi::Array result = Napi::Array::New(env, 4);
-        result[0u] = Napi::Number::New(env, status);
+            sl_status_t status = sl_zigbee_ezsp_sec_man_export_link_key_by_index(index, &context, &plaintext_key, &key_data);
 
-        if (status == SL_STATUS_OK)
-        {
-            result[1u] = SecManContextToObject(env, &context);
-            result[2u] = SecManKeyToObject(env, &plaintext_key);
+            return [status, context, plaintext_key, key_data](Napi::Env env) -> Napi::Value
+            {
+                Napi::Array result = Napi::Array::New(env, 4);
+                result[0u] = Napi::Number::New(env, status);
 
-            Napi::Object keyDataResponse = Napi::Object::New(env);
-            keyDataResponse.Set("bitmask", Napi::Number::New(env, key_data.bitmask));
-            keyDataResponse.Set("outgoingFrameCounter", Napi::Number::New(env, key_data.outgoing_frame_counter));
-            keyDataResponse.Set("incomingFrameCounter", Napi::Number::New(env, key_data.incoming_frame_counter));
-            keyDataResponse.Set("ttlInSeconds", Napi::Number::New(env, key_data.ttl_in_seconds));
+                if (status == SL_STATUS_OK)
+                {
+                    result[1u] = SecManContextToObject(env, &context);
+                    result[2u] = SecManKeyToObject(env, &plaintext_key);
+                    result[3u] = ApsKeyMetadataToObject(env, &key_data);
+                }
 
-            result[3u] = keyDataResponse;
-        }
+                return result;
+            };
+        };
 
-        return result;
+        return RunCommand(info, execute);
     }
 
     Napi::Value ImportLinkKey(const Napi::CallbackInfo &info)
@@ -1616,9 +6158,7 @@ namespace EzspNapi
             return env.Undefined();
         }
 
-        sl_status_t status = sl_zigbee_ezsp_sec_man_import_link_key(index, address, &plaintext_key);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() mutable { return StatusResult(sl_zigbee_ezsp_sec_man_import_link_key(index, address, &plaintext_key)); });
     }
 
     Napi::Value ImportTransientKey(const Napi::CallbackInfo &info)
@@ -1648,9 +6188,7 @@ namespace EzspNapi
             return env.Undefined();
         }
 
-        sl_status_t status = sl_zigbee_ezsp_sec_man_import_transient_key(eui64, &plaintext_key);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() mutable { return StatusResult(sl_zigbee_ezsp_sec_man_import_transient_key(eui64, &plaintext_key)); });
     }
 
     Napi::Value EraseKeyTableEntry(const Napi::CallbackInfo &info)
@@ -1665,27 +6203,24 @@ namespace EzspNapi
 
         uint8_t index = info[0].As<Napi::Number>().Uint32Value();
 
-        sl_status_t status = sl_zigbee_ezsp_erase_key_table_entry(index);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() { return StatusResult(sl_zigbee_ezsp_erase_key_table_entry(index)); });
     }
 
     Napi::Value ClearKeyTable(const Napi::CallbackInfo &info)
     {
-        Napi::Env env = info.Env();
-
-        sl_status_t status = sl_zigbee_ezsp_clear_key_table();
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, []() { return StatusResult(sl_zigbee_ezsp_clear_key_table()); });
     }
 
     Napi::Value ClearTransientLinkKeys(const Napi::CallbackInfo &info)
     {
-        Napi::Env env = info.Env();
+        auto execute = []()
+        {
+            sl_zigbee_ezsp_clear_transient_link_keys();
 
-        sl_zigbee_ezsp_clear_transient_link_keys();
+            return UndefinedResult();
+        };
 
-        return env.Undefined();
+        return RunCommand(info, execute);
     }
 
     Napi::Value BroadcastNextNetworkKey(const Napi::CallbackInfo &info)
@@ -1707,18 +6242,12 @@ namespace EzspNapi
             return env.Undefined();
         }
 
-        sl_status_t status = sl_zigbee_ezsp_broadcast_next_network_key(&key);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() mutable { return StatusResult(sl_zigbee_ezsp_broadcast_next_network_key(&key)); });
     }
 
     Napi::Value BroadcastNetworkKeySwitch(const Napi::CallbackInfo &info)
     {
-        Napi::Env env = info.Env();
-
-        sl_status_t status = sl_zigbee_ezsp_broadcast_network_key_switch();
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, []() { return StatusResult(sl_zigbee_ezsp_broadcast_network_key_switch()); });
     }
 
     // Messaging Commands
@@ -1735,27 +6264,34 @@ namespace EzspNapi
 
         sl_zigbee_outgoing_message_type_t type = info[0].As<Napi::Number>().Uint32Value();
         uint16_t indexOrDestination = info[1].As<Napi::Number>().Uint32Value();
-        Napi::Object apsFrameObj = info[2].As<Napi::Object>();
-
         sl_zigbee_aps_frame_t apsFrame = {0};
-        if (!ApsFrameFromObject(env, apsFrameObj, &apsFrame))
+        if (!ApsFrameFromValue(env, info[2], &apsFrame))
         {
             Napi::TypeError::New(env, "Invalid aps frame object").ThrowAsJavaScriptException();
             return env.Undefined();
         }
 
-        uint16_t messageTag = info[3].As<Napi::Number>().Uint32Value();
+        uint16_t messageTag = 0;
+        if (!CheckUntrackedTag(env, info[3], &messageTag))
+        {
+            return env.Undefined();
+        }
+
         Napi::Buffer<uint8_t> messageBuffer = info[4].As<Napi::Buffer<uint8_t>>();
+        std::vector<uint8_t> message(messageBuffer.Data(), messageBuffer.Data() + messageBuffer.Length());
 
-        uint8_t sequence = 0;
-        sl_status_t status =
-            sl_zigbee_ezsp_send_unicast(type, indexOrDestination, &apsFrame, messageTag, messageBuffer.Length(), messageBuffer.Data(), &sequence);
+        auto packedApsFrameRef = PackedApsFrameRef(info[2]);
 
-        Napi::Array result = Napi::Array::New(env, 2);
-        result[0u] = Napi::Number::New(env, status);
-        result[1u] = Napi::Number::New(env, sequence);
+        auto execute = [type, indexOrDestination, apsFrame, messageTag, message, packedApsFrameRef]() mutable
+        {
+            uint8_t sequence = 0;
+            sl_status_t status =
+                sl_zigbee_ezsp_send_unicast(type, indexOrDestination, &apsFrame, messageTag, message.size(), message.data(), &sequence);
 
-        return result;
+            return SequenceResult(status, sequence, packedApsFrameRef);
+        };
+
+        return RunCommand(info, execute);
     }
 
     Napi::Value SendMulticast(const Napi::CallbackInfo &info)
@@ -1769,10 +6305,8 @@ namespace EzspNapi
             return env.Undefined();
         }
 
-        Napi::Object apsFrameObj = info[0].As<Napi::Object>();
-
         sl_zigbee_aps_frame_t apsFrame = {0};
-        if (!ApsFrameFromObject(env, apsFrameObj, &apsFrame))
+        if (!ApsFrameFromValue(env, info[0], &apsFrame))
         {
             Napi::TypeError::New(env, "Invalid aps frame object").ThrowAsJavaScriptException();
             return env.Undefined();
@@ -1782,18 +6316,27 @@ namespace EzspNapi
         uint16_t broadcastAddr = info[2].As<Napi::Number>().Uint32Value();
         uint16_t alias = info[3].As<Napi::Number>().Uint32Value();
         uint8_t nwkSequence = info[4].As<Napi::Number>().Uint32Value();
-        uint16_t messageTag = info[5].As<Napi::Number>().Uint32Value();
+        uint16_t messageTag = 0;
+        if (!CheckUntrackedTag(env, info[5], &messageTag))
+        {
+            return env.Undefined();
+        }
+
         Napi::Buffer<uint8_t> messageBuffer = info[6].As<Napi::Buffer<uint8_t>>();
+        std::vector<uint8_t> message(messageBuffer.Data(), messageBuffer.Data() + messageBuffer.Length());
 
-        uint8_t sequence = 0;
-        sl_status_t status = sl_zigbee_ezsp_send_multicast(&apsFrame, hops, broadcastAddr, alias, nwkSequence, messageTag, messageBuffer.Length(),
-                                                           messageBuffer.Data(), &sequence);
+        auto packedApsFrameRef = PackedApsFrameRef(info[0]);
 
-        Napi::Array result = Napi::Array::New(env, 2);
-        result[0u] = Napi::Number::New(env, status);
-        result[1u] = Napi::Number::New(env, sequence);
+        auto execute = [apsFrame, hops, broadcastAddr, alias, nwkSequence, messageTag, message, packedApsFrameRef]() mutable
+        {
+            uint8_t sequence = 0;
+            sl_status_t status = sl_zigbee_ezsp_send_multicast(&apsFrame, hops, broadcastAddr, alias, nwkSequence, messageTag, message.size(),
+                                                               message.data(), &sequence);
 
-        return result;
+            return SequenceResult(status, sequence, packedApsFrameRef);
+        };
+
+        return RunCommand(info, execute);
     }
 
     Napi::Value SendBroadcast(const Napi::CallbackInfo &info)
@@ -1811,28 +6354,35 @@ namespace EzspNapi
         sl_802154_short_addr_t destination = info[1].As<Napi::Number>().Uint32Value();
         uint8_t nwkSequence = info[2].As<Napi::Number>().Uint32Value();
 
-        Napi::Object apsFrameObj = info[3].As<Napi::Object>();
-
         sl_zigbee_aps_frame_t apsFrame = {0};
-        if (!ApsFrameFromObject(env, apsFrameObj, &apsFrame))
+        if (!ApsFrameFromValue(env, info[3], &apsFrame))
         {
             Napi::TypeError::New(env, "Invalid aps frame object").ThrowAsJavaScriptException();
             return env.Undefined();
         }
 
         uint8_t radius = info[4].As<Napi::Number>().Uint32Value();
-        uint16_t messageTag = info[5].As<Napi::Number>().Uint32Value();
+        uint16_t messageTag = 0;
+        if (!CheckUntrackedTag(env, info[5], &messageTag))
+        {
+            return env.Undefined();
+        }
+
         Napi::Buffer<uint8_t> messageBuffer = info[6].As<Napi::Buffer<uint8_t>>();
+        std::vector<uint8_t> message(messageBuffer.Data(), messageBuffer.Data() + messageBuffer.Length());
 
-        uint8_t sequence = 0;
-        sl_status_t status = sl_zigbee_ezsp_send_broadcast(alias, destination, nwkSequence, &apsFrame, radius, messageTag, messageBuffer.Length(),
-                                                           messageBuffer.Data(), &sequence);
+        auto packedApsFrameRef = PackedApsFrameRef(info[3]);
 
-        Napi::Array result = Napi::Array::New(env, 2);
-        result[0u] = Napi::Number::New(env, status);
-        result[1u] = Napi::Number::New(env, sequence);
+        auto execute = [alias, destination, nwkSequence, apsFrame, radius, messageTag, message, packedApsFrameRef]() mutable
+        {
+            uint8_t sequence = 0;
+            sl_status_t status = sl_zigbee_ezsp_send_broadcast(alias, destination, nwkSequence, &apsFrame, radius, messageTag, message.size(),
+                                                               message.data(), &sequence);
 
-        return result;
+            return SequenceResult(status, sequence, packedApsFrameRef);
+        };
+
+        return RunCommand(info, execute);
     }
 
     Napi::Value SendRawMessage(const Napi::CallbackInfo &info)
@@ -1848,10 +6398,12 @@ namespace EzspNapi
         Napi::Buffer<uint8_t> messageBuffer = info[0].As<Napi::Buffer<uint8_t>>();
         uint8_t priority = info[1].As<Napi::Number>().Uint32Value();
         bool useCca = info[2].As<Napi::Boolean>().Value();
+        std::vector<uint8_t> message(messageBuffer.Data(), messageBuffer.Data() + messageBuffer.Length());
 
-        sl_status_t status = sl_zigbee_ezsp_send_raw_message(messageBuffer.Length(), messageBuffer.Data(), priority, useCca);
+        auto execute = [message, priority, useCca]() mutable
+        { return StatusResult(sl_zigbee_ezsp_send_raw_message(message.size(), message.data(), priority, useCca)); };
 
-        return Napi::Number::New(env, status);
+        return RunCommand(info, execute);
     }
 
     // Radio/Hardware Commands
@@ -1868,9 +6420,7 @@ namespace EzspNapi
 
         int8_t power = info[0].As<Napi::Number>().Int32Value(); // actually int8 (-128..127)
 
-        sl_status_t status = sl_zigbee_ezsp_set_radio_power(power);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() { return StatusResult(sl_zigbee_ezsp_set_radio_power(power)); });
     }
 
     Napi::Value SetRadioIeee802154CcaMode(const Napi::CallbackInfo &info)
@@ -1885,9 +6435,7 @@ namespace EzspNapi
 
         uint8_t ccaMode = info[0].As<Napi::Number>().Uint32Value();
 
-        sl_status_t status = sl_zigbee_ezsp_set_radio_ieee802154_cca_mode(ccaMode);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() { return StatusResult(sl_zigbee_ezsp_set_radio_ieee802154_cca_mode(ccaMode)); });
     }
 
     Napi::Value SetLogicalAndRadioChannel(const Napi::CallbackInfo &info)
@@ -1902,9 +6450,7 @@ namespace EzspNapi
 
         uint8_t channel = info[0].As<Napi::Number>().Uint32Value();
 
-        sl_status_t status = sl_zigbee_ezsp_set_logical_and_radio_channel(channel);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() { return StatusResult(sl_zigbee_ezsp_set_logical_and_radio_channel(channel)); });
     }
 
     Napi::Value SetManufacturerCode(const Napi::CallbackInfo &info)
@@ -1919,9 +6465,7 @@ namespace EzspNapi
 
         uint16_t code = info[0].As<Napi::Number>().Uint32Value();
 
-        sl_status_t status = sl_zigbee_ezsp_set_manufacturer_code(code);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() { return StatusResult(sl_zigbee_ezsp_set_manufacturer_code(code)); });
     }
 
     // Routing/Table Commands
@@ -1945,10 +6489,15 @@ namespace EzspNapi
         uint8_t deliveryFailureThreshold = info[5].As<Napi::Number>().Uint32Value();
         uint8_t maxHops = info[6].As<Napi::Number>().Uint32Value();
 
-        sl_status_t status =
-            sl_zigbee_ezsp_set_concentrator(on, concentratorType, minTime, maxTime, routeErrorThreshold, deliveryFailureThreshold, maxHops);
+        auto execute = [=]() mutable
+        {
+            sl_status_t status =
+                sl_zigbee_ezsp_set_concentrator(on, concentratorType, minTime, maxTime, routeErrorThreshold, deliveryFailureThreshold, maxHops);
+
+            return StatusResult(status);
+        };
 
-        return Napi::Number::New(env, status);
+        return RunCommand(info, execute);
     }
 
     Napi::Value SetSourceRouteDiscoveryMode(const Napi::CallbackInfo &info)
@@ -1963,9 +6512,7 @@ namespace EzspNapi
 
         uint8_t mode = info[0].As<Napi::Number>().Uint32Value();
 
-        uint32_t remainingTime = sl_zigbee_ezsp_set_source_route_discovery_mode(mode);
-
-        return Napi::Number::New(env, remainingTime);
+        return RunCommand(info, [=]() { return StatusResult(sl_zigbee_ezsp_set_source_route_discovery_mode(mode)); });
     }
 
     Napi::Value SetMulticastTableEntry(const Napi::CallbackInfo &info)
@@ -1992,9 +6539,7 @@ namespace EzspNapi
         entry.endpoint = entryObj.Get("endpoint").As<Napi::Number>().Uint32Value();
         entry.networkIndex = entryObj.Get("networkIndex").As<Napi::Number>().Uint32Value();
 
-        sl_status_t status = sl_zigbee_ezsp_set_multicast_table_entry(index, &entry);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() mutable { return StatusResult(sl_zigbee_ezsp_set_multicast_table_entry(index, &entry)); });
     }
 
     Napi::Value AddEndpoint(const Napi::CallbackInfo &info)
@@ -2051,30 +6596,41 @@ namespace EzspNapi
             }
         }
 
-        sl_status_t status = sl_zigbee_ezsp_add_endpoint(endpoint, profileId, deviceId, appFlags, inputClusterCount, outputClusterCount,
-                                                         inputClusters, outputClusters);
+        auto execute = [=]() mutable
+        {
+            sl_status_t status = sl_zigbee_ezsp_add_endpoint(endpoint, profileId, deviceId, appFlags, inputClusterCount, outputClusterCount,
+                                                             inputClusters, outputClusters);
+
+            return StatusResult(status);
+        };
 
-        return Napi::Number::New(env, status);
+        return RunCommand(info, execute);
     }
 
     // Monitoring
 
     Napi::Value ReadAndClearCounters(const Napi::CallbackInfo &info)
     {
-        Napi::Env env = info.Env();
+        auto execute = []()
+        {
+            uint16_t values[SL_ZIGBEE_COUNTER_TYPE_COUNT] = {0};
 
-        uint16_t values[SL_ZIGBEE_COUNTER_TYPE_COUNT] = {0};
+            sl_zigbee_ezsp_read_and_clear_counters(values);
 
-        sl_zigbee_ezsp_read_and_clear_counters(values);
+            return [values](Napi::Env env) -> Napi::Value
+            {
+                Napi::Array result = Napi::Array::New(env, SL_ZIGBEE_COUNTER_TYPE_COUNT);
 
-        Napi::Array result = Napi::Array::New(env, SL_ZIGBEE_COUNTER_TYPE_COUNT);
+                for (int i = 0; i < SL_ZIGBEE_COUNTER_TYPE_COUNT; i++)
+                {
+                    result[i] = Napi::Number::New(env, values[i]);
+                }
 
-        for (int i = 0; i < SL_ZIGBEE_COUNTER_TYPE_COUNT; i++)
-        {
-            result[i] = Napi::Number::New(env, values[i]);
-        }
+                return result;
+            };
+        };
 
-        return result;
+        return RunCommand(info, execute);
     }
 
     // Convenience Wrappers
@@ -2096,9 +6652,7 @@ namespace EzspNapi
         value[2] = (frameCounter >> 16) & 0xFF;
         value[3] = (frameCounter >> 24) & 0xFF;
 
-        sl_status_t status = sl_zigbee_ezsp_set_value(SL_ZIGBEE_EZSP_VALUE_NWK_FRAME_COUNTER, 4, value);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() mutable { return StatusResult(sl_zigbee_ezsp_set_value(SL_ZIGBEE_EZSP_VALUE_NWK_FRAME_COUNTER, 4, value)); });
     }
 
     Napi::Value SetAPSFrameCounter(const Napi::CallbackInfo &info)
@@ -2118,18 +6672,12 @@ namespace EzspNapi
         value[2] = (frameCounter >> 16) & 0xFF;
         value[3] = (frameCounter >> 24) & 0xFF;
 
-        sl_status_t status = sl_zigbee_ezsp_set_value(SL_ZIGBEE_EZSP_VALUE_APS_FRAME_COUNTER, 4, value);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() mutable { return StatusResult(sl_zigbee_ezsp_set_value(SL_ZIGBEE_EZSP_VALUE_APS_FRAME_COUNTER, 4, value)); });
     }
 
     Napi::Value StartWritingStackTokens(const Napi::CallbackInfo &info)
     {
-        Napi::Env env = info.Env();
-
-        sl_status_t status = sl_zigbee_start_writing_stack_tokens();
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, []() { return StatusResult(sl_zigbee_start_writing_stack_tokens()); });
     }
 
     Napi::Value SetExtendedSecurityBitmask(const Napi::CallbackInfo &info)
@@ -2144,9 +6692,7 @@ namespace EzspNapi
 
         uint16_t bitmask = info[0].As<Napi::Number>().Uint32Value();
 
-        sl_status_t status = sl_zigbee_set_extended_security_bitmask(bitmask);
-
-        return Napi::Number::New(env, status);
+        return RunCommand(info, [=]() { return StatusResult(sl_zigbee_set_extended_security_bitmask(bitmask)); });
     }
 
     Napi::Value GetEndpointFlags(const Napi::CallbackInfo &info)
@@ -2161,45 +6707,59 @@ namespace EzspNapi
 
         uint8_t endpoint = info[0].As<Napi::Number>().Uint32Value();
 
-        sl_zigbee_ezsp_endpoint_flags_t returnFlags;
-        sl_status_t status = sl_zigbee_ezsp_get_endpoint_flags(endpoint, &returnFlags);
+        auto execute = [endpoint]()
+        {
+            sl_zigbee_ezsp_endpoint_flags_t returnFlags;
+            sl_status_t status = sl_zigbee_ezsp_get_endpoint_flags(endpoint, &returnFlags);
 
-        Napi::Array result = Napi::Array::New(env, 2);
-        result[0u] = Napi::Number::New(env, status);
+            return [status, returnFlags](Napi::Env env) -> Napi::Value
+            {
+                Napi::Array result = Napi::Array::New(env, 2);
+                result[0u] = Napi::Number::New(env, status);
 
-        if (status == SL_STATUS_OK)
-        {
-            result[1u] = returnFlags;
-        }
+                if (status == SL_STATUS_OK)
+                {
+                    result[1u] = returnFlags;
+                }
 
-        return result;
+                return result;
+            };
+        };
+
+        return RunCommand(info, execute);
     }
 
     Napi::Value GetVersionStruct(const Napi::CallbackInfo &info)
     {
-        Napi::Env env = info.Env();
-
-        sl_zigbee_version_t version;
+        auto execute = []()
+        {
+            sl_zigbee_version_t version;
 
-        sl_status_t status = sl_zigbee_ezsp_get_version_struct(&version);
+            sl_status_t status = sl_zigbee_ezsp_get_version_struct(&version);
 
-        Napi::Array result = Napi::Array::New(env, 2);
-        result[0u] = Napi::Number::New(env, status);
+            return [status, version](Napi::Env env) -> Napi::Value
+            {
+                Napi::Array result = Napi::Array::New(env, 2);
+                result[0u] = Napi::Number::New(env, status);
 
-        if (status == SL_STATUS_OK)
-        {
-            Napi::Object response = Napi::Object::New(env);
-            response.Set("build", Napi::Number::New(env, version.build));
-            response.Set("major", Napi::Number::New(env, version.major));
-            response.Set("minor", Napi::Number::New(env, version.minor));
-            response.Set("patch", Napi::Number::New(env, version.patch));
-            response.Set("special", Napi::Number::New(env, version.special));
-            response.Set("type", Napi::Number::New(env, version.type));
+                if (status == SL_STATUS_OK)
+                {
+                    Napi::Object response = Napi::Object::New(env);
+                    response.Set("build", Napi::Number::New(env, version.build));
+                    response.Set("major", Napi::Number::New(env, version.major));
+                    response.Set("minor", Napi::Number::New(env, version.minor));
+                    response.Set("patch", Napi::Number::New(env, version.patch));
+                    response.Set("special", Napi::Number::New(env, version.special));
+                    response.Set("type", Napi::Number::New(env, version.type));
+
+                    result[1u] = response;
+                }
 
-            result[1u] = response;
-        }
+                return result;
+            };
+        };
 
-        return result;
+        return RunCommand(info, execute);
     }
 
     // sli_zigbee_af_send
@@ -2216,91 +6776,351 @@ namespace EzspNapi
 
         sl_zigbee_outgoing_message_type_t type = info[0].As<Napi::Number>().Uint32Value();
         uint16_t indexOrDestination = info[1].As<Napi::Number>().Uint32Value();
-        Napi::Object apsFrameObj = info[2].As<Napi::Object>();
+        sl_zigbee_aps_frame_t apsFrame = {0};
+        if (!ApsFrameFromValue(env, info[2], &apsFrame))
+        {
+            Napi::TypeError::New(env, "Invalid aps frame object").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Buffer<uint8_t> messageBuffer = info[3].As<Napi::Buffer<uint8_t>>();
+        std::vector<uint8_t> message(messageBuffer.Data(), messageBuffer.Data() + messageBuffer.Length());
+        uint16_t alias = info[4].As<Napi::Number>().Uint32Value();
+        uint8_t sequence = info[5].As<Napi::Number>().Uint32Value();
+        uint16_t messageTag = ezspNextSequence();
+        // kept alive until result is marshalled (async)
+        auto apsFrameRef = std::make_shared<Napi::ObjectReference>(Napi::Persistent(info[2].As<Napi::Object>()));
+
+        auto execute = [type, indexOrDestination, apsFrame, message, alias, sequence, messageTag, apsFrameRef]() mutable
+        {
+            bool sent = false;
+            sl_status_t status =
+                AdmitMessage(type, indexOrDestination, &apsFrame, messageTag, alias, sequence, message.size(), message.data(), &sent);
+            uint8_t apsSequence = apsFrame.sequence;
+
+            return [status, sent, messageTag, apsSequence, apsFrameRef](Napi::Env env) -> Napi::Value
+            {
+                if (sent)
+                {
+                    // mutate Node.js object (or packed buffer)
+                    WriteBackApsSequence(apsFrameRef->Value(), apsSequence);
+                }
+
+                Napi::Array result = Napi::Array::New(env, 3);
+                result[0u] = Napi::Number::New(env, status);
+                result[1u] = Napi::Number::New(env, messageTag);
+
+                return result;
+            };
+        };
+
+        return RunCommand(info, execute);
+    }
+
+    /**
+     * Same as `send`, with delivery tracked natively: the returned Promise settles on the matching `messageSent`,
+     * or rejects on send failure or timeout. `messageTag` is drawn from the tracked range (`TRACKED_TAG_FIRST` and up).
+     */
+    Napi::Value SendTracked(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 6 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsObject() || !info[3].IsBuffer() || !info[4].IsNumber() ||
+            !info[5].IsNumber() ||
+            (info.Length() > 6 && !info[6].IsUndefined() && (!info[6].IsNumber() || info[6].As<Napi::Number>().Int64Value() < 1)))
+        {
+            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
 
         sl_zigbee_aps_frame_t apsFrame = {0};
-        if (!ApsFrameFromObject(env, apsFrameObj, &apsFrame))
+        if (!ApsFrameFromValue(env, info[2], &apsFrame))
         {
             Napi::TypeError::New(env, "Invalid aps frame object").ThrowAsJavaScriptException();
             return env.Undefined();
         }
 
+        if (!tsfn)
+        {
+            Napi::Error::New(env, "No callback - call init() with a callback first").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        sl_zigbee_outgoing_message_type_t type = info[0].As<Napi::Number>().Uint32Value();
+        uint16_t indexOrDestination = info[1].As<Napi::Number>().Uint32Value();
         Napi::Buffer<uint8_t> messageBuffer = info[3].As<Napi::Buffer<uint8_t>>();
+        uint16_t alias = info[4].As<Napi::Number>().Uint32Value();
+        uint8_t sequence = info[5].As<Napi::Number>().Uint32Value();
+        uint32_t timeoutMs = info.Length() > 6 && info[6].IsNumber() ? info[6].As<Napi::Number>().Uint32Value() : deliveryTimeoutMs;
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        uint16_t messageTag = 0;
+
+        // registered first, `messageSent` may fire while sending
+        if (!TrackDelivery(deferred, timeoutMs, &messageTag))
+        {
+            RejectDelivery(deferred, "Too many messages in flight", SL_STATUS_FULL, messageTag);
+            return deferred.Promise();
+        }
 
         sl_status_t status = SL_STATUS_OK;
-        uint16_t messageTag = ezspNextSequence();
-        uint8_t nwkRadius = 12; // ZA_MAX_HOPS
-        sl_802154_short_addr_t nwkAlias = SL_ZIGBEE_NULL_NODE_ID;
+        bool sent = false;
+
+        // the JS thread waits meanwhile, `messageBuffer` stays valid
+        RunOnStack(
+            [&]()
+            {
+                // same order as `send`, after the async commands called before
+                RunQueuedCommands();
+                status = AdmitMessage(type, indexOrDestination, &apsFrame, messageTag, alias, sequence, messageBuffer.Length(),
+                                      messageBuffer.Data(), &sent);
+
+                ezspScheduleNextTick();
+            });
 
-        switch (type)
+        if (sent)
         {
-        case SL_ZIGBEE_OUTGOING_VIA_BINDING:
-        case SL_ZIGBEE_OUTGOING_VIA_ADDRESS_TABLE:
-        case SL_ZIGBEE_OUTGOING_DIRECT:
+            // mutate Node.js object (or packed buffer)
+            WriteBackApsSequence(info[2].As<Napi::Object>(), apsFrame.sequence);
+        }
+
+        // queued (`congestionControl`): settled by its `messageSent` once released
+        if (status != SL_STATUS_OK && status != SL_STATUS_IN_PROGRESS && TakeDelivery(messageTag))
         {
-            status = sl_zigbee_ezsp_send_unicast(type, indexOrDestination, &apsFrame, messageTag, messageBuffer.Length(), messageBuffer.Data(),
-                                                 &apsFrame.sequence);
+            RejectDelivery(deferred, "Send failed", status, messageTag);
+        }
 
-            // mutate Node.js object
-            apsFrameObj.Set("sequence", apsFrame.sequence);
+        ArmDeliveryTimer();
 
-            break;
+        return deferred.Promise();
+    }
+
+    // Packed `sendBatch` entry (little endian), as written by `packSendBatch` in `src/index.ts`:
+    // type, indexOrDestination (2), packed APS frame (12), alias (2), sequence, messageLength, message (messageLength)
+#define SEND_BATCH_ENTRY_HEADER_SIZE 19
+#define SEND_BATCH_ENTRY_APS_FRAME_OFFSET 3
+
+    struct SendBatchEntry
+    {
+        sl_zigbee_outgoing_message_type_t type;
+        uint16_t indexOrDestination;
+        sl_zigbee_aps_frame_t apsFrame;
+        uint16_t alias;
+        uint8_t sequence;
+        uint16_t messageTag;
+        /** Offset of the message in the batch payload */
+        size_t messageOffset;
+        uint8_t messageLength;
+        /** Offset of the packed APS frame in the packed batch, for write back */
+        size_t packedApsFrameOffset;
+    };
+
+    /**
+     * Parse `send` arguments tuple `[type, indexOrDestination, apsFrame, message, alias, sequence]`
+     * @return false on invalid entry
+     */
+    static bool SendBatchEntryFromArray(Napi::Env env, const Napi::Value &value, SendBatchEntry *entry, std::vector<uint8_t> &payload)
+    {
+        if (!value.IsArray())
+        {
+            return false;
+        }
+
+        Napi::Array args = value.As<Napi::Array>();
+
+        if (args.Length() < 6)
+        {
+            return false;
+        }
+
+        Napi::Value type = args[0u];
+        Napi::Value indexOrDestination = args[1u];
+        Napi::Value message = args[3u];
+        Napi::Value alias = args[4u];
+        Napi::Value sequence = args[5u];
+
+        if (!type.IsNumber() || !indexOrDestination.IsNumber() || !message.IsBuffer() || !alias.IsNumber() || !sequence.IsNumber() ||
+            !ApsFrameFromValue(env, args[2u], &entry->apsFrame))
+        {
+            return false;
         }
-        case SL_ZIGBEE_OUTGOING_MULTICAST:
-        case SL_ZIGBEE_OUTGOING_MULTICAST_WITH_ALIAS:
+
+        Napi::Buffer<uint8_t> messageBuffer = message.As<Napi::Buffer<uint8_t>>();
+
+        if (messageBuffer.Length() > UINT8_MAX)
         {
-            uint8_t sequence = info[5].As<Napi::Number>().Uint32Value();
+            return false;
+        }
+
+        entry->type = type.As<Napi::Number>().Uint32Value();
+        entry->indexOrDestination = indexOrDestination.As<Napi::Number>().Uint32Value();
+        entry->alias = alias.As<Napi::Number>().Uint32Value();
+        entry->sequence = sequence.As<Napi::Number>().Uint32Value();
+        entry->messageOffset = payload.size();
+        entry->messageLength = messageBuffer.Length();
+        payload.insert(payload.end(), messageBuffer.Data(), messageBuffer.Data() + messageBuffer.Length());
+
+        return true;
+    }
+
+    /**
+     * Parse packed entries, see `SEND_BATCH_ENTRY_HEADER_SIZE`. Message offsets are relative to `data`, a copy of the packed batch (`SendBatch`).
+     * @return false on truncated batch
+     */
+    static bool SendBatchEntriesFromPacked(const uint8_t *data, size_t length, std::vector<SendBatchEntry> &entries)
+    {
+        size_t offset = 0;
 
-            if (type == SL_ZIGBEE_OUTGOING_MULTICAST_WITH_ALIAS ||
-                (apsFrame.sourceEndpoint == SL_ZIGBEE_GP_ENDPOINT && apsFrame.destinationEndpoint == SL_ZIGBEE_GP_ENDPOINT &&
-                 apsFrame.options & SL_ZIGBEE_APS_OPTION_USE_ALIAS_SEQUENCE_NUMBER))
+        while (offset < length)
+        {
+            if (length - offset < SEND_BATCH_ENTRY_HEADER_SIZE)
             {
-                uint16_t alias = info[4].As<Napi::Number>().Uint32Value();
+                return false;
+            }
 
-                nwkRadius = apsFrame.radius;
-                nwkAlias = alias;
+            const uint8_t *src = data + offset;
+            SendBatchEntry entry;
+            entry.type = src[0];
+            entry.indexOrDestination = HIGH_LOW_TO_INT(src[2], src[1]);
+            entry.packedApsFrameOffset = offset + SEND_BATCH_ENTRY_APS_FRAME_OFFSET;
+            ReadApsFrame(src + SEND_BATCH_ENTRY_APS_FRAME_OFFSET, &entry.apsFrame);
+            entry.alias = HIGH_LOW_TO_INT(src[16], src[15]);
+            entry.sequence = src[17];
+            entry.messageLength = src[18];
+            entry.messageOffset = offset + SEND_BATCH_ENTRY_HEADER_SIZE;
+
+            if (length - entry.messageOffset < entry.messageLength)
+            {
+                return false;
             }
 
-            status = sl_zigbee_ezsp_send_multicast(&apsFrame, nwkRadius, 0, nwkAlias, sequence, messageTag, messageBuffer.Length(),
-                                                   messageBuffer.Data(), &apsFrame.sequence);
+            entries.push_back(entry);
+            offset = entry.messageOffset + entry.messageLength;
+        }
+
+        return true;
+    }
 
-            // mutate Node.js object
-            apsFrameObj.Set("sequence", apsFrame.sequence);
+    /**
+     * Send multiple messages in one call, same as calling `send` for each entry.
+     * Entries are sent in order, a failed entry does not stop the next ones.
+     */
+    Napi::Value SendBatch(const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
 
-            break;
+        if (info.Length() < 1 || !(info[0].IsArray() || info[0].IsBuffer()))
+        {
+            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+            return env.Undefined();
         }
-        case SL_ZIGBEE_OUTGOING_BROADCAST:
-        case SL_ZIGBEE_OUTGOING_BROADCAST_WITH_ALIAS:
+
+        bool packed = info[0].IsBuffer();
+        std::vector<SendBatchEntry> entries;
+        std::vector<uint8_t> payload;
+
+        if (packed)
         {
-            uint8_t sequence = info[5].As<Napi::Number>().Uint32Value();
+            Napi::Buffer<uint8_t> batchBuffer = info[0].As<Napi::Buffer<uint8_t>>();
+            payload.assign(batchBuffer.Data(), batchBuffer.Data() + batchBuffer.Length());
 
-            if (type == SL_ZIGBEE_OUTGOING_BROADCAST_WITH_ALIAS ||
-                (apsFrame.sourceEndpoint == SL_ZIGBEE_GP_ENDPOINT && apsFrame.destinationEndpoint == SL_ZIGBEE_GP_ENDPOINT &&
-                 apsFrame.options & SL_ZIGBEE_APS_OPTION_USE_ALIAS_SEQUENCE_NUMBER))
+            if (!SendBatchEntriesFromPacked(payload.data(), payload.size(), entries))
             {
-                uint16_t alias = info[4].As<Napi::Number>().Uint32Value();
+                Napi::TypeError::New(env, "Invalid batch").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+        }
+        else
+        {
+            Napi::Array batchArray = info[0].As<Napi::Array>();
+            uint32_t count = batchArray.Length();
+            entries.resize(count);
 
-                nwkRadius = apsFrame.radius;
-                nwkAlias = alias;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (!SendBatchEntryFromArray(env, batchArray[i], &entries[i], payload))
+                {
+                    Napi::TypeError::New(env, "Invalid batch entry").ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
             }
+        }
 
-            status = sl_zigbee_ezsp_send_broadcast(nwkAlias, indexOrDestination, sequence, &apsFrame, nwkRadius, messageTag, messageBuffer.Length(),
-                                                   messageBuffer.Data(), &apsFrame.sequence);
+        for (SendBatchEntry &entry : entries)
+        {
+            entry.messageTag = ezspNextSequence();
+        }
 
-            // mutate Node.js object
-            apsFrameObj.Set("sequence", apsFrame.sequence);
+        // kept alive until result is marshalled (async), receives assigned APS sequences
+        auto batchRef = std::make_shared<Napi::ObjectReference>(Napi::Persistent(info[0].As<Napi::Object>()));
 
-            break;
-        }
-        default:
-            status = SL_STATUS_INVALID_PARAMETER;
-        }
+        auto execute = [entries, payload, packed, batchRef]() mutable
+        {
+            std::vector<sl_status_t> statuses(entries.size());
+            std::vector<bool> sent(entries.size());
 
-        Napi::Array result = Napi::Array::New(env, 3);
-        result[0u] = Napi::Number::New(env, status);
-        result[1u] = Napi::Number::New(env, messageTag);
+            for (size_t i = 0; i < entries.size(); i++)
+            {
+                SendBatchEntry &entry = entries[i];
+                bool entrySent = false;
+                statuses[i] = AdmitMessage(entry.type, entry.indexOrDestination, &entry.apsFrame, entry.messageTag, entry.alias, entry.sequence,
+                                           entry.messageLength, payload.data() + entry.messageOffset, &entrySent);
+                sent[i] = entrySent;
+            }
 
-        return result;
+            return [entries, statuses, sent, packed, batchRef](Napi::Env env) -> Napi::Value
+            {
+                Napi::Object batch = batchRef->Value();
+                Napi::Array statusArray = Napi::Array::New(env, entries.size());
+                Napi::Array messageTagArray = Napi::Array::New(env, entries.size());
+
+                for (size_t i = 0; i < entries.size(); i++)
+                {
+                    const SendBatchEntry &entry = entries[i];
+                    uint32_t index = static_cast<uint32_t>(i);
+                    statusArray[index] = Napi::Number::New(env, statuses[i]);
+                    messageTagArray[index] = Napi::Number::New(env, entry.messageTag);
+
+                    if (!sent[i])
+                    {
+                        continue;
+                    }
+
+                    // mutate Node.js objects (or packed buffers), same as `send`
+                    if (packed)
+                    {
+                        Napi::Buffer<uint8_t> batchBuffer = batch.As<Napi::Buffer<uint8_t>>();
+
+                        // could have been detached in the meantime (async)
+                        if (entry.packedApsFrameOffset + PACKED_APS_FRAME_SIZE <= batchBuffer.Length())
+                        {
+                            batchBuffer.Data()[entry.packedApsFrameOffset + PACKED_APS_FRAME_SEQUENCE_OFFSET] = entry.apsFrame.sequence;
+                        }
+                    }
+                    else
+                    {
+                        Napi::Value args = batch.Get(index);
+
+                        if (args.IsArray())
+                        {
+                            Napi::Value apsFrameValue = args.As<Napi::Array>()[2u];
+
+                            if (apsFrameValue.IsObject())
+                            {
+                                WriteBackApsSequence(apsFrameValue.As<Napi::Object>(), entry.apsFrame.sequence);
+                            }
+                        }
+                    }
+                }
+
+                Napi::Array result = Napi::Array::New(env, 2);
+                result[0u] = statusArray;
+                result[1u] = messageTagArray;
+
+                return result;
+            };
+        };
+
+        return RunCommand(info, execute);
     }
 
     // #endregion EZSP Command Bindings
@@ -2308,11 +7128,43 @@ namespace EzspNapi
 } // namespace EzspNapi
 
 // Module initialization
+/**
+ * Register the Promise-returning variant of a command binding.
+ */
+static void SetAsyncCommand(Napi::Env env, Napi::Object target, const char *name, Napi::Value (*command)(const Napi::CallbackInfo &))
+{
+    target.Set(name, Napi::Function::New(env, command, name, &asyncCommandMarker));
+}
+
 Napi::Object InitAll(Napi::Env env, Napi::Object exports)
 {
+    InitPropertyKeys(env);
+
     exports.Set("init", Napi::Function::New(env, EzspNapi::Init)); // ctor equivalent
     exports.Set("start", Napi::Function::New(env, EzspNapi::Start));
     exports.Set("stop", Napi::Function::New(env, EzspNapi::Stop));
+    exports.Set("getTickStats", Napi::Function::New(env, EzspNapi::GetTickStats));
+    exports.Set("getPayloadPoolStats", Napi::Function::New(env, EzspNapi::GetPayloadPoolStats));
+    exports.Set("getCongestionStats", Napi::Function::New(env, EzspNapi::GetCongestionStats));
+    exports.Set("getCommandStats", Napi::Function::New(env, EzspNapi::GetCommandStats));
+    exports.Set("getLoopStats", Napi::Function::New(env, EzspNapi::GetLoopStats));
+    exports.Set("getAshStats", Napi::Function::New(env, EzspNapi::GetAshStats));
+    exports.Set("startCapture", Napi::Function::New(env, EzspNapi::StartCapture));
+    exports.Set("stopCapture", Napi::Function::New(env, EzspNapi::StopCapture));
+    exports.Set("getCaptureStats", Napi::Function::New(env, EzspNapi::GetCaptureStats));
+    exports.Set("setMessageFilters", Napi::Function::New(env, EzspNapi::SetMessageFilters));
+    exports.Set("getMessageFilterStats", Napi::Function::New(env, EzspNapi::GetMessageFilterStats));
+    exports.Set("getDuplicateStats", Napi::Function::New(env, EzspNapi::GetDuplicateStats));
+    exports.Set("getGpDedupTable", Napi::Function::New(env, EzspNapi::GetGpDedupTable));
+    exports.Set("getReportCoalescingStats", Napi::Function::New(env, EzspNapi::GetReportCoalescingStats));
+#ifdef EZSP_BENCH
+    exports.Set("benchEventDispatch", Napi::Function::New(env, EzspNapi::BenchEventDispatch));
+    exports.Set("benchEventMarshalling", Napi::Function::New(env, EzspNapi::BenchEventMarshalling));
+    exports.Set("benchApsFrame", Napi::Function::New(env, EzspNapi::BenchApsFrame));
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    exports.Set("openPseudoTerminal", Napi::Function::New(env, EzspNapi::OpenPseudoTerminal));
+#endif
 
     // Base
     exports.Set("ezspVersion", Napi::Function::New(env, EzspNapi::Version));
@@ -2378,6 +7230,82 @@ Napi::Object InitAll(Napi::Env env, Napi::Object exports)
     exports.Set("ezspGetEndpointFlags", Napi::Function::New(env, EzspNapi::GetEndpointFlags));
     exports.Set("ezspGetVersionStruct", Napi::Function::New(env, EzspNapi::GetVersionStruct));
     exports.Set("send", Napi::Function::New(env, EzspNapi::Send));
+    exports.Set("sendBatch", Napi::Function::New(env, EzspNapi::SendBatch));
+    exports.Set("sendTracked", Napi::Function::New(env, EzspNapi::SendTracked));
+
+    // Promise-returning variants of the commands, executed off the JS thread
+    Napi::Object asyncExports = Napi::Object::New(env);
+
+    // Lifecycle
+    SetAsyncCommand(env, asyncExports, "start", EzspNapi::Start);
+
+    // Base
+    SetAsyncCommand(env, asyncExports, "ezspVersion", EzspNapi::Version);
+    SetAsyncCommand(env, asyncExports, "ezspGetEui64", EzspNapi::GetEui64);
+
+    // Network management
+    SetAsyncCommand(env, asyncExports, "ezspGetNetworkParameters", EzspNapi::GetNetworkParameters);
+    SetAsyncCommand(env, asyncExports, "ezspNetworkInit", EzspNapi::NetworkInit);
+    SetAsyncCommand(env, asyncExports, "ezspNetworkState", EzspNapi::NetworkState);
+    SetAsyncCommand(env, asyncExports, "ezspFormNetwork", EzspNapi::FormNetwork);
+    SetAsyncCommand(env, asyncExports, "ezspLeaveNetwork", EzspNapi::LeaveNetwork);
+    SetAsyncCommand(env, asyncExports, "ezspPermitJoining", EzspNapi::PermitJoining);
+
+    // Configuration
+    SetAsyncCommand(env, asyncExports, "ezspGetConfigurationValue", EzspNapi::GetConfigurationValue);
+    SetAsyncCommand(env, asyncExports, "ezspSetConfigurationValue", EzspNapi::SetConfigurationValue);
+    SetAsyncCommand(env, asyncExports, "ezspGetValue", EzspNapi::GetValue);
+    SetAsyncCommand(env, asyncExports, "ezspSetValue", EzspNapi::SetValue);
+    SetAsyncCommand(env, asyncExports, "ezspGetExtendedValue", EzspNapi::GetExtendedValue);
+    SetAsyncCommand(env, asyncExports, "ezspSetPolicy", EzspNapi::SetPolicy);
+    SetAsyncCommand(env, asyncExports, "ezspTokenFactoryReset", EzspNapi::TokenFactoryReset);
+
+    // Security
+    SetAsyncCommand(env, asyncExports, "ezspSetInitialSecurityState", EzspNapi::SetInitialSecurityState);
+    SetAsyncCommand(env, asyncExports, "ezspGetNetworkKeyInfo", EzspNapi::GetNetworkKeyInfo);
+    SetAsyncCommand(env, asyncExports, "ezspGetApsKeyInfo", EzspNapi::GetApsKeyInfo);
+    SetAsyncCommand(env, asyncExports, "ezspExportKey", EzspNapi::ExportKey);
+    SetAsyncCommand(env, asyncExports, "ezspExportLinkKeyByIndex", EzspNapi::ExportLinkKeyByIndex);
+    SetAsyncCommand(env, asyncExports, "ezspImportLinkKey", EzspNapi::ImportLinkKey);
+    SetAsyncCommand(env, asyncExports, "ezspImportTransientKey", EzspNapi::ImportTransientKey);
+    SetAsyncCommand(env, asyncExports, "ezspEraseKeyTableEntry", EzspNapi::EraseKeyTableEntry);
+    SetAsyncCommand(env, asyncExports, "ezspClearKeyTable", EzspNapi::ClearKeyTable);
+    SetAsyncCommand(env, asyncExports, "ezspClearTransientLinkKeys", EzspNapi::ClearTransientLinkKeys);
+    SetAsyncCommand(env, asyncExports, "ezspBroadcastNextNetworkKey", EzspNapi::BroadcastNextNetworkKey);
+    SetAsyncCommand(env, asyncExports, "ezspBroadcastNetworkKeySwitch", EzspNapi::BroadcastNetworkKeySwitch);
+
+    // Messaging
+    SetAsyncCommand(env, asyncExports, "ezspSendUnicast", EzspNapi::SendUnicast);
+    SetAsyncCommand(env, asyncExports, "ezspSendMulticast", EzspNapi::SendMulticast);
+    SetAsyncCommand(env, asyncExports, "ezspSendBroadcast", EzspNapi::SendBroadcast);
+    SetAsyncCommand(env, asyncExports, "ezspSendRawMessage", EzspNapi::SendRawMessage);
+
+    // Radio/hardware
+    SetAsyncCommand(env, asyncExports, "ezspSetRadioPower", EzspNapi::SetRadioPower);
+    SetAsyncCommand(env, asyncExports, "ezspSetRadioIeee802154CcaMode", EzspNapi::SetRadioIeee802154CcaMode);
+    SetAsyncCommand(env, asyncExports, "ezspSetLogicalAndRadioChannel", EzspNapi::SetLogicalAndRadioChannel);
+    SetAsyncCommand(env, asyncExports, "ezspSetManufacturerCode", EzspNapi::SetManufacturerCode);
+
+    // Routing/tables
+    SetAsyncCommand(env, asyncExports, "ezspSetConcentrator", EzspNapi::SetConcentrator);
+    SetAsyncCommand(env, asyncExports, "ezspSetSourceRouteDiscoveryMode", EzspNapi::SetSourceRouteDiscoveryMode);
+    SetAsyncCommand(env, asyncExports, "ezspSetMulticastTableEntry", EzspNapi::SetMulticastTableEntry);
+    SetAsyncCommand(env, asyncExports, "ezspAddEndpoint", EzspNapi::AddEndpoint);
+
+    // Monitoring
+    SetAsyncCommand(env, asyncExports, "ezspReadAndClearCounters", EzspNapi::ReadAndClearCounters);
+
+    // Convenience wrappers
+    SetAsyncCommand(env, asyncExports, "ezspSetNWKFrameCounter", EzspNapi::SetNWKFrameCounter);
+    SetAsyncCommand(env, asyncExports, "ezspSetAPSFrameCounter", EzspNapi::SetAPSFrameCounter);
+    SetAsyncCommand(env, asyncExports, "ezspStartWritingStackTokens", EzspNapi::StartWritingStackTokens);
+    SetAsyncCommand(env, asyncExports, "ezspSetExtendedSecurityBitmask", EzspNapi::SetExtendedSecurityBitmask);
+    SetAsyncCommand(env, asyncExports, "ezspGetEndpointFlags", EzspNapi::GetEndpointFlags);
+    SetAsyncCommand(env, asyncExports, "ezspGetVersionStruct", EzspNapi::GetVersionStruct);
+    SetAsyncCommand(env, asyncExports, "send", EzspNapi::Send);
+    SetAsyncCommand(env, asyncExports, "sendBatch", EzspNapi::SendBatch);
+
+    exports.Set("async", asyncExports);
 
     return exports;
 }
@@ -0,0 +1,398 @@
+/**
+ * Parsing and building of frames exchanged with the NCP, free of Node-API.
+ * Shared by the addon (`binding.cpp`) and the native benchmark (`bench.cpp`).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Silicon Labs SDK headers
+extern "C"
+{
+#include "platform-header.h" // base types
+#include "sl_status.h"       // comes first - defines sl_status_t
+#include "sl_zigbee_types.h"
+#include "ezsp-enum.h"
+#include "ezsp-protocol.h"
+}
+
+// #region InterPAN helpers
+
+// NWK stub frame has two control bytes.
+#define STUB_NWK_SIZE 2
+#define STUB_NWK_FRAME_CONTROL 0x000B
+
+// Interpan APS Unicast
+//  - Frame Control   (1-byte)
+//  - Cluster ID      (2-bytes)
+//  - Profile ID      (2-bytes)
+#define INTERPAN_APS_UNICAST_SIZE 5
+
+// Interpan APS Multicast
+//  - Frame Control   (1-byte)
+//  - Group ID        (2-bytes)
+//  - Cluster ID      (2-bytes)
+//  - Profile ID      (2-bytes)
+#define INTERPAN_APS_MULTICAST_SIZE 7
+
+#define MIN_STUB_APS_SIZE (INTERPAN_APS_UNICAST_SIZE)
+
+#define INTERPAN_APS_FRAME_TYPE 0x03
+
+// The only allowed APS FC value (without the delivery mode subfield)
+#define INTERPAN_APS_FRAME_CONTROL_NO_DELIVERY_MODE (INTERPAN_APS_FRAME_TYPE)
+
+#define INTERPAN_APS_FRAME_DELIVERY_MODE_MASK 0x0C
+#define INTERPAN_APS_FRAME_SECURITY 0x20
+
+#define SL_ZIGBEE_AF_INTER_PAN_UNICAST 0x00u
+#define SL_ZIGBEE_AF_INTER_PAN_BROADCAST 0x08u
+#define SL_ZIGBEE_AF_INTER_PAN_MULTICAST 0x0Cu
+
+#define MAC_ACK_REQUIRED 0x0020
+
+#define MAC_FRAME_TYPE_DATA 0x0001
+
+#define MAC_FRAME_SOURCE_MODE_SHORT 0x8000
+#define MAC_FRAME_SOURCE_MODE_LONG 0xC000
+
+#define MAC_FRAME_DESTINATION_MODE_SHORT 0x0800
+#define MAC_FRAME_DESTINATION_MODE_LONG 0x0C00
+
+// The two possible incoming MAC frame controls.
+// Using short source address is not allowed.
+#define SHORT_DEST_FRAME_CONTROL (MAC_FRAME_TYPE_DATA | MAC_FRAME_DESTINATION_MODE_SHORT | MAC_FRAME_SOURCE_MODE_LONG)
+#define LONG_DEST_FRAME_CONTROL (MAC_FRAME_TYPE_DATA | MAC_FRAME_DESTINATION_MODE_LONG | MAC_FRAME_SOURCE_MODE_LONG)
+
+/**
+ * Inter-PAN message, as parsed from a MAC filter match
+ */
+struct InterpanMessage
+{
+    uint16_t panId;
+    sl_802154_long_addr_t longAddress;
+    uint16_t groupId;
+    uint16_t clusterId;
+    uint16_t profileId;
+    /** Start of the APS payload in the message contents */
+    uint8_t payloadOffset;
+};
+
+/**
+ * Parse the MAC, stub NWK and inter-PAN APS headers of a raw MAC frame.
+ * cf `parseInterpanMessage` in `simplicity_sdk/protocol/zigbee/app/framework/plugin/interpan/interpan.c`
+ * @param messageContents MAC frame, as given to `sl_zigbee_ezsp_mac_filter_match_message_handler`
+ * @param messageLength Length of the MAC frame
+ * @param message Output
+ * @return false if not a valid (unencrypted) inter-PAN message
+ */
+inline bool ParseInterpanMessage(const uint8_t *messageContents, uint8_t messageLength, InterpanMessage *message)
+{
+    const uint8_t *finger = messageContents;
+
+    // We rely on the stack to insure that the MAC frame is formatted
+    // correctly and that the length is at least long enough
+    // to contain that frame.
+
+    uint16_t macFrameControl = HIGH_LOW_TO_INT(finger[1], finger[0]) & ~(MAC_ACK_REQUIRED);
+
+    if (macFrameControl == LONG_DEST_FRAME_CONTROL)
+    {
+        // control, sequence, dest PAN ID, long dest
+        finger += 2 + 1 + 2 + 8;
+    }
+    else if (macFrameControl == SHORT_DEST_FRAME_CONTROL)
+    {
+        // control, sequence, dest PAN ID, short dest
+        finger += 2 + 1 + 2 + 2;
+    }
+    else
+    {
+        return false;
+    }
+
+    message->panId = HIGH_LOW_TO_INT(finger[1], finger[0]);
+    finger += 2;
+    memmove(message->longAddress, finger, 8);
+    finger += 8;
+
+    uint8_t remainingLength = messageLength - (uint8_t)(finger - messageContents);
+
+    if (remainingLength < (STUB_NWK_SIZE + MIN_STUB_APS_SIZE))
+    {
+        return false;
+    }
+
+    if (HIGH_LOW_TO_INT(finger[1], finger[0]) != STUB_NWK_FRAME_CONTROL)
+    {
+        return false;
+    }
+
+    finger += 2;
+    remainingLength -= 2;
+
+    uint8_t apsFrameControl = (*finger++);
+
+    if ((apsFrameControl & ~(INTERPAN_APS_FRAME_DELIVERY_MODE_MASK) & ~INTERPAN_APS_FRAME_SECURITY) != INTERPAN_APS_FRAME_CONTROL_NO_DELIVERY_MODE)
+    {
+        fprintf(stderr, "ERROR: Inter-PAN Bad APS frame control 0x%02X", apsFrameControl);
+        return false;
+    }
+
+    if (apsFrameControl & INTERPAN_APS_FRAME_SECURITY)
+    {
+        // !ALLOW_APS_ENCRYPTED_MESSAGES => SL_STATUS_NOT_AVAILABLE
+        return false;
+    }
+
+    uint8_t messageType = (apsFrameControl & INTERPAN_APS_FRAME_DELIVERY_MODE_MASK);
+    message->groupId = 0;
+
+    switch (messageType)
+    {
+    case SL_ZIGBEE_AF_INTER_PAN_UNICAST:
+    case SL_ZIGBEE_AF_INTER_PAN_BROADCAST:
+        // Broadcast and unicast have the same size messages
+        if (remainingLength < INTERPAN_APS_UNICAST_SIZE)
+        {
+            return false;
+        }
+
+        break;
+    case SL_ZIGBEE_AF_INTER_PAN_MULTICAST:
+        if (remainingLength < INTERPAN_APS_MULTICAST_SIZE)
+        {
+            return false;
+        }
+
+        message->groupId = HIGH_LOW_TO_INT(finger[1], finger[0]);
+        finger += 2;
+
+        break;
+    default:
+        fprintf(stderr, "ERROR: Inter-PAN Bad Delivery Mode 0x%02X", messageType);
+        return false;
+    }
+
+    message->clusterId = HIGH_LOW_TO_INT(finger[1], finger[0]);
+    finger += 2;
+    message->profileId = HIGH_LOW_TO_INT(finger[1], finger[0]);
+    finger += 2;
+    message->payloadOffset = (finger - messageContents);
+
+    return true;
+}
+
+// #endregion InterPAN helpers
+
+// #region EUI64
+
+/**
+ * Convert EUI64 from 8-byte array to hex string format (0xXXXXXXXXXXXXXXXX)
+ * @param eui64 Input buffer (8 bytes)
+ * @param hexString Output buffer (must be at least 19 bytes: "0x" + 16 hex chars + null terminator)
+ */
+inline void Eui64ToHexString(const uint8_t *eui64, char *hexString)
+{
+    snprintf(hexString, 19, "0x%02x%02x%02x%02x%02x%02x%02x%02x", eui64[7], eui64[6], eui64[5], eui64[4], eui64[3], eui64[2], eui64[1], eui64[0]);
+}
+
+/**
+ * Convert EUI64 from hex string (0xXXXXXXXXXXXXXXXX) to 8-byte array
+ * @param str String in format "0xXXXXXXXXXXXXXXXX"
+ * @param eui64 Output buffer (8 bytes)
+ * @return true on success, false on error
+ */
+inline bool Eui64FromHexString(const std::string &str, uint8_t *eui64)
+{
+    // Expected format: "0x" + 16 hex chars
+    if (str.length() != 18 || str[0] != '0' || str[1] != 'x')
+    {
+        return false;
+    }
+
+    // Parse in reverse order (little-endian)
+    for (int i = 0; i < 8; i++)
+    {
+        const char *hexByte = str.c_str() + 2 + (14 - i * 2); // Start from end
+        char temp[3] = {hexByte[0], hexByte[1], '\0'};
+        eui64[i] = (uint8_t)strtol(temp, nullptr, 16);
+    }
+
+    return true;
+}
+
+// #endregion EUI64
+
+// #region APS frame
+
+// Packed APS frame (little endian), as read/written by `readPackedApsFrame`/`writePackedApsFrame` in `src/index.ts`:
+// profileId (2), clusterId (2), sourceEndpoint, destinationEndpoint, options (2), groupId (2), sequence, radius
+#define PACKED_APS_FRAME_SIZE 12
+#define PACKED_APS_FRAME_SEQUENCE_OFFSET 10
+
+/**
+ * Write sl_zigbee_aps_frame_t in its packed form
+ * @param dst Destination, at least `PACKED_APS_FRAME_SIZE` bytes
+ * @param apsFrame Native struct pointer
+ */
+inline void WriteApsFrame(uint8_t *dst, const sl_zigbee_aps_frame_t *apsFrame)
+{
+    dst[0] = LOW_BYTE(apsFrame->profileId);
+    dst[1] = HIGH_BYTE(apsFrame->profileId);
+    dst[2] = LOW_BYTE(apsFrame->clusterId);
+    dst[3] = HIGH_BYTE(apsFrame->clusterId);
+    dst[4] = apsFrame->sourceEndpoint;
+    dst[5] = apsFrame->destinationEndpoint;
+    dst[6] = LOW_BYTE(apsFrame->options);
+    dst[7] = HIGH_BYTE(apsFrame->options);
+    dst[8] = LOW_BYTE(apsFrame->groupId);
+    dst[9] = HIGH_BYTE(apsFrame->groupId);
+    dst[PACKED_APS_FRAME_SEQUENCE_OFFSET] = apsFrame->sequence;
+    dst[11] = apsFrame->radius;
+}
+
+/**
+ * Read sl_zigbee_aps_frame_t from its packed form
+ * @param src Source, `PACKED_APS_FRAME_SIZE` bytes
+ * @param apsFrame Output native struct pointer
+ */
+inline void ReadApsFrame(const uint8_t *src, sl_zigbee_aps_frame_t *apsFrame)
+{
+    memset(apsFrame, 0, sizeof(sl_zigbee_aps_frame_t));
+    apsFrame->profileId = HIGH_LOW_TO_INT(src[1], src[0]);
+    apsFrame->clusterId = HIGH_LOW_TO_INT(src[3], src[2]);
+    apsFrame->sourceEndpoint = src[4];
+    apsFrame->destinationEndpoint = src[5];
+    apsFrame->options = HIGH_LOW_TO_INT(src[7], src[6]);
+    apsFrame->groupId = HIGH_LOW_TO_INT(src[9], src[8]);
+    apsFrame->sequence = src[PACKED_APS_FRAME_SEQUENCE_OFFSET];
+    apsFrame->radius = src[11];
+}
+
+// #endregion APS frame
+
+// #region ZCL header
+
+#define ZCL_FRAME_TYPE_MASK 0x03
+#define ZCL_FRAME_CONTROL_MANUFACTURER_SPECIFIC 0x04
+
+// ZCL header of an incoming message, decoded once natively
+struct ZclHeader
+{
+    uint8_t frameControl;
+    /** Only if `ZCL_FRAME_CONTROL_MANUFACTURER_SPECIFIC` */
+    uint16_t manufacturerCode;
+    uint8_t transactionSequenceNumber;
+    uint8_t commandId;
+    /** Start of the ZCL payload in the message contents, 0 if the header is malformed (or not decoded) */
+    uint8_t payloadOffset;
+
+    bool Valid(void) const { return payloadOffset != 0; }
+};
+
+/**
+ * Decode the ZCL header at the start of a message.
+ * Malformed (truncated, or reserved frame type) headers are returned with `payloadOffset` 0.
+ */
+inline ZclHeader ParseZclHeader(const uint8_t *message, uint8_t length)
+{
+    ZclHeader header = {};
+
+    if (length < 3 || (message[0] & ZCL_FRAME_TYPE_MASK) > 1)
+    {
+        return header;
+    }
+
+    header.frameControl = message[0];
+
+    if (header.frameControl & ZCL_FRAME_CONTROL_MANUFACTURER_SPECIFIC)
+    {
+        if (length < 5)
+        {
+            return header;
+        }
+
+        header.manufacturerCode = HIGH_LOW_TO_INT(message[2], message[1]);
+        header.transactionSequenceNumber = message[3];
+        header.commandId = message[4];
+        header.payloadOffset = 5;
+    }
+    else
+    {
+        header.transactionSequenceNumber = message[1];
+        header.commandId = message[2];
+        header.payloadOffset = 3;
+    }
+
+    return header;
+}
+
+// #endregion ZCL header
+
+// #region Green Power
+
+// ZCL GP notification (cluster 0x0021) header and fixed fields, followed by the GPD command payload
+#define GP_NOTIFICATION_HEADER_SIZE 15
+
+/**
+ * Rebuild the ZCL GP notification (or commissioning notification) of a GPDF received by the GPEP.
+ * XXX: specific to zigbee-herdsman
+ * @param param GPDF, not from an IEEE application ID
+ * @param apsFrame Output, APS frame of the GP endpoint
+ * @param dst Output, at least `GP_NOTIFICATION_HEADER_SIZE` + `param->gpdCommandPayloadLength` bytes
+ * @return Length written to `dst`
+ */
+inline uint8_t BuildGpNotification(const sl_zigbee_gp_params_t *param, sl_zigbee_aps_frame_t *apsFrame, uint8_t *dst)
+{
+    uint8_t commandIdentifier = 0x00;
+    uint16_t options = 0;
+
+    if (param->gpdCommandId == 0xe0)
+    {
+        // commissioning
+        commandIdentifier = 0x04;
+        options = (param->addr.applicationId & 0x7) | ((param->bidirectionalInfo & 0x1) << 3) | ((param->gpdfSecurityLevel & 0x3) << 4) |
+                  ((param->gpdfSecurityKeyType & 0x7) << 6);
+    }
+    else
+    {
+        options = (param->addr.applicationId & 0x7) | ((param->gpdfSecurityLevel & 0x3) << 6) | ((param->gpdfSecurityKeyType & 0x7) << 8) |
+                  ((param->bidirectionalInfo & 0x1) << 11);
+    }
+
+    memset(apsFrame, 0, sizeof(sl_zigbee_aps_frame_t));
+    apsFrame->profileId = 0xa1e0;         // GP
+    apsFrame->clusterId = 0x0021;         // GP
+    apsFrame->sourceEndpoint = 0xf2;      // GP
+    apsFrame->destinationEndpoint = 0xf2; // GP
+    apsFrame->options = 0;                // not used
+    apsFrame->groupId = 0x0b84;           // GP
+    apsFrame->sequence = 0;               // not used
+
+    dst[0] = 0x01;
+    dst[1] = param->sequenceNumber;
+    dst[2] = commandIdentifier;
+    dst[3] = options & 0xFF;
+    dst[4] = (options >> 8) & 0xFF;
+    dst[5] = param->addr.id.sourceId & 0xFF;
+    dst[6] = (param->addr.id.sourceId >> 8) & 0xFF;
+    dst[7] = (param->addr.id.sourceId >> 16) & 0xFF;
+    dst[8] = (param->addr.id.sourceId >> 24) & 0xFF;
+    dst[9] = param->gpdSecurityFrameCounter & 0xFF;
+    dst[10] = (param->gpdSecurityFrameCounter >> 8) & 0xFF;
+    dst[11] = (param->gpdSecurityFrameCounter >> 16) & 0xFF;
+    dst[12] = (param->gpdSecurityFrameCounter >> 24) & 0xFF;
+    dst[13] = param->gpdCommandId;
+    dst[14] = param->gpdCommandPayloadLength;
+    memcpy(&dst[GP_NOTIFICATION_HEADER_SIZE], param->gpdCommandPayload, param->gpdCommandPayloadLength);
+
+    return GP_NOTIFICATION_HEADER_SIZE + param->gpdCommandPayloadLength;
+}
+
+// #endregion Green Power
@@ -0,0 +1,344 @@
+import { afterEach, beforeAll, describe, expect, it, vi } from "vitest";
+import {
+    EZSP_BINARY_EVENT_HEADER_SIZE,
+    EZSP_CAPTURE_FILE_HEADER_SIZE,
+    EZSP_SEND_BATCH_ENTRY_HEADER_SIZE,
+    EzspBinaryEvent,
+    EzspBinaryEventKind,
+    type EzspNative,
+    type EzspNativeEvent,
+    packSendBatch,
+    readCapture,
+    readPackedApsFrame,
+    writePackedApsFrame,
+} from "../src/index.js";
+import { TEST_ASH_CONFIG } from "./fixtures.js";
+import {
+    EZSP_APS_FRAME_SIZE,
+    EZSP_INCOMING_MESSAGE_HANDLER,
+    EZSP_MESSAGE_SENT_HANDLER,
+    type EzspApsFrame,
+    NcpEmulator,
+    writeEzspApsFrame,
+} from "./ncp-emulator.js";
+
+/** profileId, clusterId, sourceEndpoint, destinationEndpoint, options, groupId, sequence, radius */
+const PACKED_APS_FRAME = Buffer.from([0x04, 0x01, 0x06, 0x00, 0x01, 0x0b, 0x40, 0x01, 0x00, 0x00, 0x2a, 0x00]);
+/** `SL_ZIGBEE_INCOMING_UNICAST` */
+const INCOMING_UNICAST = 0;
+/** sl_zigbee_rx_packet_info_t: sender, sender EUI64, binding index, address index, LQI, RSSI, timestamp */
+const PACKET_INFO_SIZE = 18;
+/** Report Attributes, OnOff = 1 */
+const REPORT = Buffer.from([0x18, 0x01, 0x0a, 0x00, 0x00, 0x10, 0x01]);
+const APS_FRAME: EzspApsFrame = {
+    profileId: 0x0104,
+    clusterId: 0x0006,
+    sourceEndpoint: 0x01,
+    destinationEndpoint: 0x0b,
+    options: 0x0140,
+    groupId: 0,
+    sequence: 0x2a,
+};
+
+/** `incomingMessageHandler` parameters */
+const incomingMessage = (apsFrame: EzspApsFrame, sender: number, lqi: number, rssi: number, message: Buffer): Buffer => {
+    const parameters = Buffer.alloc(1 + EZSP_APS_FRAME_SIZE + PACKET_INFO_SIZE + 1 + message.length);
+    parameters[0] = INCOMING_UNICAST;
+    writeEzspApsFrame(apsFrame, parameters, 1);
+
+    const packetInfo = 1 + EZSP_APS_FRAME_SIZE;
+    parameters.writeUInt16LE(sender, packetInfo);
+    parameters[packetInfo + 12] = lqi;
+    parameters.writeInt8(rssi, packetInfo + 13);
+    parameters[packetInfo + PACKET_INFO_SIZE] = message.length;
+    message.copy(parameters, packetInfo + PACKET_INFO_SIZE + 1);
+
+    return parameters;
+};
+
+/** `messageSentHandler` parameters */
+const messageSent = (
+    status: number,
+    type: number,
+    indexOrDestination: number,
+    apsFrame: EzspApsFrame,
+    messageTag: number,
+    message: Buffer,
+): Buffer => {
+    const parameters = Buffer.alloc(4 + 1 + 2 + EZSP_APS_FRAME_SIZE + 2 + 1 + message.length);
+    let offset = parameters.writeUInt32LE(status, 0);
+    offset = parameters.writeUInt8(type, offset);
+    offset = parameters.writeUInt16LE(indexOrDestination, offset);
+    writeEzspApsFrame(apsFrame, parameters, offset);
+    offset = parameters.writeUInt16LE(messageTag, offset + EZSP_APS_FRAME_SIZE);
+    offset = parameters.writeUInt8(message.length, offset);
+    message.copy(parameters, offset);
+
+    return parameters;
+};
+
+describe("Packed APS frame", () => {
+    it("reads packed APS frame", () => {
+        expect(readPackedApsFrame(PACKED_APS_FRAME)).toStrictEqual({
+            profileId: 0x0104,
+            clusterId: 0x0006,
+            sourceEndpoint: 0x01,
+            destinationEndpoint: 0x0b,
+            options: 0x0140,
+            groupId: 0,
+            sequence: 0x2a,
+            radius: 0,
+        });
+        expect(readPackedApsFrame(Buffer.concat([Buffer.alloc(2), PACKED_APS_FRAME]), 2).clusterId).toStrictEqual(0x0006);
+    });
+
+    it("writes packed APS frame", () => {
+        const apsFrame = readPackedApsFrame(PACKED_APS_FRAME);
+
+        expect(writePackedApsFrame(apsFrame)).toStrictEqual(PACKED_APS_FRAME);
+
+        const buffer = Buffer.alloc(16);
+
+        writePackedApsFrame(apsFrame, buffer, 4);
+        expect(readPackedApsFrame(buffer, 4)).toStrictEqual(apsFrame);
+    });
+});
+
+// events emitted by the binding, from callbacks of the emulated NCP
+describe("Binary events", () => {
+    let binding: EzspNative;
+    let emulator: NcpEmulator | undefined;
+    const events: Buffer[] = [];
+
+    beforeAll(async () => {
+        binding = (await import("../src/index.js")).default;
+    });
+
+    afterEach(() => {
+        binding.stop();
+        emulator?.close();
+        emulator = undefined;
+    });
+
+    const start = async (options: { duplicateWindow?: number; reportCoalescing?: { interval: number } } = {}): Promise<NcpEmulator> => {
+        events.length = 0;
+        emulator = NcpEmulator.open(binding);
+
+        binding.init({ ...TEST_ASH_CONFIG, ...options, serialPort: emulator.path, binaryEvents: true }, (event: EzspNativeEvent | Buffer) => {
+            if (Buffer.isBuffer(event)) {
+                events.push(event);
+            }
+        });
+        expect(await binding.async.start()).toStrictEqual(0);
+
+        return emulator;
+    };
+
+    const nextEvent = async (): Promise<EzspBinaryEvent> => {
+        await vi.waitFor(() => {
+            expect(events.length).toBeGreaterThan(0);
+        });
+
+        return new EzspBinaryEvent(events.shift()!);
+    };
+
+    it("decodes incomingMessage", async () => {
+        const ncp = await start();
+
+        ncp.callback(EZSP_INCOMING_MESSAGE_HANDLER, incomingMessage(APS_FRAME, 0x1234, 255, -60, REPORT));
+
+        const event = await nextEvent();
+
+        expect(event.kind).toStrictEqual(EzspBinaryEventKind.INCOMING_MESSAGE);
+        expect(event.name).toStrictEqual("incomingMessage");
+        expect(event.type).toStrictEqual(INCOMING_UNICAST);
+        expect(event.apsFrame).toStrictEqual({ ...APS_FRAME, radius: 0 });
+        expect(event.sender).toStrictEqual(0x1234);
+        expect(event.lastHopLqi).toStrictEqual(255);
+        expect(event.lastHopRssi).toStrictEqual(-60);
+        expect(event.messageContents).toStrictEqual(REPORT);
+        expect(event.buffer.length).toStrictEqual(EZSP_BINARY_EVENT_HEADER_SIZE + REPORT.length);
+        expect(event.zclHeader).toStrictEqual({
+            frameControl: 0x18,
+            manufacturerCode: undefined,
+            transactionSequenceNumber: 0x01,
+            commandId: 0x0a,
+            payloadOffset: 3,
+        });
+    });
+
+    it("decodes ZCL header of incomingMessage", async () => {
+        const ncp = await start();
+
+        // manufacturer specific
+        ncp.callback(EZSP_INCOMING_MESSAGE_HANDLER, incomingMessage(APS_FRAME, 0x1234, 255, -60, Buffer.from([0x1c, 0x5f, 0x11, 0x02, 0x0a])));
+        // malformed
+        ncp.callback(EZSP_INCOMING_MESSAGE_HANDLER, incomingMessage(APS_FRAME, 0x1234, 255, -60, Buffer.from([0x18, 0x01])));
+
+        expect((await nextEvent()).zclHeader).toStrictEqual({
+            frameControl: 0x1c,
+            manufacturerCode: 0x115f,
+            transactionSequenceNumber: 0x02,
+            commandId: 0x0a,
+            payloadOffset: 5,
+        });
+        expect((await nextEvent()).zclHeader).toStrictEqual(null);
+    });
+
+    it("decodes zdoResponse", async () => {
+        const ncp = await start();
+        // Node_Desc_rsp
+        const message = Buffer.from([0x01, 0x00, 0x34, 0x12]);
+
+        ncp.callback(EZSP_INCOMING_MESSAGE_HANDLER, incomingMessage({ ...APS_FRAME, profileId: 0, clusterId: 0x8002 }, 0x1234, 200, -70, message));
+
+        const event = await nextEvent();
+
+        expect(event.kind).toStrictEqual(EzspBinaryEventKind.ZDO_RESPONSE);
+        expect(event.name).toStrictEqual("zdoResponse");
+        expect(event.apsFrame.clusterId).toStrictEqual(0x8002);
+        expect(event.sender).toStrictEqual(0x1234);
+        expect(event.messageContents).toStrictEqual(message);
+    });
+
+    it("decodes messageSent", async () => {
+        const ncp = await start();
+        const message = Buffer.from([0x01, 0x00, 0x02]);
+
+        ncp.callback(EZSP_MESSAGE_SENT_HANDLER, messageSent(0x0c02, 1, 1, { ...APS_FRAME, groupId: 1 }, 0xcafe, message));
+
+        const event = await nextEvent();
+
+        expect(event.kind).toStrictEqual(EzspBinaryEventKind.MESSAGE_SENT);
+        expect(event.name).toStrictEqual("messageSent");
+        expect(event.type).toStrictEqual(1);
+        expect(event.apsFrame.groupId).toStrictEqual(1);
+        expect(event.indexOrDestination).toStrictEqual(1);
+        expect(event.messageTag).toStrictEqual(0xcafe);
+        expect(event.status).toStrictEqual(0x0c02);
+        expect(event.messageContents).toStrictEqual(message);
+    });
+
+    it("drops duplicates only for the same endpoint and payload (duplicateWindow)", async () => {
+        const ncp = await start({ duplicateWindow: 2000 });
+
+        ncp.callback(EZSP_INCOMING_MESSAGE_HANDLER, incomingMessage(APS_FRAME, 0x1234, 255, -60, REPORT));
+        // APS retry
+        ncp.callback(EZSP_INCOMING_MESSAGE_HANDLER, incomingMessage(APS_FRAME, 0x1234, 255, -60, REPORT));
+        // same APS counter, another endpoint of the sender
+        ncp.callback(EZSP_INCOMING_MESSAGE_HANDLER, incomingMessage({ ...APS_FRAME, sourceEndpoint: 2 }, 0x1234, 255, -60, REPORT));
+        // same APS counter, another payload (counter wrapped)
+        ncp.callback(EZSP_INCOMING_MESSAGE_HANDLER, incomingMessage(APS_FRAME, 0x1234, 255, -60, Buffer.from([0x18, 0x02, 0x0b, 0x01, 0x00])));
+
+        expect((await nextEvent()).apsFrame.sourceEndpoint).toStrictEqual(1);
+        expect((await nextEvent()).apsFrame.sourceEndpoint).toStrictEqual(2);
+        expect((await nextEvent()).messageContents.length).toStrictEqual(5);
+        expect(binding.getDuplicateStats()).toMatchObject({ checked: 4, duplicates: 1 });
+    });
+
+    it("delivers held reports before another frame of their source (reportCoalescing)", async () => {
+        const ncp = await start({ reportCoalescing: { interval: 60000 } });
+        // Read Attributes response, OnOff = 0
+        const readResponse = Buffer.from([0x18, 0x03, 0x01, 0x00, 0x00, 0x00, 0x10, 0x00]);
+
+        ncp.callback(EZSP_INCOMING_MESSAGE_HANDLER, incomingMessage(APS_FRAME, 0x1234, 255, -60, REPORT));
+        // held
+        ncp.callback(EZSP_INCOMING_MESSAGE_HANDLER, incomingMessage({ ...APS_FRAME, sequence: 0x2b }, 0x1234, 255, -60, REPORT));
+        ncp.callback(EZSP_INCOMING_MESSAGE_HANDLER, incomingMessage({ ...APS_FRAME, sequence: 0x2c }, 0x1234, 255, -60, readResponse));
+
+        expect((await nextEvent()).apsFrame.sequence).toStrictEqual(0x2a);
+        expect((await nextEvent()).apsFrame.sequence).toStrictEqual(0x2b);
+        expect((await nextEvent()).messageContents).toStrictEqual(readResponse);
+        expect(binding.getReportCoalescingStats()).toMatchObject({ held: 1, flushed: 1 });
+    });
+
+    it("has no name for an unknown kind", () => {
+        const buffer = Buffer.alloc(EZSP_BINARY_EVENT_HEADER_SIZE);
+        buffer[0] = 0xff;
+
+        expect(new EzspBinaryEvent(buffer).name).toStrictEqual(undefined);
+    });
+});
+
+describe("Packed send batch", () => {
+    it("packs entries", () => {
+        const apsFrame = readPackedApsFrame(PACKED_APS_FRAME);
+        const packed = packSendBatch([
+            [0, 0x1234, apsFrame, Buffer.from([1, 2, 3]), 0, 0],
+            [3, 0xfffd, PACKED_APS_FRAME, Buffer.alloc(0), 0xabcd, 7],
+        ]);
+
+        expect(packed.length).toStrictEqual(2 * EZSP_SEND_BATCH_ENTRY_HEADER_SIZE + 3);
+        expect(packed[0]).toStrictEqual(0);
+        expect(packed.readUInt16LE(1)).toStrictEqual(0x1234);
+        expect(readPackedApsFrame(packed, 3)).toStrictEqual(apsFrame);
+        expect(packed[18]).toStrictEqual(3);
+        expect(packed.subarray(19, 22)).toStrictEqual(Buffer.from([1, 2, 3]));
+
+        const second = packed.subarray(22);
+
+        expect(second[0]).toStrictEqual(3);
+        expect(second.readUInt16LE(1)).toStrictEqual(0xfffd);
+        expect(readPackedApsFrame(second, 3)).toStrictEqual(apsFrame);
+        expect(second.readUInt16LE(15)).toStrictEqual(0xabcd);
+        expect(second[17]).toStrictEqual(7);
+        expect(second[18]).toStrictEqual(0);
+    });
+
+    it("rejects message too long", () => {
+        const apsFrame = readPackedApsFrame(PACKED_APS_FRAME);
+
+        expect(() => packSendBatch([[0, 0x1234, apsFrame, Buffer.alloc(256), 0, 0]])).toThrow(RangeError);
+    });
+});
+
+describe("Capture file", () => {
+    // as written by `CaptureStart`/`CaptureCommit` in binding.cpp
+    const header = Buffer.alloc(EZSP_CAPTURE_FILE_HEADER_SIZE);
+    header.write("EZSPCAP", 0, "latin1");
+    header[7] = 1;
+    header.writeBigUInt64LE(1_700_000_000_000_000n, 8);
+    header.writeBigUInt64LE(123_456_789n, 16);
+
+    const record = (deltaUs: number, flags: number, frame: number[]): Buffer => {
+        const buffer = Buffer.alloc(7 + frame.length);
+        buffer.writeUInt32LE(deltaUs, 0);
+        buffer[4] = flags;
+        buffer.writeUInt16LE(frame.length, 5);
+        buffer.set(frame, 7);
+
+        return buffer;
+    };
+
+    it("decodes records", () => {
+        const rst = [0x1a, 0xc0, 0x38, 0xbc, 0x7e];
+        const rstack = [0xc1, 0x02, 0x0b, 0x0a, 0x52, 0x7e];
+        const time = Buffer.alloc(8);
+        time.writeBigUInt64LE(5_000_000_000_000n);
+
+        const capture = readCapture(
+            Buffer.concat([
+                header,
+                record(10, 0, rst),
+                record(1500, 0x01, rstack),
+                record(0, 0x80, [...time]),
+                record(3, 0x01 | 0x02 | 0x04, [0x7e]),
+                // cut short
+                record(1, 0, [0x81, 0x60, 0x59, 0x7e]).subarray(0, 9),
+            ]),
+        );
+
+        expect(capture.version).toStrictEqual(1);
+        expect(capture.startTime).toStrictEqual(1_700_000_000_000_000);
+        expect(capture.startHrtime).toStrictEqual(123_456_789n);
+        expect(capture.records).toStrictEqual([
+            { time: 10, direction: "hostToNcp", truncated: false, afterDrop: false, frame: Buffer.from(rst) },
+            { time: 1510, direction: "ncpToHost", truncated: false, afterDrop: false, frame: Buffer.from(rstack) },
+            { time: 5_000_000_003, direction: "ncpToHost", truncated: true, afterDrop: true, frame: Buffer.from([0x7e]) },
+        ]);
+    });
+
+    it("rejects other files", () => {
+        expect(() => readCapture(Buffer.from("not a capture file at all"))).toThrow();
+    });
+});
@@ -1,11 +1,108 @@
-import { describe } from "vitest";
+import { performance } from "node:perf_hooks";
+import { afterEach, beforeAll, describe, expect, it } from "vitest";
+import type { EzspNative, EzspNativeEvent } from "../src/index.js";
+import { TEST_ASH_CONFIG } from "./fixtures.js";
+import { EZSP_STACK_STATUS_HANDLER, NcpEmulator } from "./ncp-emulator.js";
 
-// import type { EzspNative } from "../src/index.js";
+/** `SL_STATUS_NETWORK_UP` */
+const NETWORK_UP = 0x0090;
 
-describe.skip("EZSP Callbacks", () => {
-    // let binding: EzspNative;
-    // beforeAll(async () => {
-    //     binding = (await import("../src/index.js")).default;
-    // });
-    // TODO: mock hardware
+describe("EZSP Callbacks", () => {
+    let binding: EzspNative;
+    let emulator: NcpEmulator;
+    let events: EzspNativeEvent[];
+    let onEvent: (() => void) | undefined;
+
+    const nextEvent = (): Promise<void> =>
+        new Promise((resolve) => {
+            onEvent = resolve;
+        });
+
+    beforeAll(async () => {
+        binding = (await import("../src/index.js")).default;
+    });
+
+    afterEach(() => {
+        binding.stop();
+        emulator.close();
+    });
+
+    const start = async (options: { eventDriven?: boolean; eventBatch?: { maxSize?: number; maxDelay?: number } } = {}): Promise<void> => {
+        events = [];
+        emulator = NcpEmulator.open(binding);
+
+        binding.init({ ...TEST_ASH_CONFIG, ...options, serialPort: emulator.path }, (event: EzspNativeEvent | EzspNativeEvent[]) => {
+            events.push(...(Array.isArray(event) ? event : [event]));
+            onEvent?.();
+        });
+        expect(await binding.async.start()).toStrictEqual(0);
+    };
+
+    const status = (value: number): Buffer => {
+        const buffer = Buffer.alloc(4);
+        buffer.writeUInt32LE(value);
+
+        return buffer;
+    };
+
+    it("emits stackStatus", async () => {
+        await start();
+
+        const received = nextEvent();
+
+        emulator.callback(EZSP_STACK_STATUS_HANDLER, status(NETWORK_UP));
+        await received;
+
+        expect(events).toStrictEqual([{ name: "stackStatus", status: NETWORK_UP }]);
+    });
+
+    it("emits callbacks in NCP order", async () => {
+        await start();
+
+        for (let i = 0; i < 20; i++) {
+            emulator.callback(EZSP_STACK_STATUS_HANDLER, status(i));
+        }
+
+        while (events.length < 20) {
+            await nextEvent();
+        }
+
+        expect(events.map((event) => (event as { status: number }).status)).toStrictEqual(Array.from({ length: 20 }, (_, i) => i));
+    });
+
+    it("emits callbacks queued in the host without waiting for an ASH deadline (eventDriven)", async () => {
+        await start({ eventDriven: true });
+
+        const sentAt = performance.now();
+
+        for (let i = 0; i < 20; i++) {
+            emulator.callback(EZSP_STACK_STATUS_HANDLER, status(i));
+        }
+
+        while (events.length < 20) {
+            await nextEvent();
+        }
+
+        // well under `nrTime` (480ms), the idle tick interval
+        expect(performance.now() - sentAt).toBeLessThan(200);
+    });
+
+    it("delivers batched events on stop", async () => {
+        await start({ eventBatch: { maxSize: 100, maxDelay: 60000 } });
+
+        for (let i = 0; i < 3; i++) {
+            emulator.callback(EZSP_STACK_STATUS_HANDLER, status(i));
+        }
+
+        // received and batched by the host, held until `maxDelay`
+        await new Promise((resolve) => setTimeout(resolve, 100));
+        expect(events).toStrictEqual([]);
+
+        const received = nextEvent();
+
+        binding.stop();
+        await received;
+
+        expect(events.map((event) => (event as { status: number }).status)).toStrictEqual([0, 1, 2]);
+    });
 });
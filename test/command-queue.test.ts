@@ -0,0 +1,60 @@
+import { describe, expect, it } from "vitest";
+import { TEST_APS_FRAME, TEST_MESSAGE, useNcpStandIn } from "./fixtures.js";
+
+/** `SL_ZIGBEE_OUTGOING_DIRECT` */
+const OUTGOING_DIRECT = 0;
+/** `SL_STATUS_INVALID_PARAMETER` */
+const INVALID_PARAMETER = 0x0021;
+/** `sequence` is written back by `send` */
+const SEQUENCED_APS_FRAME = { ...TEST_APS_FRAME, sequence: 0xab };
+
+// sync commands block the JS thread, the NCP runs in its own process
+describe("Command queue", () => {
+    const stack = useNcpStandIn();
+
+    it("runs a sync command after the async ones called before", async () => {
+        const frames = [{ ...SEQUENCED_APS_FRAME }, { ...SEQUENCED_APS_FRAME }, { ...SEQUENCED_APS_FRAME }];
+        const pending = [
+            stack.binding.async.send(OUTGOING_DIRECT, 0x1234, frames[0], TEST_MESSAGE, 0, 0),
+            stack.binding.async.send(OUTGOING_DIRECT, 0x1234, frames[1], TEST_MESSAGE, 0, 0),
+        ];
+        const [status] = stack.binding.send(OUTGOING_DIRECT, 0x1234, frames[2], TEST_MESSAGE, 0, 0);
+
+        expect(status).toStrictEqual(0);
+
+        for (const [asyncStatus] of await Promise.all(pending)) {
+            expect(asyncStatus).toStrictEqual(0);
+        }
+
+        // APS sequences are assigned by the NCP in arrival order
+        expect(frames[1].sequence).toStrictEqual((frames[0].sequence + 1) & 0xff);
+        expect(frames[2].sequence).toStrictEqual((frames[1].sequence + 1) & 0xff);
+    });
+
+    it("rejects async commands not run yet on stop", async () => {
+        const pending = Array.from({ length: 4 }, () => stack.binding.async.ezspVersion(13));
+
+        stack.binding.stop();
+
+        const results = await Promise.allSettled(pending);
+
+        // the first may already be running
+        for (const result of results.slice(1)) {
+            expect(result.status).toStrictEqual("rejected");
+            expect((result as PromiseRejectedResult).reason.message).toStrictEqual("Stopped");
+        }
+    });
+
+    it("writes back the APS sequence only if sent", async () => {
+        const frame = { ...SEQUENCED_APS_FRAME };
+
+        expect(stack.binding.send(0xff, 0x1234, frame, TEST_MESSAGE, 0, 0)[0]).toStrictEqual(INVALID_PARAMETER);
+        expect(frame.sequence).toStrictEqual(0xab);
+
+        expect((await stack.binding.async.send(0xff, 0x1234, frame, TEST_MESSAGE, 0, 0))[0]).toStrictEqual(INVALID_PARAMETER);
+        expect(frame.sequence).toStrictEqual(0xab);
+
+        expect((await stack.binding.async.send(OUTGOING_DIRECT, 0x1234, frame, TEST_MESSAGE, 0, 0))[0]).toStrictEqual(0);
+        expect(frame.sequence).not.toStrictEqual(0xab);
+    });
+});
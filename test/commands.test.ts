@@ -1,20 +1,11 @@
 import { beforeAll, describe, expect, it } from "vitest";
 import type { EzspNative } from "../src/index.js";
+import { TEST_APS_FRAME } from "./fixtures.js";
 
 const TEST_EUI64 = "0x0123456789abcdef";
 const TEST_EUI64_INVALID = "0xinvalid";
 const TEST_EUI64_SHORT = "0x0123";
 
-const TEST_APS_FRAME = {
-    profileId: 0x0104,
-    clusterId: 0x0006,
-    sourceEndpoint: 1,
-    destinationEndpoint: 1,
-    options: 0x0040,
-    groupId: 0,
-    sequence: 0,
-};
-
 const TEST_NETWORK_PARAMS = {
     extendedPanId: [0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15],
     panId: 0x1234,
@@ -391,6 +382,18 @@ describe("EZSP Commands", () => {
                 binding.ezspSendUnicast(0, 0x1234, {} as any, 1, validMessage);
             }).toThrow();
         });
+
+        it("rejects packed APS frame of invalid size", () => {
+            const validMessage = Buffer.from([0x00, 0x01, 0x02]);
+
+            expect(() => {
+                binding.ezspSendUnicast(0, 0x1234, Buffer.alloc(11), 1, validMessage);
+            }).toThrow();
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.ezspSendUnicast(0, 0x1234, new Uint16Array(6) as any, 1, validMessage);
+            }).toThrow();
+        });
     });
 
     describe("ezspSendMulticast", () => {
@@ -612,4 +615,45 @@ describe("EZSP Commands", () => {
             }).toThrow();
         });
     });
+
+    describe("sendBatch", () => {
+        it("rejects invalid arguments", () => {
+            const validMessage = Buffer.from([0x00, 0x01, 0x02]);
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.sendBatch("not a batch" as any);
+            }).toThrow();
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.sendBatch([[0, 0x1234, TEST_APS_FRAME, validMessage, 0] as any]);
+            }).toThrow();
+
+            expect(() => {
+                binding.sendBatch([
+                    [0, 0x1234, TEST_APS_FRAME, validMessage, 0, 0],
+                    // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                    [0, 0x1234, null as any, validMessage, 0, 0],
+                ]);
+            }).toThrow();
+
+            expect(() => {
+                binding.sendBatch([[0, 0x1234, TEST_APS_FRAME, Buffer.alloc(256), 0, 0]]);
+            }).toThrow();
+        });
+
+        it("rejects truncated packed batch", () => {
+            expect(() => {
+                binding.sendBatch(Buffer.alloc(18));
+            }).toThrow();
+
+            const truncatedMessage = Buffer.alloc(19);
+            truncatedMessage[18] = 1;
+
+            expect(() => {
+                binding.sendBatch(truncatedMessage);
+            }).toThrow();
+        });
+    });
 });
@@ -0,0 +1,82 @@
+import { beforeEach, describe, expect, it, vi } from "vitest";
+import type { EzspNativeEvent } from "../src/index.js";
+import { TEST_APS_FRAME, TEST_ASH_CONFIG, TEST_MESSAGE, useNcpStandIn } from "./fixtures.js";
+
+/** `SL_ZIGBEE_OUTGOING_DIRECT` */
+const OUTGOING_DIRECT = 0;
+/** `SL_STATUS_IN_PROGRESS` */
+const IN_PROGRESS = 0x0005;
+/** `SL_STATUS_ABORT` */
+const ABORT = 0x0006;
+
+// sync sends block the JS thread, the NCP runs in its own process
+describe("Congestion control", () => {
+    const events: EzspNativeEvent[] = [];
+    const onEvent = (event: EzspNativeEvent): void => {
+        events.push(event);
+    };
+
+    beforeEach(() => {
+        events.length = 0;
+    });
+
+    const stack = useNcpStandIn({ congestionControl: { minWindow: 1, maxWindow: 1 } }, onEvent);
+
+    const send = () => stack.binding.send(OUTGOING_DIRECT, 0x1234, { ...TEST_APS_FRAME }, TEST_MESSAGE, 0, 0);
+    const messageSent = (messageTag: number) => events.find((event) => event.name === "messageSent" && event.messageTag === messageTag);
+
+    it("does not count raw sends in the window", async () => {
+        await stack.ncp.messageSent(null);
+
+        const [status, messageTag] = send();
+
+        expect(status).toStrictEqual(0);
+        expect(stack.binding.getCongestionStats().inFlight).toStrictEqual(1);
+
+        await stack.ncp.messageSent(0);
+
+        // same tag, another APS sequence
+        expect(stack.binding.ezspSendUnicast(OUTGOING_DIRECT, 0x1234, { ...TEST_APS_FRAME }, messageTag, TEST_MESSAGE)[0]).toStrictEqual(0);
+
+        await vi.waitFor(() => {
+            expect(messageSent(messageTag)).toBeDefined();
+        });
+
+        expect(stack.binding.getCongestionStats().inFlight).toStrictEqual(1);
+    });
+
+    it("fails sends still queued on stop", async () => {
+        await stack.ncp.messageSent(null);
+
+        expect(send()[0]).toStrictEqual(0);
+
+        const [status, messageTag] = send();
+
+        expect(status).toStrictEqual(IN_PROGRESS);
+        expect(stack.binding.getCongestionStats().queued).toStrictEqual(1);
+
+        stack.binding.stop();
+
+        await vi.waitFor(() => {
+            expect(messageSent(messageTag)).toMatchObject({ status: ABORT });
+        });
+    });
+
+    it("fails sends still queued on init", async () => {
+        await stack.ncp.messageSent(null);
+
+        expect(send()[0]).toStrictEqual(0);
+
+        const [status, messageTag] = send();
+
+        expect(status).toStrictEqual(IN_PROGRESS);
+
+        stack.binding.init({ ...TEST_ASH_CONFIG, serialPort: stack.ncp.path, congestionControl: { minWindow: 1, maxWindow: 1 } }, onEvent);
+
+        expect(stack.binding.getCongestionStats().queued).toStrictEqual(0);
+
+        await vi.waitFor(() => {
+            expect(messageSent(messageTag)).toMatchObject({ status: ABORT });
+        });
+    });
+});
@@ -0,0 +1,82 @@
+import { describe, expect, it } from "vitest";
+import type { EzspDeliveryError } from "../src/index.js";
+import { TEST_APS_FRAME, TEST_ASH_CONFIG, TEST_MESSAGE, useNcpStandIn } from "./fixtures.js";
+
+/** `SL_ZIGBEE_OUTGOING_DIRECT` */
+const OUTGOING_DIRECT = 0;
+/** `SL_STATUS_ABORT` */
+const ABORT = 0x0006;
+/** `SL_STATUS_TIMEOUT` */
+const TIMEOUT = 0x0007;
+/** `SL_STATUS_ZIGBEE_DELIVERY_FAILED` */
+const DELIVERY_FAILED = 0x0c02;
+
+// `sendTracked` sends synchronously, the NCP runs in its own process
+describe("Delivery tracking", () => {
+    const stack = useNcpStandIn();
+
+    const sendTracked = (timeout?: number) => stack.binding.sendTracked(OUTGOING_DIRECT, 0x1234, { ...TEST_APS_FRAME }, TEST_MESSAGE, 0, 0, timeout);
+
+    it("resolves on delivery", async () => {
+        const delivery = await sendTracked();
+
+        expect(delivery.messageTag).toBeGreaterThanOrEqual(0x80);
+        expect(typeof delivery.apsSequence).toStrictEqual("number");
+    });
+
+    it("rejects on failed delivery", async () => {
+        await stack.ncp.messageSent(DELIVERY_FAILED);
+
+        const error: EzspDeliveryError = await sendTracked().catch((reason) => reason);
+
+        expect(error.message).toStrictEqual("Delivery failed");
+        expect(error.status).toStrictEqual(DELIVERY_FAILED);
+        expect(error.messageTag).toBeGreaterThanOrEqual(0x80);
+    });
+
+    it("rejects on timeout", async () => {
+        await stack.ncp.messageSent(null);
+
+        const error: EzspDeliveryError = await sendTracked(100).catch((reason) => reason);
+
+        expect(error.message).toStrictEqual("Delivery timed out");
+        expect(error.status).toStrictEqual(TIMEOUT);
+    });
+
+    it("rejects on stop", async () => {
+        await stack.ncp.messageSent(null);
+
+        const pending = sendTracked(60000).catch((reason) => reason);
+
+        stack.binding.stop();
+
+        const error: EzspDeliveryError = await pending;
+
+        expect(error.message).toStrictEqual("Stopped");
+        expect(error.status).toStrictEqual(ABORT);
+    });
+
+    it("reserves tracked tags while tracked sends are in flight", async () => {
+        await stack.ncp.messageSent(null);
+
+        const pending = sendTracked(60000).catch((reason) => reason);
+
+        expect(() => stack.binding.ezspSendUnicast(OUTGOING_DIRECT, 0x1234, { ...TEST_APS_FRAME }, 0x80, TEST_MESSAGE)).toThrow(RangeError);
+        expect(() => stack.binding.ezspSendBroadcast(0, 0xfffc, 0, { ...TEST_APS_FRAME }, 3, 0xffff, TEST_MESSAGE)).toThrow(RangeError);
+
+        stack.binding.stop();
+        await pending;
+    });
+
+    it("accepts any tag without tracked sends in flight", () => {
+        expect(stack.binding.ezspSendUnicast(OUTGOING_DIRECT, 0x1234, { ...TEST_APS_FRAME }, 0x80, TEST_MESSAGE)[0]).toStrictEqual(0);
+    });
+
+    it("tracks sends again after a stop", async () => {
+        stack.binding.stop();
+        stack.binding.init({ ...TEST_ASH_CONFIG, serialPort: stack.ncp.path }, () => {});
+        expect(await stack.binding.async.start()).toStrictEqual(0);
+
+        expect((await sendTracked()).messageTag).toBeGreaterThanOrEqual(0x80);
+    });
+});
@@ -0,0 +1,46 @@
+import { afterAll, beforeAll, bench, describe } from "vitest";
+import { TEST_ASH_CONFIG } from "./fixtures.js";
+
+/** events per iteration, time per event = iteration time / EVENTS */
+const EVENTS = 100;
+
+// `bench*` exports: `npm run build:gyp:bench`
+const binding = (await import("../src/index.js")).default;
+
+describe.skipIf(!binding.benchEventDispatch).each([
+    ["Event dispatch", undefined],
+    ["Event dispatch (batched)", { maxSize: 32 }],
+])("%s", (_name, eventBatch) => {
+    let remaining = 0;
+    let done: (() => void) | undefined;
+
+    const dispatch = (direct: boolean): Promise<void> =>
+        new Promise((resolve) => {
+            remaining = EVENTS;
+            done = resolve;
+
+            binding.benchEventDispatch!(EVENTS, direct);
+        });
+
+    beforeAll(() => {
+        binding.init(eventBatch ? { ...TEST_ASH_CONFIG, eventBatch } : TEST_ASH_CONFIG, (events: unknown) => {
+            remaining -= Array.isArray(events) ? events.length : 1;
+
+            if (remaining === 0) {
+                done?.();
+            }
+        });
+    });
+
+    afterAll(() => {
+        binding.stop();
+    });
+
+    bench("thread-safe function", async () => {
+        await dispatch(false);
+    });
+
+    bench("direct", async () => {
+        await dispatch(true);
+    });
+});
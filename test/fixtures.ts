@@ -0,0 +1,157 @@
+import { type ChildProcess, fork } from "node:child_process";
+import { fileURLToPath } from "node:url";
+import { afterAll, afterEach, beforeAll, beforeEach, expect } from "vitest";
+import type { EzspNative } from "../src/index.js";
+import type { NcpEmulatorStats } from "./ncp-emulator.js";
+import type { NcpStandInMessage, NcpStandInRequest } from "./ncp-stand-in.js";
+
+/** ASH settings for the emulated NCPs (`serialPort` is the emulator's pseudo-terminal) */
+export const TEST_ASH_CONFIG = {
+    baudRate: 115200,
+    stopBits: 1 as const,
+    rtsCts: false,
+    outBlockLen: 256,
+    inBlockLen: 256,
+    traceFlags: 0,
+    txK: 3,
+    randomize: true,
+    ackTimeInit: 800,
+    ackTimeMin: 400,
+    ackTimeMax: 2400,
+    timeRst: 5000,
+    nrLowLimit: 8,
+    nrHighLimit: 12,
+    nrTime: 480,
+    resetMethod: 0 as const,
+};
+
+/** Home Automation On/Off, pass a copy to sends: they write the APS sequence back */
+export const TEST_APS_FRAME = {
+    profileId: 0x0104,
+    clusterId: 0x0006,
+    sourceEndpoint: 1,
+    destinationEndpoint: 1,
+    options: 0x0140,
+    groupId: 0,
+    sequence: 0,
+};
+
+/** On/Off toggle */
+export const TEST_MESSAGE = Buffer.from([0x01, 0x00, 0x02]);
+
+/**
+ * Stand-in NCP running in its own process (`ncp-stand-in.ts`), it keeps answering while this JS thread is blocked.
+ */
+export class NcpStandIn {
+    readonly path: string;
+    readonly #child: ChildProcess;
+
+    private constructor(child: ChildProcess, path: string) {
+        this.#child = child;
+        this.path = path;
+    }
+
+    static async fork(): Promise<NcpStandIn> {
+        const child = fork(fileURLToPath(new URL("./ncp-stand-in.ts", import.meta.url)), [], { execArgv: ["--import", "tsx"] });
+        const path = await new Promise<string>((resolve) => {
+            child.on("message", (message: NcpStandInMessage) => {
+                if (message.type === "ready") {
+                    resolve(message.path);
+                }
+            });
+        });
+
+        return new NcpStandIn(child, path);
+    }
+
+    request(request: NcpStandInRequest): void {
+        this.#child.send(request);
+    }
+
+    /**
+     * Set the status of the following `messageSentHandler`, `null` to drop them.
+     */
+    messageSent(status: number | null): Promise<void> {
+        return new Promise((resolve) => {
+            const onMessage = (message: NcpStandInMessage): void => {
+                if (message.type === "messageSent") {
+                    this.#child.off("message", onMessage);
+                    resolve();
+                }
+            };
+
+            this.#child.on("message", onMessage);
+            this.request({ type: "messageSent", status });
+        });
+    }
+
+    stats(): Promise<NcpEmulatorStats> {
+        return new Promise((resolve) => {
+            const onMessage = (message: NcpStandInMessage): void => {
+                if (message.type === "stats") {
+                    this.#child.off("message", onMessage);
+                    resolve(message.stats);
+                }
+            };
+
+            this.#child.on("message", onMessage);
+            this.request({ type: "stats" });
+        });
+    }
+
+    close(): void {
+        this.#child.disconnect();
+    }
+}
+
+type EzspInitConfig = Parameters<EzspNative["init"]>[0];
+type EzspInitCallback = NonNullable<Parameters<EzspNative["init"]>[1]>;
+
+/** Binding and stand-in NCP of a `useNcpStandIn` suite, set by its `beforeAll` */
+export type NcpStandInStack = {
+    binding: EzspNative;
+    ncp: NcpStandIn;
+};
+
+/**
+ * Run the enclosing `describe` against a stand-in NCP, forked once: the binding is initialized (`TEST_ASH_CONFIG` and `config`)
+ * and started before each test, stopped after it with the stand-in's `messageSent` back to success.
+ * @param perTest false: started once for the whole suite
+ */
+export function useNcpStandIn(config: Partial<EzspInitConfig> = {}, callback: EzspInitCallback = () => {}, perTest = true): NcpStandInStack {
+    const stack = {} as NcpStandInStack;
+
+    const start = async (): Promise<void> => {
+        stack.binding.init({ ...TEST_ASH_CONFIG, ...config, serialPort: stack.ncp.path }, callback);
+        expect(await stack.binding.async.start()).toStrictEqual(0);
+    };
+
+    const stop = async (): Promise<void> => {
+        stack.binding.stop();
+        await stack.ncp.messageSent(0);
+    };
+
+    beforeAll(async () => {
+        stack.binding = (await import("../src/index.js")).default;
+        stack.ncp = await NcpStandIn.fork();
+
+        if (!perTest) {
+            await start();
+        }
+    });
+
+    afterAll(async () => {
+        if (!perTest) {
+            await stop();
+        }
+
+        stack.ncp.close();
+    });
+
+    if (perTest) {
+        beforeEach(start);
+        afterEach(stop);
+    }
+
+    return stack;
+}
@@ -1,24 +1,15 @@
-import { beforeAll, describe, expect, it, vi } from "vitest";
-import type { EzspNative } from "../src/index.js";
+import { mkdtempSync, readFileSync } from "node:fs";
+import { tmpdir } from "node:os";
+import { join } from "node:path";
+import { afterEach, beforeAll, describe, expect, it, vi } from "vitest";
+import { EZSP_CAPTURE_FILE_HEADER_SIZE, type EzspNative, readCapture } from "../src/index.js";
+import { TEST_ASH_CONFIG } from "./fixtures.js";
 
-const TEST_ASH_CONFIG = {
+/** Not a real port, full debug traces */
+const MOCK_ASH_CONFIG = {
+    ...TEST_ASH_CONFIG,
     serialPort: "/dev/ttyMock",
-    baudRate: 115200,
-    stopBits: 1 as const,
-    rtsCts: false,
-    outBlockLen: 256,
-    inBlockLen: 256,
-    traceFlags: /*1 | 2 |*/ 4 | 8 | 16, // full debug
-    txK: 3,
-    randomize: true,
-    ackTimeInit: 800,
-    ackTimeMin: 400,
-    ackTimeMax: 2400,
-    timeRst: 5000,
-    nrLowLimit: 8,
-    nrHighLimit: 12,
-    nrTime: 480,
-    resetMethod: 0 as const,
+    traceFlags: /*1 | 2 |*/ 4 | 8 | 16,
 };
 
 describe("EZSP Native Binding", () => {
@@ -37,6 +28,22 @@ describe("EZSP Native Binding", () => {
         expect(typeof binding.init).toStrictEqual("function");
         expect(typeof binding.start).toStrictEqual("function");
         expect(typeof binding.stop).toStrictEqual("function");
+        expect(typeof binding.getTickStats).toStrictEqual("function");
+        expect(typeof binding.getPayloadPoolStats).toStrictEqual("function");
+        expect(typeof binding.getCongestionStats).toStrictEqual("function");
+        expect(typeof binding.getCommandStats).toStrictEqual("function");
+        expect(typeof binding.getAshStats).toStrictEqual("function");
+        expect(typeof binding.startCapture).toStrictEqual("function");
+        expect(typeof binding.stopCapture).toStrictEqual("function");
+        expect(typeof binding.getCaptureStats).toStrictEqual("function");
+        expect(typeof binding.getLoopStats).toStrictEqual("function");
+        expect(typeof binding.setMessageFilters).toStrictEqual("function");
+        expect(typeof binding.getMessageFilterStats).toStrictEqual("function");
+        expect(typeof binding.getDuplicateStats).toStrictEqual("function");
+        expect(typeof binding.getGpDedupTable).toStrictEqual("function");
+        expect(typeof binding.getReportCoalescingStats).toStrictEqual("function");
+        expect(typeof binding.openPseudoTerminal).toStrictEqual("function");
+        expect(typeof binding.sendTracked).toStrictEqual("function");
         expect(typeof binding.ezspVersion).toStrictEqual("function");
         expect(typeof binding.ezspGetEui64).toStrictEqual("function");
         expect(typeof binding.ezspGetNetworkParameters).toStrictEqual("function");
@@ -84,6 +91,333 @@ describe("EZSP Native Binding", () => {
         expect(typeof binding.ezspGetEndpointFlags).toStrictEqual("function");
         expect(typeof binding.ezspGetVersionStruct).toStrictEqual("function");
         expect(typeof binding.send).toStrictEqual("function");
+        expect(typeof binding.sendBatch).toStrictEqual("function");
+    });
+
+    it("has async variants of all commands", () => {
+        expect(typeof binding.async).toStrictEqual("object");
+
+        for (const name of Object.keys(binding.async)) {
+            expect(typeof binding[name as keyof typeof binding.async]).toStrictEqual("function");
+            expect(typeof binding.async[name as keyof typeof binding.async]).toStrictEqual("function");
+        }
+
+        expect(typeof binding.async.start).toStrictEqual("function");
+        expect(typeof binding.async.ezspVersion).toStrictEqual("function");
+        expect(typeof binding.async.send).toStrictEqual("function");
+        expect(typeof binding.async.sendBatch).toStrictEqual("function");
+        // not commands
+        expect("sendTracked" in binding.async).toStrictEqual(false);
+        expect("init" in binding.async).toStrictEqual(false);
+        expect("stop" in binding.async).toStrictEqual(false);
+        expect("getTickStats" in binding.async).toStrictEqual(false);
+    });
+
+    describe("async", () => {
+        it("throws synchronously on invalid arguments", () => {
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.async.ezspVersion("invalid" as any);
+            }).toThrow();
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.async.ezspSetPolicy(undefined as any, undefined as any);
+            }).toThrow();
+        });
+    });
+
+    describe("getTickStats", () => {
+        it("returns counters", () => {
+            expect(binding.getTickStats()).toStrictEqual({ wakeups: 0, pollWakeups: 0, timerWakeups: 0, ticks: 0 });
+        });
+    });
+
+    describe("getPayloadPoolStats", () => {
+        it("returns counters", () => {
+            expect(binding.getPayloadPoolStats()).toStrictEqual({ slabAllocations: 0, slabFrees: 0, slots: 0, acquired: 0, released: 0, inUse: 0 });
+        });
+    });
+
+    describe("getDuplicateStats", () => {
+        it("returns window and counters", () => {
+            binding.init({ ...MOCK_ASH_CONFIG, duplicateWindow: 2000 });
+
+            expect(binding.getDuplicateStats()).toStrictEqual({ window: 2000, checked: 0, duplicates: 0, evictions: 0 });
+
+            binding.init(MOCK_ASH_CONFIG);
+
+            expect(binding.getDuplicateStats().window).toStrictEqual(0);
+        });
+
+        it("rejects invalid duplicateWindow option", () => {
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, duplicateWindow: "2000" as any });
+            }).toThrow();
+
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, duplicateWindow: -1 });
+            }).toThrow();
+        });
+    });
+
+    describe("getGpDedupTable", () => {
+        it("returns an empty table after init", () => {
+            binding.init({ ...MOCK_ASH_CONFIG, gpDuplicateWindow: 500 });
+
+            expect(binding.getGpDedupTable()).toStrictEqual([]);
+
+            binding.init(MOCK_ASH_CONFIG);
+        });
+
+        it("rejects invalid gpDuplicateWindow option", () => {
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, gpDuplicateWindow: true as any });
+            }).toThrow();
+
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, gpDuplicateWindow: -1 });
+            }).toThrow();
+        });
+    });
+
+    describe("getReportCoalescingStats", () => {
+        it("returns state and counters", () => {
+            binding.init({ ...MOCK_ASH_CONFIG, reportCoalescing: { interval: 1000 } });
+
+            expect(binding.getReportCoalescingStats()).toStrictEqual({
+                enabled: true,
+                interval: 1000,
+                sources: 0,
+                heldSources: 0,
+                passed: 0,
+                held: 0,
+                replaced: 0,
+                flushed: 0,
+                unparsed: 0,
+                overflows: 0,
+            });
+
+            binding.init(MOCK_ASH_CONFIG);
+
+            expect(binding.getReportCoalescingStats().enabled).toStrictEqual(false);
+        });
+
+        it("rejects invalid reportCoalescing option", () => {
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, reportCoalescing: 1000 as any });
+            }).toThrow();
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, reportCoalescing: {} as any });
+            }).toThrow();
+
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, reportCoalescing: { interval: 1000, maxSources: 0 } });
+            }).toThrow();
+        });
+    });
+
+    describe("getCongestionStats", () => {
+        it("returns state and counters", () => {
+            binding.init({ ...MOCK_ASH_CONFIG, congestionControl: { maxWindow: 4 } });
+
+            expect(binding.getCongestionStats()).toStrictEqual({
+                enabled: true,
+                window: 4,
+                inFlight: 0,
+                queued: 0,
+                queuedByPriority: [0, 0, 0],
+                admitted: 0,
+                deferred: 0,
+                dropped: 0,
+                overflowErrors: 0,
+                queueFullErrors: 0,
+                decreases: 0,
+            });
+
+            binding.init(MOCK_ASH_CONFIG);
+
+            expect(binding.getCongestionStats().enabled).toStrictEqual(false);
+        });
+    });
+
+    describe("getCommandStats", () => {
+        it("returns per frame ID stats", () => {
+            // no command reached the NCP
+            expect(binding.getCommandStats(true)).toStrictEqual([]);
+            expect(binding.getCommandStats()).toStrictEqual([]);
+        });
+
+        it("rejects invalid arguments", () => {
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.getCommandStats("true" as any);
+            }).toThrow();
+        });
+    });
+
+    describe("getAshStats", () => {
+        it("returns link counters", () => {
+            const stats = binding.getAshStats();
+
+            expect(stats.connected).toStrictEqual(false);
+            expect(stats.txAllFrames).toStrictEqual(0);
+            expect(stats.rxCrcErrors).toStrictEqual(0);
+            expect(stats.rxOutOfSequence).toStrictEqual(0);
+            expect(typeof stats.ackPeriod).toStrictEqual("number");
+            expect(Object.keys(stats).length).toStrictEqual(37);
+        });
+    });
+
+    describe("startCapture", () => {
+        afterEach(() => {
+            binding.stopCapture();
+        });
+
+        it("writes the file header", () => {
+            const path = join(mkdtempSync(join(tmpdir(), "ezsp-")), "capture.bin");
+
+            binding.startCapture(path, 100000);
+
+            const stats = binding.getCaptureStats();
+
+            expect(stats.active).toStrictEqual(true);
+            expect(stats.path).toStrictEqual(path);
+            expect(stats.bufferSize).toStrictEqual(131072);
+            expect(() => {
+                binding.startCapture(path);
+            }).toThrow();
+
+            expect(binding.stopCapture()).toMatchObject({ active: false, records: 0, dropped: 0, written: EZSP_CAPTURE_FILE_HEADER_SIZE });
+            expect(readCapture(readFileSync(path)).records).toStrictEqual([]);
+        });
+
+        it("rejects invalid arguments", () => {
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.startCapture(1 as any);
+            }).toThrow();
+            expect(() => {
+                binding.startCapture("/tmp/capture.bin", 1024);
+            }).toThrow(RangeError);
+            expect(() => {
+                binding.startCapture("/nonexistent/capture.bin");
+            }).toThrow();
+            expect(binding.getCaptureStats().active).toStrictEqual(false);
+        });
+    });
+
+    describe("getLoopStats", () => {
+        it("returns empty histograms after reset", () => {
+            binding.getLoopStats(true);
+
+            const stats = binding.getLoopStats();
+
+            expect(stats.tick.count).toStrictEqual(0);
+            expect(stats.dispatch.buckets).toStrictEqual([]);
+            expect(stats.worstStall.source).toStrictEqual("none");
+            expect(stats.elapsed).toBeGreaterThanOrEqual(0);
+        });
+
+        it("rejects invalid arguments", () => {
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.getLoopStats(1 as any);
+            }).toThrow();
+        });
+    });
+
+    describe("setMessageFilters", () => {
+        afterEach(() => {
+            binding.setMessageFilters([]);
+        });
+
+        it("sets filters with zeroed counters", () => {
+            binding.setMessageFilters([
+                { profileId: 0x0104, clusterId: 0x0006, action: "accept" },
+                { sender: 0x1234 },
+                { frameType: 0, commandId: 0x0a },
+                {},
+            ]);
+
+            expect(binding.getMessageFilterStats()).toStrictEqual([0, 0, 0, 0]);
+            expect(binding.getMessageFilterStats(true)).toStrictEqual([0, 0, 0, 0]);
+
+            binding.setMessageFilters([]);
+
+            expect(binding.getMessageFilterStats()).toStrictEqual([]);
+        });
+
+        it("rejects invalid filters", () => {
+            // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+            expect(() => binding.setMessageFilters(undefined as any)).toThrow();
+            // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+            expect(() => binding.setMessageFilters([1 as any])).toThrow();
+            expect(() => binding.setMessageFilters([{ clusterId: 0x10000 }])).toThrow();
+            expect(() => binding.setMessageFilters([{ sourceEndpoint: -1 }])).toThrow();
+            // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+            expect(() => binding.setMessageFilters([{ frameType: 2 as any }])).toThrow();
+            // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+            expect(() => binding.setMessageFilters([{ action: "reject" as any }])).toThrow();
+            // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+            expect(() => binding.getMessageFilterStats("true" as any)).toThrow();
+        });
+    });
+
+    describe("benchEventDispatch", () => {
+        it("rejects invalid arguments", (context) => {
+            // bench builds only
+            context.skip(!binding.benchEventDispatch);
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.benchEventDispatch!("1" as any, true);
+            }).toThrow();
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.benchEventDispatch!(1, undefined as any);
+            }).toThrow();
+        });
+    });
+
+    describe("sendTracked", () => {
+        it("rejects invalid arguments", () => {
+            const apsFrame = {
+                profileId: 0x0104,
+                clusterId: 0x0006,
+                sourceEndpoint: 1,
+                destinationEndpoint: 1,
+                options: 0,
+                groupId: 0,
+                sequence: 0,
+                radius: 0,
+            };
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.sendTracked("0" as any, 0x1234, apsFrame, Buffer.alloc(1), 0, 0);
+            }).toThrow();
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.sendTracked(0, 0x1234, {} as any, Buffer.alloc(1), 0, 0);
+            }).toThrow();
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.sendTracked(0, 0x1234, apsFrame, Buffer.alloc(1), 0, 0, "1000" as any);
+            }).toThrow();
+
+            expect(() => {
+                binding.sendTracked(0, 0x1234, apsFrame, Buffer.alloc(1), 0, 0, 0);
+            }).toThrow();
+        });
     });
 
     describe("init", () => {
@@ -91,13 +425,13 @@ describe("EZSP Native Binding", () => {
             const mockCallback = vi.fn();
 
             expect(() => {
-                binding.init(TEST_ASH_CONFIG, mockCallback);
+                binding.init(MOCK_ASH_CONFIG, mockCallback);
             }).not.toThrow();
         });
 
         it("works without a callback in init", () => {
             expect(() => {
-                binding.init(TEST_ASH_CONFIG);
+                binding.init(MOCK_ASH_CONFIG);
             }).not.toThrow();
         });
 
@@ -131,16 +465,177 @@ describe("EZSP Native Binding", () => {
 
             expect(() => {
                 binding.init({
-                    ...TEST_ASH_CONFIG,
+                    ...MOCK_ASH_CONFIG,
                     serialPort: "a".repeat(50), // Max is 39
                 });
             }).toThrow();
         });
 
+        it("accepts ioThread option", () => {
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, ioThread: true });
+            }).not.toThrow();
+
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, ioThread: false });
+            }).not.toThrow();
+        });
+
+        it("rejects invalid ioThread option", () => {
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, ioThread: "true" as any });
+            }).toThrow();
+        });
+
+        it("accepts eventDriven option", () => {
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, eventDriven: true });
+            }).not.toThrow();
+        });
+
+        it("rejects invalid eventDriven option", () => {
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, eventDriven: 1 as any });
+            }).toThrow();
+        });
+
+        it("accepts binaryEvents option", () => {
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, binaryEvents: true });
+            }).not.toThrow();
+        });
+
+        it("rejects invalid binaryEvents option", () => {
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, binaryEvents: "true" as any });
+            }).toThrow();
+        });
+
+        it("accepts eventBatch option", () => {
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, eventBatch: {} });
+            }).not.toThrow();
+
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, eventBatch: { maxSize: 16, maxDelay: 5 } });
+            }).not.toThrow();
+        });
+
+        it("rejects invalid eventBatch option", () => {
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, eventBatch: true as any });
+            }).toThrow();
+
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, eventBatch: { maxSize: 0 } });
+            }).toThrow();
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, eventBatch: { maxDelay: "5" as any } });
+            }).toThrow();
+        });
+
+        it("accepts deliveryTimeout option", () => {
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, deliveryTimeout: 5000 });
+            }).not.toThrow();
+        });
+
+        it("rejects invalid deliveryTimeout option", () => {
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, deliveryTimeout: 0 });
+            }).toThrow();
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, deliveryTimeout: "5000" as any });
+            }).toThrow();
+        });
+
+        it("accepts congestionControl option", () => {
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, congestionControl: {} });
+            }).not.toThrow();
+
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, congestionControl: { minWindow: 2, maxWindow: 16, maxQueued: 0 } });
+            }).not.toThrow();
+
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, congestionControl: { quotas: [8, 4, 1], bulkClusters: [0x0019, 0x0300] } });
+            }).not.toThrow();
+        });
+
+        it("rejects invalid congestionControl option", () => {
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, congestionControl: true as any });
+            }).toThrow();
+
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, congestionControl: { minWindow: 0 } });
+            }).toThrow();
+
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, congestionControl: { minWindow: 8, maxWindow: 4 } });
+            }).toThrow();
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, congestionControl: { maxQueued: "1" as any } });
+            }).toThrow();
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, congestionControl: { quotas: [1, 1] as any } });
+            }).toThrow();
+
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, congestionControl: { quotas: [1, 0, 1] } });
+            }).toThrow();
+
+            expect(() => {
+                // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                binding.init({ ...MOCK_ASH_CONFIG, congestionControl: { bulkClusters: ["0x0019"] as any } });
+            }).toThrow();
+
+            for (const congestionControl of [
+                { minWindow: -1, maxWindow: -1 },
+                { maxWindow: 1.5 },
+                { maxWindow: 256 },
+                { maxQueued: -1 },
+                { maxQueued: 0x10000 },
+                { quotas: [-1, 1, 1] },
+                { quotas: [1, Number.NaN, 1] },
+                { bulkClusters: [0x10000] },
+                { bulkClusters: [-1] },
+            ]) {
+                expect(() => {
+                    // biome-ignore lint/suspicious/noExplicitAny: test invalid input
+                    binding.init({ ...MOCK_ASH_CONFIG, congestionControl: congestionControl as any });
+                }).toThrow();
+            }
+        });
+
+        it("keeps congestionControl settings on invalid option", () => {
+            binding.init({ ...MOCK_ASH_CONFIG, congestionControl: { maxWindow: 4 } });
+
+            expect(() => {
+                binding.init({ ...MOCK_ASH_CONFIG, congestionControl: { maxWindow: 2, maxQueued: -1 } });
+            }).toThrow();
+
+            expect(binding.getCongestionStats()).toMatchObject({ enabled: true, window: 4 });
+        });
+
         it("throws if callback is not a function", () => {
             expect(() => {
                 // biome-ignore lint/suspicious/noExplicitAny: test invalid input
-                binding.init(TEST_ASH_CONFIG, "not a function" as any);
+                binding.init(MOCK_ASH_CONFIG, "not a function" as any);
             }).toThrow();
         });
     });
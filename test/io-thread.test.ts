@@ -0,0 +1,61 @@
+import { performance } from "node:perf_hooks";
+import { describe, expect, it, vi } from "vitest";
+import type { EzspNativeEvent } from "../src/index.js";
+import { useNcpStandIn } from "./fixtures.js";
+
+/**
+ * Busy the JS thread, as a long synchronous task in the application would.
+ */
+function block(ms: number): void {
+    const until = performance.now() + ms;
+
+    while (performance.now() < until) {
+        // spin
+    }
+}
+
+describe("I/O thread", () => {
+    const events: EzspNativeEvent[] = [];
+    const stack = useNcpStandIn(
+        { ioThread: true },
+        (event: EzspNativeEvent) => {
+            events.push(event);
+        },
+        false,
+    );
+
+    it("runs sync and async commands", async () => {
+        expect(stack.binding.ezspVersion(13)[0]).toStrictEqual(13);
+        expect((await stack.binding.async.ezspVersion(13))[0]).toStrictEqual(13);
+    });
+
+    it("keeps the ASH link serviced while the JS thread is blocked", async () => {
+        const before = await stack.ncp.stats();
+
+        events.length = 0;
+
+        stack.ncp.request({ type: "flood", count: 50 });
+        // longer than the NCP ack timeout (400ms): any frame left unacked meanwhile would be retransmitted
+        block(1000);
+
+        await vi.waitFor(() => {
+            expect(events.filter((event) => event.name === "incomingMessage").length).toStrictEqual(50);
+        });
+
+        const after = await stack.ncp.stats();
+
+        expect(after.callbacks - before.callbacks).toStrictEqual(50);
+        expect(after.txRetransmits).toStrictEqual(before.txRetransmits);
+    });
+
+    it("sleeps while the link is idle", async () => {
+        const before = stack.binding.getTickStats();
+
+        await new Promise((resolve) => setTimeout(resolve, 500));
+
+        const after = stack.binding.getTickStats();
+
+        // woken by ASH deadlines only (`nrTime`), not every 1ms
+        expect(after.wakeups - before.wakeups).toBeLessThan(20);
+    });
+});
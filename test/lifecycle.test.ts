@@ -1,5 +1,7 @@
-import { beforeAll, describe, expect, it } from "vitest";
+import { afterEach, beforeAll, describe, expect, it } from "vitest";
 import type { EzspNative } from "../src/index.js";
+import { TEST_ASH_CONFIG } from "./fixtures.js";
+import { NcpEmulator } from "./ncp-emulator.js";
 
 describe("EZSP Lifecycle", () => {
     let binding: EzspNative;
@@ -16,7 +18,39 @@ describe("EZSP Lifecycle", () => {
         });
     });
 
-    describe.skip("stop", () => {
-        // TODO: mock hardware
+    describe("stop", () => {
+        let emulator: NcpEmulator | undefined;
+
+        afterEach(() => {
+            binding.stop();
+            emulator?.close();
+            emulator = undefined;
+        });
+
+        it("stops a started stack", async () => {
+            emulator = NcpEmulator.open(binding);
+
+            binding.init({ ...TEST_ASH_CONFIG, serialPort: emulator.path }, () => {});
+            expect(await binding.async.start()).toStrictEqual(0);
+
+            expect(() => {
+                binding.stop();
+            }).not.toThrow();
+            expect(() => {
+                binding.start();
+            }).toThrow();
+        });
+
+        it("restarts after stop", async () => {
+            emulator = NcpEmulator.open(binding);
+
+            for (let i = 0; i < 2; i++) {
+                binding.init({ ...TEST_ASH_CONFIG, serialPort: emulator.path }, () => {});
+                expect(await binding.async.start()).toStrictEqual(0);
+                binding.stop();
+            }
+
+            expect(emulator.stats.resets).toStrictEqual(2);
+        });
     });
 });
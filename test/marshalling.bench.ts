@@ -0,0 +1,27 @@
+import { bench, describe } from "vitest";
+
+/** events per iteration, time per event = iteration time / EVENTS */
+const EVENTS = 1000;
+
+// `bench*` exports: `npm run build:gyp:bench`
+const binding = (await import("../src/index.js")).default;
+
+describe.skipIf(!binding.benchEventMarshalling)("Event marshalling", () => {
+    bench("incremental Set (before)", () => {
+        binding.benchEventMarshalling!(EVENTS, false);
+    });
+
+    bench("cached keys + DefineProperties (after)", () => {
+        binding.benchEventMarshalling!(EVENTS, true);
+    });
+});
+
+describe.skipIf(!binding.benchApsFrame)("APS frame marshalling", () => {
+    bench("ApsFrameToObject", () => {
+        binding.benchApsFrame!(EVENTS, true);
+    });
+
+    bench("ApsFrameFromObject", () => {
+        binding.benchApsFrame!(EVENTS, false);
+    });
+});
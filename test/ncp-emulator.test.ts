@@ -0,0 +1,144 @@
+import { mkdtempSync, readFileSync } from "node:fs";
+import { tmpdir } from "node:os";
+import { join } from "node:path";
+import { afterEach, beforeAll, describe, expect, it } from "vitest";
+import { type EzspNative, readCapture } from "../src/index.js";
+import { TEST_ASH_CONFIG } from "./fixtures.js";
+import {
+    ASH_CANCEL,
+    ASH_CONTROL_RST,
+    ASH_CONTROL_RSTACK,
+    ASH_FLAG,
+    ASH_RESET_SOFTWARE,
+    AshDecoder,
+    ashCrc,
+    ashEncode,
+    ashRandomize,
+    EZSP_ECHO,
+    EZSP_VERSION,
+    NcpEmulator,
+    parseEzspCommand,
+} from "./ncp-emulator.js";
+
+describe("ASH framing", () => {
+    // UG101 examples
+    it("encodes RST and RSTACK", () => {
+        expect(ashEncode(ASH_CONTROL_RST)).toStrictEqual(Buffer.from([0xc0, 0x38, 0xbc, 0x7e]));
+        expect(ashEncode(0xc1, Buffer.from([0x02, 0x02]))).toStrictEqual(Buffer.from([0xc1, 0x02, 0x02, 0x9b, 0x7b, 0x7e]));
+        expect(ashCrc(Buffer.from([0x81]))).toStrictEqual(0x6059);
+    });
+
+    it("randomizes with the ASH sequence", () => {
+        expect(ashRandomize(Buffer.alloc(6))).toStrictEqual(Buffer.from([0x42, 0x21, 0xa8, 0x54, 0x2a, 0x15]));
+        expect(ashRandomize(ashRandomize(Buffer.from([1, 2, 3])))).toStrictEqual(Buffer.from([1, 2, 3]));
+    });
+
+    it("stuffs reserved bytes", () => {
+        const data = Buffer.from([0x7e, 0x7d, 0x11, 0x13, 0x18, 0x1a, 0x00]);
+        const encoded = ashEncode(0x25, data);
+
+        expect(encoded.subarray(1, encoded.length - 1).includes(0x7e)).toStrictEqual(false);
+        expect(new AshDecoder().push(encoded)).toStrictEqual([{ control: 0x25, data, valid: true }]);
+    });
+
+    it("decodes across chunks, drops cancelled and flags corrupted frames", () => {
+        const decoder = new AshDecoder();
+        const rst = ashEncode(ASH_CONTROL_RST);
+
+        expect(decoder.push(Buffer.from([0x12, 0x34, ASH_CANCEL, ...rst.subarray(0, 2)]))).toStrictEqual([]);
+        expect(decoder.push(rst.subarray(2))).toStrictEqual([{ control: ASH_CONTROL_RST, data: Buffer.alloc(0), valid: true }]);
+
+        const corrupted = Buffer.from(rst);
+        corrupted[1] ^= 0x01;
+
+        expect(decoder.push(corrupted)[0].valid).toStrictEqual(false);
+    });
+
+    it("parses legacy and extended EZSP frames", () => {
+        expect(parseEzspCommand(Buffer.from([0x00, 0x00, 0x00, 0x0d]))).toStrictEqual({
+            sequence: 0,
+            frameControl: 0,
+            frameId: EZSP_VERSION,
+            extended: false,
+            parameters: Buffer.from([0x0d]),
+        });
+        expect(parseEzspCommand(Buffer.from([0x05, 0x00, 0x01, 0x81, 0x00, 0x01, 0xaa]))).toStrictEqual({
+            sequence: 5,
+            frameControl: 0,
+            frameId: EZSP_ECHO,
+            extended: true,
+            parameters: Buffer.from([0x01, 0xaa]),
+        });
+    });
+});
+
+describe("NCP emulator", () => {
+    let binding: EzspNative;
+    let emulator: NcpEmulator | undefined;
+
+    beforeAll(async () => {
+        binding = (await import("../src/index.js")).default;
+    });
+
+    afterEach(() => {
+        binding.stop();
+        emulator?.close();
+        emulator = undefined;
+    });
+
+    const start = async (options?: Parameters<typeof NcpEmulator.open>[1]): Promise<NcpEmulator> => {
+        emulator = NcpEmulator.open(binding, options);
+
+        binding.init({ ...TEST_ASH_CONFIG, serialPort: emulator.path }, () => {});
+        expect(await binding.async.start()).toStrictEqual(0);
+
+        return emulator;
+    };
+
+    it("resets the NCP and answers version", async () => {
+        const ncp = await start({ stackVersion: 0x8200 });
+
+        expect(ncp.connected).toStrictEqual(true);
+        expect(ncp.stats.resets).toStrictEqual(1);
+        expect(await binding.async.ezspVersion(13)).toStrictEqual([13, 2, 0x8200]);
+        expect(ncp.commands.at(-1)?.frameId).toStrictEqual(EZSP_VERSION);
+    });
+
+    it("recovers from NAKed frames", async () => {
+        const ncp = await start({ nakEvery: 2 });
+
+        for (let i = 0; i < 8; i++) {
+            expect((await binding.async.ezspVersion(13))[0]).toStrictEqual(13);
+        }
+
+        expect(ncp.stats.txNaks).toBeGreaterThan(0);
+        expect(ncp.stats.commands).toStrictEqual(8);
+        expect(binding.getAshStats().txReDataFrames).toBeGreaterThan(0);
+    });
+
+    it("captures frames in both directions", async () => {
+        const path = join(mkdtempSync(join(tmpdir(), "ezsp-")), "capture.bin");
+
+        binding.startCapture(path);
+
+        await start();
+        await binding.async.ezspVersion(13);
+
+        const stats = binding.stopCapture();
+        const capture = readCapture(readFileSync(path));
+        const hostToNcp = capture.records.filter((record) => record.direction === "hostToNcp");
+        const ncpToHost = capture.records.filter((record) => record.direction === "ncpToHost");
+
+        expect(stats.dropped).toStrictEqual(0);
+        expect(stats.records).toStrictEqual(capture.records.length);
+        // records end on Flag or Cancel (sent ahead of RST to discard any partial frame)
+        expect(hostToNcp.every((record) => record.frame.at(-1) === ASH_FLAG || record.frame.at(-1) === ASH_CANCEL)).toStrictEqual(true);
+        // RST, RSTACK
+        expect(hostToNcp.find((record) => record.frame.at(-1) === ASH_FLAG)!.frame).toStrictEqual(ashEncode(ASH_CONTROL_RST));
+        expect(ncpToHost[0].frame).toStrictEqual(ashEncode(ASH_CONTROL_RSTACK, Buffer.from([0x02, ASH_RESET_SOFTWARE])));
+        // version command and response
+        expect(hostToNcp.some((record) => (record.frame[0] & 0x80) === 0)).toStrictEqual(true);
+        expect(ncpToHost.some((record) => (record.frame[0] & 0x80) === 0)).toStrictEqual(true);
+        expect(capture.records.every((record, i) => i === 0 || record.time >= capture.records[i - 1].time)).toStrictEqual(true);
+    });
+});
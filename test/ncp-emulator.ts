@@ -0,0 +1,710 @@
+/**
+ * NCP emulator on a pseudo-terminal: ASH framing (UG101) and a scriptable EZSP responder,
+ * so `init({ serialPort: emulator.path })` drives the real SDK host stack without hardware.
+ *
+ * Runs on the JS thread, so the host must be driven through `binding.async` (`start` included),
+ * a synchronous command would block the loop the emulator answers from.
+ */
+
+import fs from "node:fs";
+import tty from "node:tty";
+import type { EzspNative } from "../src/index.js";
+
+// #region ASH framing
+
+export const ASH_FLAG = 0x7e;
+export const ASH_ESCAPE = 0x7d;
+export const ASH_XON = 0x11;
+export const ASH_XOFF = 0x13;
+export const ASH_SUBSTITUTE = 0x18;
+export const ASH_CANCEL = 0x1a;
+/** XOR applied to an escaped byte */
+const ASH_FLIP = 0x20;
+
+export const ASH_CONTROL_RST = 0xc0;
+export const ASH_CONTROL_RSTACK = 0xc1;
+export const ASH_CONTROL_ERROR = 0xc2;
+const ASH_CONTROL_ACK = 0x80;
+const ASH_CONTROL_NAK = 0xa0;
+/** distinguishes ACK/NAK (top 3 bits) */
+const ASH_CONTROL_ACK_NAK_MASK = 0xe0;
+const ASH_CONTROL_NOT_READY = 0x08;
+const ASH_CONTROL_RETRANSMIT = 0x08;
+
+const ASH_VERSION = 2;
+/** `RESET_SOFTWARE` */
+export const ASH_RESET_SOFTWARE = 0x0b;
+/** frame numbers are modulo 8 */
+const ASH_FRAME_NUMBER_MASK = 0x07;
+/** consecutive ACK timeouts before giving up on the host (disconnect, until next RST) */
+const ASH_MAX_ACK_TIMEOUTS = 4;
+
+/**
+ * CRC-CCITT (0x1021, initial 0xFFFF), over control and data fields
+ */
+export function ashCrc(data: Uint8Array): number {
+    let crc = 0xffff;
+
+    for (const byte of data) {
+        crc ^= byte << 8;
+
+        for (let i = 0; i < 8; i++) {
+            crc = crc & 0x8000 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * XOR DATA frame data field with the ASH pseudo-random sequence, in place (randomizing twice restores it).
+ */
+export function ashRandomize(data: Buffer): Buffer {
+    let rand = 0x42;
+
+    for (let i = 0; i < data.length; i++) {
+        data[i] ^= rand;
+        rand = rand & 1 ? (rand >> 1) ^ 0xb8 : rand >> 1;
+    }
+
+    return data;
+}
+
+function isReservedByte(byte: number): boolean {
+    return byte === ASH_FLAG || byte === ASH_ESCAPE || byte === ASH_XON || byte === ASH_XOFF || byte === ASH_SUBSTITUTE || byte === ASH_CANCEL;
+}
+
+/**
+ * Build a complete frame: control, data, CRC, byte stuffing, flag.
+ * @param data DATA frame data field is expected already randomized
+ */
+export function ashEncode(control: number, data: Uint8Array = Buffer.alloc(0)): Buffer {
+    const raw = Buffer.alloc(data.length + 3);
+    raw[0] = control;
+    raw.set(data, 1);
+    raw.writeUInt16BE(ashCrc(raw.subarray(0, data.length + 1)), data.length + 1);
+
+    const out: number[] = [];
+
+    for (const byte of raw) {
+        if (isReservedByte(byte)) {
+            out.push(ASH_ESCAPE, byte ^ ASH_FLIP);
+        } else {
+            out.push(byte);
+        }
+    }
+
+    out.push(ASH_FLAG);
+
+    return Buffer.from(out);
+}
+
+export type AshFrame = {
+    control: number;
+    data: Buffer;
+    /** false on CRC error, substitute byte or too short, `control` and `data` are then meaningless */
+    valid: boolean;
+};
+
+/**
+ * Incremental frame decoder, byte stuffing undone, flow control bytes dropped.
+ */
+export class AshDecoder {
+    #buffer: number[] = [];
+    #escaped = false;
+    #corrupted = false;
+
+    push(chunk: Uint8Array): AshFrame[] {
+        const frames: AshFrame[] = [];
+
+        for (const byte of chunk) {
+            switch (byte) {
+                case ASH_FLAG: {
+                    if (this.#buffer.length > 0 || this.#corrupted) {
+                        frames.push(this.#frame());
+                    }
+
+                    this.#reset();
+                    break;
+                }
+                case ASH_CANCEL: {
+                    this.#reset();
+                    break;
+                }
+                case ASH_SUBSTITUTE: {
+                    this.#corrupted = true;
+                    break;
+                }
+                case ASH_XON:
+                case ASH_XOFF: {
+                    break;
+                }
+                case ASH_ESCAPE: {
+                    this.#escaped = true;
+                    break;
+                }
+                default: {
+                    this.#buffer.push(this.#escaped ? byte ^ ASH_FLIP : byte);
+                    this.#escaped = false;
+                }
+            }
+        }
+
+        return frames;
+    }
+
+    #frame(): AshFrame {
+        const raw = Buffer.from(this.#buffer);
+
+        if (this.#corrupted || raw.length < 3 || ashCrc(raw.subarray(0, raw.length - 2)) !== raw.readUInt16BE(raw.length - 2)) {
+            return { control: 0, data: Buffer.alloc(0), valid: false };
+        }
+
+        return { control: raw[0], data: raw.subarray(1, raw.length - 2), valid: true };
+    }
+
+    #reset(): void {
+        this.#buffer = [];
+        this.#escaped = false;
+        this.#corrupted = false;
+    }
+}
+
+// #endregion ASH framing
+
+// #region EZSP
+
+export const EZSP_VERSION = 0x0000;
+export const EZSP_NOP = 0x0005;
+export const EZSP_INVALID_COMMAND = 0x0058;
+export const EZSP_ECHO = 0x0081;
+export const EZSP_STACK_STATUS_HANDLER = 0x0019;
+export const EZSP_SEND_UNICAST = 0x0034;
+export const EZSP_SEND_BROADCAST = 0x0036;
+export const EZSP_MESSAGE_SENT_HANDLER = 0x003f;
+export const EZSP_INCOMING_MESSAGE_HANDLER = 0x0045;
+/** serialized `sl_zigbee_aps_frame_t` (no radius) */
+export const EZSP_APS_FRAME_SIZE = 11;
+/** `invalidCommand` reason */
+const EZSP_ERROR_INVALID_FRAME_ID = 0x34;
+
+const EZSP_FRAME_CONTROL_RESPONSE = 0x80;
+const EZSP_FRAME_CONTROL_ASYNCH_CB = 0x10;
+const EZSP_FRAME_CONTROL_NETWORK_INDEX_MASK = 0x60;
+/** extended frame control high byte, frame format version 1 */
+const EZSP_EXTENDED_FRAME_FORMAT = 0x01;
+const EZSP_EXTENDED_FRAME_FORMAT_MASK = 0x03;
+
+export type EzspCommand = {
+    sequence: number;
+    /** low byte */
+    frameControl: number;
+    frameId: number;
+    /** false: legacy format (`version` before the host switched to extended frames) */
+    extended: boolean;
+    parameters: Buffer;
+};
+
+/**
+ * @returns Response parameters, `undefined` for none
+ */
+export type EzspResponder = (parameters: Buffer, command: EzspCommand) => Buffer | undefined;
+
+export function parseEzspCommand(frame: Buffer): EzspCommand | undefined {
+    if (frame.length < 3) {
+        return undefined;
+    }
+
+    const extended = frame.length >= 5 && (frame[2] & EZSP_EXTENDED_FRAME_FORMAT_MASK) === EZSP_EXTENDED_FRAME_FORMAT;
+
+    return {
+        sequence: frame[0],
+        frameControl: frame[1],
+        frameId: extended ? frame.readUInt16LE(3) : frame[2],
+        extended,
+        parameters: frame.subarray(extended ? 5 : 3),
+    };
+}
+
+function ezspHeader(sequence: number, frameControl: number, frameId: number, extended: boolean): Buffer {
+    if (!extended) {
+        return Buffer.from([sequence, frameControl, frameId]);
+    }
+
+    return Buffer.from([sequence, frameControl, EZSP_EXTENDED_FRAME_FORMAT, frameId & 0xff, frameId >> 8]);
+}
+
+export type EzspApsFrame = {
+    profileId: number;
+    clusterId: number;
+    sourceEndpoint: number;
+    destinationEndpoint: number;
+    options: number;
+    groupId: number;
+    sequence: number;
+};
+
+export function readEzspApsFrame(buffer: Buffer, offset = 0): EzspApsFrame {
+    return {
+        profileId: buffer.readUInt16LE(offset),
+        clusterId: buffer.readUInt16LE(offset + 2),
+        sourceEndpoint: buffer[offset + 4],
+        destinationEndpoint: buffer[offset + 5],
+        options: buffer.readUInt16LE(offset + 6),
+        groupId: buffer.readUInt16LE(offset + 8),
+        sequence: buffer[offset + 10],
+    };
+}
+
+export function writeEzspApsFrame(apsFrame: EzspApsFrame, buffer: Buffer = Buffer.alloc(EZSP_APS_FRAME_SIZE), offset = 0): Buffer {
+    buffer.writeUInt16LE(apsFrame.profileId, offset);
+    buffer.writeUInt16LE(apsFrame.clusterId, offset + 2);
+    buffer[offset + 4] = apsFrame.sourceEndpoint;
+    buffer[offset + 5] = apsFrame.destinationEndpoint;
+    buffer.writeUInt16LE(apsFrame.options, offset + 6);
+    buffer.writeUInt16LE(apsFrame.groupId, offset + 8);
+    buffer[offset + 10] = apsFrame.sequence;
+
+    return buffer;
+}
+
+// #endregion EZSP
+
+// #region Emulator
+
+export type NcpEmulatorOptions = {
+    /** `version` response, default echoes the desired protocol version */
+    protocolVersion?: number;
+    /** `version` response, default 2 (mesh) */
+    stackType?: number;
+    /** `version` response, default 0x8100 */
+    stackVersion?: number;
+    /** RSTACK reset code, default `ASH_RESET_SOFTWARE` */
+    resetCode?: number;
+    /** unacknowledged DATA frames the NCP sends ahead, 1-7, default 7 */
+    window?: number;
+    /** ms before retransmitting unacknowledged DATA frames, default 400 */
+    ackTimeout?: number;
+    /** ms before responding (ACK sent first), emulates NCP processing time, default 0 */
+    responseDelay?: number;
+    /** NAK every Nth valid DATA frame as if corrupted, to exercise host retransmission, default 0 (never) */
+    nakEvery?: number;
+    /** must match host config `randomize`, default true */
+    randomize?: boolean;
+};
+
+export type NcpEmulatorStats = {
+    /** RST received (RSTACK sent) */
+    resets: number;
+    rxFrames: number;
+    rxData: number;
+    rxInvalid: number;
+    rxDuplicates: number;
+    rxOutOfSequence: number;
+    rxNaks: number;
+    txData: number;
+    txAcks: number;
+    txNaks: number;
+    txRetransmits: number;
+    commands: number;
+    callbacks: number;
+};
+
+type CommandWaiter = {
+    frameId: number;
+    resolve: (command: EzspCommand) => void;
+    reject: (error: Error) => void;
+    timer: NodeJS.Timeout;
+};
+
+type UnackedFrame = {
+    frameNumber: number;
+    /** randomized EZSP frame */
+    data: Buffer;
+};
+
+export class NcpEmulator {
+    /** slave device, to use as `serialPort` */
+    readonly path: string;
+    readonly stats: NcpEmulatorStats = {
+        resets: 0,
+        rxFrames: 0,
+        rxData: 0,
+        rxInvalid: 0,
+        rxDuplicates: 0,
+        rxOutOfSequence: 0,
+        rxNaks: 0,
+        txData: 0,
+        txAcks: 0,
+        txNaks: 0,
+        txRetransmits: 0,
+        commands: 0,
+        callbacks: 0,
+    };
+    /** every EZSP command received, in order */
+    readonly commands: EzspCommand[] = [];
+
+    readonly #options: Required<Omit<NcpEmulatorOptions, "protocolVersion">> & Pick<NcpEmulatorOptions, "protocolVersion">;
+    readonly #socket: tty.ReadStream;
+    readonly #slave: number;
+    readonly #decoder = new AshDecoder();
+    readonly #responders = new Map<number, EzspResponder>();
+    readonly #waiters: CommandWaiter[] = [];
+    #connected = false;
+    /** host not ready for callbacks (nRdy) */
+    #hostNotReady = false;
+    /** next frame number expected from the host */
+    #rxAckNumber = 0;
+    /** next frame number to send */
+    #txFrameNumber = 0;
+    #unacked: UnackedFrame[] = [];
+    /** EZSP frames waiting for the window, responses ahead of callbacks */
+    #responses: Buffer[] = [];
+    #callbacks: Buffer[] = [];
+    #ackTimer: NodeJS.Timeout | undefined;
+    #ackTimeouts = 0;
+    #closed = false;
+
+    private constructor(binding: EzspNative, options: NcpEmulatorOptions) {
+        if (!binding.openPseudoTerminal) {
+            throw new Error("Pseudo-terminals are not available on this platform");
+        }
+
+        const pty = binding.openPseudoTerminal();
+
+        this.path = pty.path;
+        this.#slave = pty.slave;
+        this.#options = {
+            protocolVersion: options.protocolVersion,
+            stackType: options.stackType ?? 2,
+            stackVersion: options.stackVersion ?? 0x8100,
+            resetCode: options.resetCode ?? ASH_RESET_SOFTWARE,
+            window: Math.min(Math.max(options.window ?? 7, 1), 7),
+            ackTimeout: options.ackTimeout ?? 400,
+            responseDelay: options.responseDelay ?? 0,
+            nakEvery: options.nakEvery ?? 0,
+            randomize: options.randomize ?? true,
+        };
+        this.#socket = new tty.ReadStream(pty.master);
+        this.#socket.on("data", (chunk: Buffer) => this.#onData(chunk));
+        // EIO on close
+        this.#socket.on("error", () => {});
+
+        this.respond(EZSP_VERSION, (parameters) => {
+            const response = Buffer.alloc(4);
+            response[0] = this.#options.protocolVersion ?? parameters[0];
+            response[1] = this.#options.stackType;
+            response.writeUInt16LE(this.#options.stackVersion, 2);
+
+            return response;
+        });
+        this.respond(EZSP_NOP, () => undefined);
+        this.respond(EZSP_ECHO, (parameters) => parameters);
+    }
+
+    static open(binding: EzspNative, options: NcpEmulatorOptions = {}): NcpEmulator {
+        return new NcpEmulator(binding, options);
+    }
+
+    /** true between RST and `error`/`close` */
+    get connected(): boolean {
+        return this.#connected;
+    }
+
+    /**
+     * Script the response to a command, replacing any previous one. Unscripted commands get `invalidCommand`.
+     * @param responder Fixed response parameters, or function of the command parameters
+     */
+    respond(frameId: number, responder: EzspResponder | Buffer): this {
+        this.#responders.set(frameId, typeof responder === "function" ? responder : () => responder);
+
+        return this;
+    }
+
+    /**
+     * Send an asynchronous callback (held while the host is not ready).
+     */
+    callback(frameId: number, parameters: Buffer = Buffer.alloc(0)): void {
+        this.stats.callbacks++;
+        this.#callbacks.push(Buffer.concat([ezspHeader(0, EZSP_FRAME_CONTROL_RESPONSE | EZSP_FRAME_CONTROL_ASYNCH_CB, frameId, true), parameters]));
+        this.#flush();
+    }
+
+    /**
+     * Resolve on the next command with `frameId`.
+     */
+    nextCommand(frameId: number, timeout = 5000): Promise<EzspCommand> {
+        return new Promise((resolve, reject) => {
+            const waiter: CommandWaiter = {
+                frameId,
+                resolve,
+                reject,
+                timer: setTimeout(() => {
+                    this.#waiters.splice(this.#waiters.indexOf(waiter), 1);
+                    reject(new Error(`Timed out waiting for EZSP frame 0x${frameId.toString(16).padStart(4, "0")}`));
+                }, timeout),
+            };
+
+            this.#waiters.push(waiter);
+        });
+    }
+
+    /**
+     * Send an ERROR frame (NCP failure), the host has to reset to reconnect.
+     */
+    error(code: number): void {
+        this.#disconnect();
+        this.#write(ashEncode(ASH_CONTROL_ERROR, Buffer.from([ASH_VERSION, code])));
+    }
+
+    close(): void {
+        if (this.#closed) {
+            return;
+        }
+
+        this.#closed = true;
+
+        this.#disconnect();
+        this.#socket.destroy();
+        fs.closeSync(this.#slave);
+
+        for (const waiter of this.#waiters.splice(0)) {
+            clearTimeout(waiter.timer);
+            waiter.reject(new Error("NCP emulator closed"));
+        }
+    }
+
+    #write(frame: Buffer): void {
+        if (!this.#closed) {
+            this.#socket.write(frame);
+        }
+    }
+
+    #disconnect(): void {
+        this.#connected = false;
+        this.#hostNotReady = false;
+        this.#ackTimeouts = 0;
+        this.#unacked = [];
+        this.#responses = [];
+        this.#callbacks = [];
+
+        clearTimeout(this.#ackTimer);
+        this.#ackTimer = undefined;
+    }
+
+    #onData(chunk: Buffer): void {
+        for (const frame of this.#decoder.push(chunk)) {
+            this.stats.rxFrames++;
+
+            if (!frame.valid) {
+                this.stats.rxInvalid++;
+
+                if (this.#connected) {
+                    this.#sendNak();
+                }
+
+                continue;
+            }
+
+            if (frame.control === ASH_CONTROL_RST) {
+                this.#reset();
+                continue;
+            }
+
+            if (!this.#connected) {
+                // anything but RST is ignored until reset
+                continue;
+            }
+
+            if ((frame.control & 0x80) === 0) {
+                this.#onDataFrame(frame);
+            } else if ((frame.control & ASH_CONTROL_ACK_NAK_MASK) === ASH_CONTROL_ACK) {
+                this.#onAck(frame.control);
+            } else if ((frame.control & ASH_CONTROL_ACK_NAK_MASK) === ASH_CONTROL_NAK) {
+                this.stats.rxNaks++;
+
+                this.#onAck(frame.control);
+                this.#retransmit();
+            }
+        }
+    }
+
+    #reset(): void {
+        this.#disconnect();
+
+        this.#connected = true;
+        this.#rxAckNumber = 0;
+        this.#txFrameNumber = 0;
+        this.stats.resets++;
+
+        this.#write(ashEncode(ASH_CONTROL_RSTACK, Buffer.from([ASH_VERSION, this.#options.resetCode])));
+    }
+
+    #onDataFrame(frame: AshFrame): void {
+        const frameNumber = (frame.control >> 4) & ASH_FRAME_NUMBER_MASK;
+
+        this.stats.rxData++;
+
+        this.#onAck(frame.control);
+
+        if (frameNumber !== this.#rxAckNumber) {
+            if (frame.control & ASH_CONTROL_RETRANSMIT) {
+                // already accepted, the ACK got lost
+                this.stats.rxDuplicates++;
+                this.#sendAck();
+            } else {
+                this.stats.rxOutOfSequence++;
+                this.#sendNak();
+            }
+
+            return;
+        }
+
+        if (this.#options.nakEvery > 0 && this.stats.rxData % this.#options.nakEvery === 0) {
+            this.#sendNak();
+            return;
+        }
+
+        this.#rxAckNumber = (frameNumber + 1) & ASH_FRAME_NUMBER_MASK;
+
+        const data = Buffer.from(frame.data);
+        const response = this.#onCommand(this.#options.randomize ? ashRandomize(data) : data);
+
+        if (!response) {
+            this.#sendAck();
+        } else if (this.#options.responseDelay > 0) {
+            this.#sendAck();
+            setTimeout(() => this.#queueResponse(response), this.#options.responseDelay);
+        } else {
+            this.#queueResponse(response);
+        }
+    }
+
+    #onCommand(frame: Buffer): Buffer | undefined {
+        const command = parseEzspCommand(frame);
+
+        if (!command) {
+            return undefined;
+        }
+
+        this.stats.commands++;
+        this.commands.push(command);
+
+        for (let i = 0; i < this.#waiters.length; i++) {
+            if (this.#waiters[i].frameId === command.frameId) {
+                const [waiter] = this.#waiters.splice(i, 1);
+
+                clearTimeout(waiter.timer);
+                waiter.resolve(command);
+                break;
+            }
+        }
+
+        const responder = this.#responders.get(command.frameId);
+        const frameControl = EZSP_FRAME_CONTROL_RESPONSE | (command.frameControl & EZSP_FRAME_CONTROL_NETWORK_INDEX_MASK);
+
+        if (!responder) {
+            return Buffer.concat([
+                ezspHeader(command.sequence, frameControl, EZSP_INVALID_COMMAND, command.extended),
+                Buffer.from([EZSP_ERROR_INVALID_FRAME_ID]),
+            ]);
+        }
+
+        const parameters = responder(command.parameters, command) ?? Buffer.alloc(0);
+
+        return Buffer.concat([ezspHeader(command.sequence, frameControl, command.frameId, command.extended), parameters]);
+    }
+
+    #queueResponse(response: Buffer): void {
+        if (this.#connected) {
+            this.#responses.push(response);
+            this.#flush();
+        }
+    }
+
+    /**
+     * Send queued EZSP frames as far as the window allows.
+     */
+    #flush(): void {
+        while (this.#connected && this.#unacked.length < this.#options.window) {
+            const frame = this.#responses.shift() ?? (this.#hostNotReady ? undefined : this.#callbacks.shift());
+
+            if (!frame) {
+                break;
+            }
+
+            const data = this.#options.randomize ? ashRandomize(Buffer.from(frame)) : frame;
+            const unacked: UnackedFrame = { frameNumber: this.#txFrameNumber, data };
+
+            this.#txFrameNumber = (this.#txFrameNumber + 1) & ASH_FRAME_NUMBER_MASK;
+            this.#unacked.push(unacked);
+            this.#sendData(unacked, false);
+        }
+    }
+
+    #sendData(frame: UnackedFrame, retransmit: boolean): void {
+        this.stats.txData++;
+        this.#write(ashEncode((frame.frameNumber << 4) | (retransmit ? ASH_CONTROL_RETRANSMIT : 0) | this.#rxAckNumber, frame.data));
+        this.#armAckTimer();
+    }
+
+    #sendAck(): void {
+        this.stats.txAcks++;
+        this.#write(ashEncode(ASH_CONTROL_ACK | this.#rxAckNumber));
+    }
+
+    #sendNak(): void {
+        this.stats.txNaks++;
+        this.#write(ashEncode(ASH_CONTROL_NAK | this.#rxAckNumber));
+    }
+
+    /**
+     * Release frames acknowledged by the ackNum field of a DATA, ACK or NAK frame (ignored if outside the window).
+     */
+    #onAck(control: number): void {
+        const ackNumber = control & ASH_FRAME_NUMBER_MASK;
+
+        if ((control & 0x80) !== 0) {
+            this.#hostNotReady = (control & ASH_CONTROL_NOT_READY) !== 0;
+        }
+
+        if (ackNumber !== this.#txFrameNumber && !this.#unacked.some((frame) => frame.frameNumber === ackNumber)) {
+            return;
+        }
+
+        while (this.#unacked.length > 0 && this.#unacked[0].frameNumber !== ackNumber) {
+            this.#unacked.shift();
+            this.#ackTimeouts = 0;
+        }
+
+        if (this.#unacked.length === 0) {
+            clearTimeout(this.#ackTimer);
+            this.#ackTimer = undefined;
+        }
+
+        this.#flush();
+    }
+
+    #retransmit(): void {
+        for (const frame of this.#unacked) {
+            this.stats.txRetransmits++;
+            this.#sendData(frame, true);
+        }
+    }
+
+    #armAckTimer(): void {
+        clearTimeout(this.#ackTimer);
+
+        this.#ackTimer = setTimeout(() => {
+            this.#ackTimer = undefined;
+
+            if (++this.#ackTimeouts >= ASH_MAX_ACK_TIMEOUTS) {
+                this.#disconnect();
+            } else {
+                this.#retransmit();
+            }
+        }, this.#options.ackTimeout);
+    }
+}
+
+// #endregion Emulator
@@ -0,0 +1,140 @@
+/**
+ * Stand-in NCP process for end-to-end benchmarks (`throughput.bench.ts`), forked with `--import tsx`.
+ * Running apart keeps the emulator off the measured process (CPU, JS thread).
+ *
+ * - `sendUnicast`/`sendBroadcast` succeed, followed by `messageSentHandler` (same APS frame, tag and payload)
+ * - IPC `{ type: "messageSent", status }` sets the status of the following `messageSentHandler`, `null` to drop them (answers once set)
+ * - IPC `{ type: "flood", count }` emits `count` `incomingMessageHandler` (ZCL report, distinct senders and sequences)
+ * - IPC `{ type: "stats" }` answers with the emulator stats
+ *
+ * Sends `{ type: "ready", path }` once the pseudo-terminal is open.
+ */
+
+import {
+    EZSP_APS_FRAME_SIZE,
+    EZSP_INCOMING_MESSAGE_HANDLER,
+    EZSP_MESSAGE_SENT_HANDLER,
+    EZSP_SEND_BROADCAST,
+    EZSP_SEND_UNICAST,
+    NcpEmulator,
+    readEzspApsFrame,
+    writeEzspApsFrame,
+} from "./ncp-emulator.js";
+
+export type NcpStandInRequest = { type: "flood"; count: number } | { type: "messageSent"; status: number | null } | { type: "stats" };
+
+export type NcpStandInMessage = { type: "ready"; path: string } | { type: "messageSent" } | { type: "stats"; stats: NcpEmulator["stats"] };
+
+/** `SL_ZIGBEE_OUTGOING_BROADCAST` */
+const OUTGOING_BROADCAST = 6;
+/** `SL_ZIGBEE_INCOMING_UNICAST` */
+const INCOMING_UNICAST = 0;
+/** Report Attributes, OnOff = 1 */
+const REPORT = Buffer.from([0x18, 0x00, 0x0a, 0x00, 0x00, 0x10, 0x01]);
+/** sl_zigbee_rx_packet_info_t: sender, sender EUI64, binding index, address index, LQI, RSSI, timestamp */
+const PACKET_INFO_SIZE = 18;
+
+const binding = (await import("../src/index.js")).default;
+const emulator = NcpEmulator.open(binding);
+let apsSequence = 0;
+/** `null` drops `messageSentHandler` */
+let messageSentStatus: number | null = 0;
+
+function send(type: number, indexOrDestination: number, apsFrame: Buffer, messageTag: number, message: Buffer): Buffer {
+    const sequence = apsSequence++ & 0xff;
+    const response = Buffer.alloc(5);
+    // SL_STATUS_OK
+    response.writeUInt32LE(0, 0);
+    response[4] = sequence;
+
+    if (messageSentStatus === null) {
+        return response;
+    }
+
+    const sent = Buffer.alloc(4 + 1 + 2 + EZSP_APS_FRAME_SIZE + 2 + 1 + message.length);
+    let offset = sent.writeUInt32LE(messageSentStatus, 0);
+    offset = sent.writeUInt8(type, offset);
+    offset = sent.writeUInt16LE(indexOrDestination, offset);
+    writeEzspApsFrame({ ...readEzspApsFrame(apsFrame), sequence }, sent, offset);
+    offset = sent.writeUInt16LE(messageTag, offset + EZSP_APS_FRAME_SIZE);
+    offset = sent.writeUInt8(message.length, offset);
+    message.copy(sent, offset);
+
+    // after the response
+    setImmediate(() => emulator.callback(EZSP_MESSAGE_SENT_HANDLER, sent));
+
+    return response;
+}
+
+emulator.respond(EZSP_SEND_UNICAST, (parameters) => {
+    // type, indexOrDestination, apsFrame, messageTag, messageLength, message
+    const tagOffset = 3 + EZSP_APS_FRAME_SIZE;
+
+    return send(
+        parameters[0],
+        parameters.readUInt16LE(1),
+        parameters.subarray(3, tagOffset),
+        parameters.readUInt16LE(tagOffset),
+        parameters.subarray(tagOffset + 3, tagOffset + 3 + parameters[tagOffset + 2]),
+    );
+});
+
+emulator.respond(EZSP_SEND_BROADCAST, (parameters) => {
+    // alias, destination, nwkSequence, apsFrame, radius, messageTag, messageLength, message
+    const tagOffset = 5 + EZSP_APS_FRAME_SIZE + 1;
+
+    return send(
+        OUTGOING_BROADCAST,
+        parameters.readUInt16LE(2),
+        parameters.subarray(5, 5 + EZSP_APS_FRAME_SIZE),
+        parameters.readUInt16LE(tagOffset),
+        parameters.subarray(tagOffset + 3, tagOffset + 3 + parameters[tagOffset + 2]),
+    );
+});
+
+function flood(count: number): void {
+    for (let i = 0; i < count; i++) {
+        const incoming = Buffer.alloc(1 + EZSP_APS_FRAME_SIZE + PACKET_INFO_SIZE + 1 + REPORT.length);
+        incoming[0] = INCOMING_UNICAST;
+        writeEzspApsFrame(
+            { profileId: 0x0104, clusterId: 0x0006, sourceEndpoint: 1, destinationEndpoint: 1, options: 0x0140, groupId: 0, sequence: i & 0xff },
+            incoming,
+            1,
+        );
+
+        const packetInfo = 1 + EZSP_APS_FRAME_SIZE;
+        // sender (never the coordinator), LQI, RSSI
+        incoming.writeUInt16LE(0x0001 + (i % 0xfff0), packetInfo);
+        incoming[packetInfo + 12] = 0xff;
+        incoming.writeInt8(-60, packetInfo + 13);
+        incoming[packetInfo + PACKET_INFO_SIZE] = REPORT.length;
+        REPORT.copy(incoming, packetInfo + PACKET_INFO_SIZE + 1);
+
+        emulator.callback(EZSP_INCOMING_MESSAGE_HANDLER, incoming);
+    }
+}
+
+process.on("message", (request: NcpStandInRequest) => {
+    switch (request.type) {
+        case "flood": {
+            flood(request.count);
+            break;
+        }
+        case "messageSent": {
+            messageSentStatus = request.status;
+            process.send?.({ type: "messageSent" } satisfies NcpStandInMessage);
+            break;
+        }
+        case "stats": {
+            process.send?.({ type: "stats", stats: emulator.stats } satisfies NcpStandInMessage);
+            break;
+        }
+    }
+});
+
+process.on("disconnect", () => {
+    emulator.close();
+    process.exit(0);
+});
+
+process.send?.({ type: "ready", path: emulator.path } satisfies NcpStandInMessage);
@@ -0,0 +1,215 @@
+import { performance } from "node:perf_hooks";
+import { afterAll, bench, describe } from "vitest";
+import type { EzspNativeEvent } from "../src/index.js";
+import { TEST_APS_FRAME, TEST_MESSAGE, useNcpStandIn } from "./fixtures.js";
+
+/**
+ * End-to-end scenarios through the full stack (`send` -> ASH -> pty -> stand-in NCP -> back), see `ncp-stand-in.ts`.
+ * Besides vitest's per-iteration times, reports per scenario on completion:
+ * sustained messages per second, p50/p99/p999 send-to-`messageSent` latency over all iterations (floods: flood-to-event),
+ * JS thread busy time (event loop utilization) and process CPU per message.
+ */
+
+/** messages per iteration */
+const MESSAGES = 100;
+/** min iterations per scenario: latencies are pooled across them, p999 needs well over 1000 samples to differ from the max */
+const BENCH_OPTIONS = { iterations: 20 };
+/** ms, an iteration missing events (lost frame, stand-in gone) fails instead of hanging */
+const ITERATION_TIMEOUT = 10000;
+
+type ScenarioStats = {
+    messages: number;
+    /** ms */
+    elapsed: number;
+    /** ms, send/flood to event */
+    latencies: number[];
+    /** ms */
+    busy: number;
+    /** µs */
+    cpu: number;
+};
+
+function percentile(sorted: number[], p: number): number {
+    return sorted.length === 0 ? Number.NaN : sorted[Math.min(sorted.length - 1, Math.floor(p * sorted.length))];
+}
+
+function report(scenarios: Map<string, ScenarioStats>): string {
+    const lines = [
+        "",
+        "End-to-end (stand-in NCP over pty)",
+        `${"scenario".padEnd(28)}${"msgs".padStart(8)}${"msgs/s".padStart(10)}${"p50 ms".padStart(10)}${"p99 ms".padStart(10)}` +
+            `${"p999 ms".padStart(10)}${"JS busy %".padStart(11)}${"CPU µs/msg".padStart(12)}`,
+    ];
+
+    for (const [name, stats] of scenarios) {
+        const sorted = stats.latencies.toSorted((a, b) => a - b);
+
+        lines.push(
+            `${name.padEnd(28)}${String(stats.messages).padStart(8)}${((stats.messages * 1000) / stats.elapsed).toFixed(0).padStart(10)}` +
+                `${percentile(sorted, 0.5).toFixed(2).padStart(10)}${percentile(sorted, 0.99).toFixed(2).padStart(10)}` +
+                `${percentile(sorted, 0.999).toFixed(2).padStart(10)}` +
+                `${((stats.busy * 100) / stats.elapsed).toFixed(1).padStart(11)}` +
+                `${(stats.cpu / stats.messages).toFixed(1).padStart(12)}`,
+        );
+    }
+
+    return `${lines.join("\n")}\n\n`;
+}
+
+describe("End-to-end throughput", () => {
+    const apsFrame = { ...TEST_APS_FRAME };
+    const scenarios = new Map<string, ScenarioStats>();
+    /** messageTag -> send time */
+    const pending = new Map<number, number>();
+    /** messageTag -> `messageSent` time, for events delivered before the send returned its tag */
+    const early = new Map<number, number>();
+    let remaining = 0;
+    let floodStart = 0;
+    let latencies: number[] = [];
+    let done: (() => void) | undefined;
+
+    const onEvent = (event: EzspNativeEvent): void => {
+        if (event.name === "messageSent") {
+            const sentAt = pending.get(event.messageTag);
+
+            if (sentAt === undefined) {
+                early.set(event.messageTag, performance.now());
+            } else {
+                pending.delete(event.messageTag);
+                latencies.push(performance.now() - sentAt);
+            }
+        } else if (event.name === "incomingMessage") {
+            latencies.push(performance.now() - floodStart);
+        } else {
+            return;
+        }
+
+        if (--remaining === 0) {
+            done?.();
+        }
+    };
+
+    /**
+     * Run one iteration of a scenario, accumulating its stats.
+     */
+    const measure = async (name: string, run: () => void | Promise<void>): Promise<void> => {
+        const completed = new Promise<void>((resolve) => {
+            done = resolve;
+        });
+        const elu = performance.eventLoopUtilization();
+        const cpu = process.cpuUsage();
+        const start = performance.now();
+
+        latencies = [];
+        remaining = MESSAGES;
+
+        await run();
+
+        let timer: NodeJS.Timeout | undefined;
+        const timedOut = new Promise<never>((_resolve, reject) => {
+            timer = setTimeout(() => {
+                reject(new Error(`${name}: ${remaining} of ${MESSAGES} events missing after ${ITERATION_TIMEOUT}ms`));
+            }, ITERATION_TIMEOUT);
+        });
+
+        try {
+            await Promise.race([completed, timedOut]);
+        } finally {
+            clearTimeout(timer);
+        }
+
+        const elapsed = performance.now() - start;
+        const cpuDelta = process.cpuUsage(cpu);
+        const stats = scenarios.get(name) ?? { messages: 0, elapsed: 0, latencies: [], busy: 0, cpu: 0 };
+
+        stats.messages += MESSAGES;
+        stats.elapsed += elapsed;
+        stats.latencies.push(...latencies);
+        stats.busy += performance.eventLoopUtilization(elu).active;
+        stats.cpu += cpuDelta.user + cpuDelta.system;
+
+        scenarios.set(name, stats);
+    };
+
+    const sent = (messageTag: number, sentAt: number): void => {
+        const arrivedAt = early.get(messageTag);
+
+        if (arrivedAt === undefined) {
+            pending.set(messageTag, sentAt);
+        } else {
+            early.delete(messageTag);
+            latencies.push(arrivedAt - sentAt);
+        }
+    };
+
+    const stack = useNcpStandIn({}, onEvent, false);
+
+    afterAll(() => {
+        process.stdout.write(report(scenarios));
+    });
+
+    bench(
+        "unicast send -> messageSent",
+        async () => {
+            await measure("unicast", () => {
+                for (let i = 0; i < MESSAGES; i++) {
+                    const sentAt = performance.now();
+                    const [, messageTag] = stack.binding.send(0, 0x1234, apsFrame, TEST_MESSAGE, 0, 0);
+
+                    sent(messageTag, sentAt);
+                }
+            });
+        },
+        BENCH_OPTIONS,
+    );
+
+    bench(
+        "unicast async send -> messageSent",
+        async () => {
+            await measure("unicast (async)", async () => {
+                const sends: Promise<void>[] = [];
+
+                for (let i = 0; i < MESSAGES; i++) {
+                    const sentAt = performance.now();
+
+                    sends.push(
+                        stack.binding.async.send(0, 0x1234, apsFrame, TEST_MESSAGE, 0, 0).then(([, messageTag]) => {
+                            sent(messageTag, sentAt);
+                        }),
+                    );
+                }
+
+                await Promise.all(sends);
+            });
+        },
+        BENCH_OPTIONS,
+    );
+
+    bench(
+        "broadcast send -> messageSent",
+        async () => {
+            await measure("broadcast", () => {
+                for (let i = 0; i < MESSAGES; i++) {
+                    const sentAt = performance.now();
+                    // SL_ZIGBEE_OUTGOING_BROADCAST, sleepy included
+                    const [, messageTag] = stack.binding.send(6, 0xffff, apsFrame, TEST_MESSAGE, 0, 0);
+
+                    sent(messageTag, sentAt);
+                }
+            });
+        },
+        BENCH_OPTIONS,
+    );
+
+    bench(
+        "inbound incomingMessage flood",
+        async () => {
+            await measure("inbound flood", () => {
+                floodStart = performance.now();
+
+                stack.ncp.request({ type: "flood", count: MESSAGES });
+            });
+        },
+        BENCH_OPTIONS,
+    );
+});